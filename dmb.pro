@@ -13,6 +13,9 @@ SOURCES += \
     src/core/dmbdict.c \
     src/core/dmblist.c \
     src/core/dmbskiplist.c \
+    src/core/dmbnodepool.c \
+    src/core/dmbzskiplist.c \
+    src/core/dmbzbtree.c \
     src/utils/dmbsysutil.c \
     src/utils/dmblog.c \
     src/utils/dmbtime.c \
@@ -34,7 +37,26 @@ SOURCES += \
     src/tests/dmbutils_test.c \
     src/tests/dmbnetwork_test.c \
     src/network/dmbprotocol.c \
-    src/utils/dmbioutil.c
+    src/utils/dmbioutil.c \
+    src/tests/dmbdict_test.c \
+    src/core/dmbflatdict.c \
+    src/core/dmbhash.c \
+    src/core/dmbrandom.c \
+    src/core/dmblzf.c \
+    src/core/dmbfenwick.c \
+    src/tests/dmbhash_test.c \
+    src/core/dmbconcurrentdict.c \
+    src/tests/dmbconcurrentdict_test.c \
+    src/thread/dmbmailbox.c \
+    src/network/dmbpartition.c \
+    src/tests/dmbpartition_test.c \
+    src/base/dmbzset.c \
+    src/tests/dmbzset_test.c \
+    src/base/dmbmap.c \
+    src/tests/dmbmap_test.c \
+    src/base/dmbseglist.c \
+    src/tests/dmbseglist_test.c \
+    src/tests/dmbobject_test.c
     
 HEADERS += \ 
     src/dmbdefines.h \
@@ -43,6 +65,9 @@ HEADERS += \
     src/core/dmbdict.h \
     src/core/dmblist.h \
     src/core/dmbskiplist.h \
+    src/core/dmbnodepool.h \
+    src/core/dmbzskiplist.h \
+    src/core/dmbzbtree.h \
     src/utils/dmbsysutil.h \
     src/utils/dmblog.h \
     src/thread/dmbatomic.h \
@@ -66,7 +91,26 @@ HEADERS += \
     src/tests/dmbutils_test.h \
     src/tests/dmbnetwork_test.h \
     src/tests/dmbtest.h \
-    src/network/dmbprotocol.h
+    src/network/dmbprotocol.h \
+    src/tests/dmbdict_test.h \
+    src/core/dmbflatdict.h \
+    src/core/dmbhash.h \
+    src/core/dmbrandom.h \
+    src/core/dmblzf.h \
+    src/core/dmbfenwick.h \
+    src/tests/dmbhash_test.h \
+    src/core/dmbconcurrentdict.h \
+    src/tests/dmbconcurrentdict_test.h \
+    src/thread/dmbmailbox.h \
+    src/network/dmbpartition.h \
+    src/tests/dmbpartition_test.h \
+    src/base/dmbzset.h \
+    src/tests/dmbzset_test.h \
+    src/base/dmbmap.h \
+    src/tests/dmbmap_test.h \
+    src/base/dmbseglist.h \
+    src/tests/dmbseglist_test.h \
+    src/tests/dmbobject_test.h
 
 DEFINES += DMB_USE_JEMALLOC
 DEFINES += DMB_DEBUG
@@ -0,0 +1,316 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbmap.h"
+#include "dmbobject.h"
+#include "dmbsettings.h"
+#include "core/dmballoc.h"
+#include "core/dmbdictmetas.h"
+
+#define MAP_BL_ALLOCATOR DMB_DEFAULT_BINALLOCATOR
+
+static inline dmbBinEntry* blFirst(dmbBinlist *pList)
+{
+    return dmbBinlistLen(pList) == 0 ? NULL : dmbBinlistFirst(pList);
+}
+
+static inline void blGetStr(dmbBinEntry *pEntry, const dmbCHAR **ppcData, dmbUINT *pLen)
+{
+    dmbBinVar var;
+
+    dmbBinEntryGet(pEntry, &var);
+    *ppcData = (const dmbCHAR*)var.data;
+    *pLen = var.len;
+}
+
+static inline dmbUINT blSize(dmbMap *pMap)
+{
+    return dmbBinlistLen(pMap->bl) / 2;
+}
+
+//an empty string has no binlist encoding
+static inline dmbBOOL blFits(dmbUINT uLen)
+{
+    return uLen > 0 && uLen <= g_settings.map_max_binlist_value;
+}
+
+//entry of the field, NULL if it does not exist, its value is the next entry
+static inline dmbBinEntry* blFind(dmbMap *pMap, const dmbCHAR *pcField, dmbUINT uFieldLen)
+{
+    //only fields are compared, every value is skipped
+    return dmbBinlistFind(pMap->bl, NULL, (const dmbBYTE*)pcField, uFieldLen, 1);
+}
+
+static dmbCode blAppend(dmbMap *pMap, const dmbCHAR *pcField, dmbUINT uFieldLen, const dmbCHAR *pcValue, dmbUINT uValueLen)
+{
+    dmbBinItem items[2];
+    dmbCode code;
+
+    code = dmbBinItemStr(&items[0], (dmbBYTE*)pcField, uFieldLen);
+    if (code == DMB_ERRCODE_OK)
+        code = dmbBinItemStr(&items[1], (dmbBYTE*)pcValue, uValueLen);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    return dmbBinlistInsertAt(MAP_BL_ALLOCATOR, &pMap->bl, NULL, items, 2);
+}
+
+static dmbCode blReplaceValue(dmbMap *pMap, dmbBinEntry *pValueEntry, const dmbCHAR *pcValue, dmbUINT uValueLen)
+{
+    dmbBinItem item;
+    dmbCode code;
+
+    code = dmbBinItemStr(&item, (dmbBYTE*)pcValue, uValueLen);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    return dmbBinlistReplace(MAP_BL_ALLOCATOR, &pMap->bl, pValueEntry, &item);
+}
+
+static void dictFreeEntry(dmbDictEntry *pEntry)
+{
+    dmbStringDestroy((dmbString*)pEntry->k.val);
+    dmbStringDestroy((dmbString*)pEntry->v.val);
+    dmbFree(pEntry);
+}
+
+static void dictPurge(dmbDict *pDict)
+{
+    dmbDictIter iter;
+    dmbDictEntry *pEntry;
+
+    dmbDictInitIter(pDict, &iter);
+    while ((pEntry = dmbDictNext(&iter)) != NULL)
+        dictFreeEntry(pEntry);
+    dmbDictDestroy(pDict);
+}
+
+static dmbCode dictInsert(dmbDict *pDict, const dmbCHAR *pcField, dmbUINT uFieldLen, const dmbCHAR *pcValue, dmbUINT uValueLen)
+{
+    dmbDictEntry *pEntry = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry));
+
+    if (pEntry == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    pEntry->k.val = dmbStringCreateWithBuffer(pcField, uFieldLen);
+    pEntry->v.val = dmbStringCreateWithBuffer(pcValue, uValueLen);
+    if (pEntry->k.val == NULL || pEntry->v.val == NULL)
+    {
+        if (pEntry->k.val != NULL)
+            dmbStringDestroy((dmbString*)pEntry->k.val);
+        if (pEntry->v.val != NULL)
+            dmbStringDestroy((dmbString*)pEntry->v.val);
+        dmbFree(pEntry);
+        return DMB_ERRCODE_ALLOC_FAILED;
+    }
+
+    dmbDictPut(pDict, pEntry);
+    return DMB_ERRCODE_OK;
+}
+
+//moves all pairs into a dict, the map keeps its binlist on failure
+static dmbCode blConvert(dmbMap *pMap)
+{
+    dmbDict *pDict = dmbDictCreate(&dmbDictMetaStr, 0);
+    dmbBinEntry *pEntry, *pValueEntry;
+    const dmbCHAR *pcField, *pcValue;
+    dmbUINT uFieldLen, uValueLen;
+    dmbCode code = DMB_ERRCODE_OK;
+
+    if (pDict == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    for (pEntry = blFirst(pMap->bl); pEntry != NULL && code == DMB_ERRCODE_OK; pEntry = dmbBinlistNext(pValueEntry))
+    {
+        pValueEntry = dmbBinlistNext(pEntry);
+        blGetStr(pEntry, &pcField, &uFieldLen);
+        blGetStr(pValueEntry, &pcValue, &uValueLen);
+        code = dictInsert(pDict, pcField, uFieldLen, pcValue, uValueLen);
+    }
+
+    if (code != DMB_ERRCODE_OK)
+    {
+        dictPurge(pDict);
+        return code;
+    }
+
+    dmbBinlistDestroy(MAP_BL_ALLOCATOR, pMap->bl);
+    pMap->bl = NULL;
+    pMap->dict = pDict;
+    pMap->encode = DMB_OBJ_ENCODE_DICT;
+    return DMB_ERRCODE_OK;
+}
+
+dmbMap* dmbMapCreate()
+{
+    dmbMap *pMap = (dmbMap*)dmbMalloc(sizeof(dmbMap));
+    if (pMap == NULL)
+        return NULL;
+
+    pMap->encode = DMB_OBJ_ENCODE_BINLIST;
+    pMap->dict = NULL;
+    pMap->bl = dmbBinlistCreate(MAP_BL_ALLOCATOR);
+    if (pMap->bl == NULL)
+    {
+        dmbFree(pMap);
+        return NULL;
+    }
+
+    return pMap;
+}
+
+void dmbMapDestroy(dmbMap *pMap)
+{
+    if (pMap->encode == DMB_OBJ_ENCODE_BINLIST)
+        dmbBinlistDestroy(MAP_BL_ALLOCATOR, pMap->bl);
+    else
+        dictPurge(pMap->dict);
+    dmbFree(pMap);
+}
+
+dmbLONG dmbMapSize(dmbMap *pMap)
+{
+    if (pMap->encode == DMB_OBJ_ENCODE_BINLIST)
+        return blSize(pMap);
+
+    return dmbDictSize(pMap->dict);
+}
+
+dmbCode dmbMapSet(dmbMap *pMap, const dmbCHAR *pcField, dmbUINT uFieldLen, const dmbCHAR *pcValue, dmbUINT uValueLen, dmbBOOL *pAdded)
+{
+    dmbDictEntry *pEntry;
+    dmbBinEntry *pFieldEntry, *pValueEntry;
+    dmbString *pValue;
+    const dmbCHAR *pcCur;
+    dmbUINT uCurLen;
+    dmbCode code;
+
+    if (pMap->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        pFieldEntry = blFind(pMap, pcField, uFieldLen);
+        if (pAdded != NULL)
+            *pAdded = pFieldEntry == NULL;
+
+        if (pFieldEntry != NULL)
+        {
+            pValueEntry = dmbBinlistNext(pFieldEntry);
+            blGetStr(pValueEntry, &pcCur, &uCurLen);
+            if (uCurLen == uValueLen && dmbMemCmp(pcCur, pcValue, uValueLen) == 0)
+                return DMB_ERRCODE_OK;
+            if (blFits(uValueLen))
+                return blReplaceValue(pMap, pValueEntry, pcValue, uValueLen);
+        }
+        else if (blSize(pMap) < g_settings.map_max_binlist_entries && blFits(uFieldLen) && blFits(uValueLen))
+        {
+            return blAppend(pMap, pcField, uFieldLen, pcValue, uValueLen);
+        }
+
+        code = blConvert(pMap);
+        if (code != DMB_ERRCODE_OK)
+            return code;
+    }
+
+    pEntry = dmbDictGetByData(pMap->dict, pcField, uFieldLen);
+    if (pAdded != NULL)
+        *pAdded = pEntry == NULL;
+
+    if (pEntry == NULL)
+        return dictInsert(pMap->dict, pcField, uFieldLen, pcValue, uValueLen);
+
+    pValue = dmbStringCreateWithBuffer(pcValue, uValueLen);
+    if (pValue == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    dmbStringDestroy((dmbString*)pEntry->v.val);
+    pEntry->v.val = pValue;
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbMapGet(dmbMap *pMap, const dmbCHAR *pcField, dmbUINT uFieldLen, const dmbCHAR **ppcValue, dmbUINT *pValueLen)
+{
+    dmbDictEntry *pEntry;
+    dmbBinEntry *pFieldEntry;
+
+    if (pMap->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        pFieldEntry = blFind(pMap, pcField, uFieldLen);
+        if (pFieldEntry == NULL)
+            return DMB_ERRCODE_MAPFIELD_NOT_EXIST;
+
+        blGetStr(dmbBinlistNext(pFieldEntry), ppcValue, pValueLen);
+        return DMB_ERRCODE_OK;
+    }
+
+    pEntry = dmbDictGetByData(pMap->dict, pcField, uFieldLen);
+    if (pEntry == NULL)
+        return DMB_ERRCODE_MAPFIELD_NOT_EXIST;
+
+    dmbStringGetData((dmbString*)pEntry->v.val, ppcValue, pValueLen);
+    return DMB_ERRCODE_OK;
+}
+
+dmbBOOL dmbMapRemove(dmbMap *pMap, const dmbCHAR *pcField, dmbUINT uFieldLen)
+{
+    dmbDictEntry *pEntry;
+    dmbBinEntry *pFieldEntry;
+
+    if (pMap->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        pFieldEntry = blFind(pMap, pcField, uFieldLen);
+        return pFieldEntry != NULL && dmbBinlistDeleteRange(MAP_BL_ALLOCATOR, &pMap->bl, pFieldEntry, 2) == DMB_ERRCODE_OK;
+    }
+
+    pEntry = dmbDictPopByData(pMap->dict, pcField, uFieldLen);
+    if (pEntry == NULL)
+        return FALSE;
+
+    dictFreeEntry(pEntry);
+    return TRUE;
+}
+
+dmbCode dmbMapScan(dmbMap *pMap, dmbMapScanFunc fn, void *pData)
+{
+    dmbBinEntry *pEntry, *pValueEntry;
+    dmbDictEntry *pDictEntry;
+    dmbDictIter iter;
+    const dmbCHAR *pcField, *pcValue;
+    dmbUINT uFieldLen, uValueLen;
+    dmbCode code = DMB_ERRCODE_OK;
+
+    if (pMap->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        for (pEntry = blFirst(pMap->bl); pEntry != NULL && code == DMB_ERRCODE_OK; pEntry = dmbBinlistNext(pValueEntry))
+        {
+            pValueEntry = dmbBinlistNext(pEntry);
+            blGetStr(pEntry, &pcField, &uFieldLen);
+            blGetStr(pValueEntry, &pcValue, &uValueLen);
+            code = fn(pData, pcField, uFieldLen, pcValue, uValueLen);
+        }
+        return code == DMB_ERRCODE_MAP_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+    }
+
+    dmbDictInitIter(pMap->dict, &iter);
+    while (code == DMB_ERRCODE_OK && (pDictEntry = dmbDictNext(&iter)) != NULL)
+    {
+        dmbStringGetData((dmbString*)pDictEntry->k.val, &pcField, &uFieldLen);
+        dmbStringGetData((dmbString*)pDictEntry->v.val, &pcValue, &uValueLen);
+        code = fn(pData, pcField, uFieldLen, pcValue, uValueLen);
+    }
+    dmbDictReleaseIter(&iter);
+
+    return code == DMB_ERRCODE_MAP_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+}
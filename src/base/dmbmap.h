@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBMAP_H
+#define DMBMAP_H
+
+#include "core/dmbdict.h"
+#include "core/dmbbinlist.h"
+#include "core/dmbstring.h"
+
+/*
+ * Field/value map. Small maps are a binlist of field/value pairs in insert
+ * order and are looked up linearly; once map_max_binlist_entries or
+ * map_max_binlist_value of g_settings is exceeded they are converted to a
+ * dmbDict whose entries hold the field in k and the value in v as dmbString.
+ * The conversion is one way.
+ */
+
+typedef struct dmbMap {
+    //DMB_OBJ_ENCODE_BINLIST or DMB_OBJ_ENCODE_DICT
+    dmbUINT32 encode;
+    dmbBinlist *bl;
+    dmbDict *dict;
+} dmbMap;
+
+//pcField and pcValue are only valid during the call
+typedef dmbCode (*dmbMapScanFunc)(void *pData, const dmbCHAR *pcField, dmbUINT uFieldLen, const dmbCHAR *pcValue, dmbUINT uValueLen);
+
+dmbMap* dmbMapCreate();
+void dmbMapDestroy(dmbMap *pMap);
+dmbLONG dmbMapSize(dmbMap *pMap);
+
+/**
+ * @brief dmbMapSet 设置字段的值，已存在时覆盖
+ * @param pAdded 输出，新字段为TRUE，覆盖为FALSE，可以为NULL
+ */
+dmbCode dmbMapSet(dmbMap *pMap, const dmbCHAR *pcField, dmbUINT uFieldLen, const dmbCHAR *pcValue, dmbUINT uValueLen, dmbBOOL *pAdded);
+
+/**
+ * @brief dmbMapGet 获取字段的值，返回的指针在下一次修改map前有效
+ * @return 字段不存在返回DMB_ERRCODE_MAPFIELD_NOT_EXIST
+ */
+dmbCode dmbMapGet(dmbMap *pMap, const dmbCHAR *pcField, dmbUINT uFieldLen, const dmbCHAR **ppcValue, dmbUINT *pValueLen);
+
+dmbBOOL dmbMapRemove(dmbMap *pMap, const dmbCHAR *pcField, dmbUINT uFieldLen);
+
+/**
+ * @brief dmbMapScan 遍历所有字段，fn返回DMB_ERRCODE_MAP_SCAN_BREAK提前结束，遍历期间不能修改map
+ */
+dmbCode dmbMapScan(dmbMap *pMap, dmbMapScanFunc fn, void *pData);
+
+#endif // DMBMAP_H
@@ -20,6 +20,12 @@
 #include "thread/dmbatomic.h"
 #include "core/dmballoc.h"
 #include "core/dmbstring.h"
+#include "dmbzset.h"
+#include "dmbmap.h"
+#include "dmbseglist.h"
+
+//string objects with encode INT for 0..DMB_OBJ_SHARED_INTEGERS-1, never freed
+static dmbObject g_shared_integers[DMB_OBJ_SHARED_INTEGERS];
 
 static dmbBOOL checkType(dmbObject *pObj)
 {
@@ -28,12 +34,39 @@ static dmbBOOL checkType(dmbObject *pObj)
     return FALSE;
 }
 
+void dmbObjectInitShared()
+{
+    dmbLONG i;
+
+    for (i=0; i<DMB_OBJ_SHARED_INTEGERS; ++i)
+    {
+        g_shared_integers[i].type = DMB_OBJ_TYPE_STRING;
+        g_shared_integers[i].encode = DMB_OBJ_ENCODE_INT;
+        g_shared_integers[i].published = TRUE;
+        g_shared_integers[i].ref = DMB_OBJ_REF_SHARED;
+        g_shared_integers[i].num = i;
+    }
+}
+
+void dmbObjectPublish(dmbObject *o)
+{
+    if (o->published)
+        return;
+
+    o->published = TRUE;
+    //full barrier, the plain counting is visible before the pointer is handed over
+    dmbAtomicAdd(&o->ref, 0);
+}
+
 dmbBOOL dmbObjectRetain(dmbObject *o)
 {
     dmbLONG ret;
     DMB_ASSERT_X(checkType(o),"Unsupport Type, it maybe not a Object\n");
 
-    ret = dmbAtomicIncr(&o->ref);
+    if (dmbObjectIsShared(o))
+        return TRUE;
+
+    ret = o->published ? dmbAtomicIncr(&o->ref) : ++o->ref;
     DMB_ASSERT_X(ret>1, "dmbObject Reference count is < 1, it must have been freed at another place");
 
     return TRUE;
@@ -43,9 +76,12 @@ dmbBOOL dmbObjectRelease(dmbObject *pObj)
 {
     DMB_ASSERT_X(checkType(pObj),"Unsupport Type, it maybe not a Object\n");
 
-    DMB_ASSERT_X(dmbAtomicAdd(&pObj->ref ,0)>=1,"dmbObject Reference count is < 1, it must have been freed at another place\n");
+    if (dmbObjectIsShared(pObj))
+        return FALSE;
+
+    DMB_ASSERT_X((pObj->published ? dmbAtomicAdd(&pObj->ref ,0) : pObj->ref)>=1,"dmbObject Reference count is < 1, it must have been freed at another place\n");
 
-    if (!dmbAtomicDecr(&pObj->ref))
+    if (!(pObj->published ? dmbAtomicDecr(&pObj->ref) : --pObj->ref))
     {
         switch (pObj->type)
         {
@@ -83,14 +119,40 @@ dmbObject* dmbCreateIntObject(dmbLONG lValue)
     {
         o->type = DMB_OBJ_TYPE_INT;
         o->encode = DMB_OBJ_ENCODE_INT;
+        o->published = FALSE;
         o->ref = 1;
         o->num = lValue;
     }
     return o;
 }
 
+//object header, string header and bytes in one allocation
+static dmbObject* createEmbStringObject(dmbCHAR *pcStr, dmbUINT uLen)
+{
+    dmbObject *o = (dmbObject*)dmbMalloc(sizeof(dmbObject) + sizeof(dmbString) + uLen);
+    dmbString *pStr;
+
+    if (o != NULL)
+    {
+        pStr = (dmbString*)(o + 1);
+        pStr->len = uLen;
+        pStr->capacity = uLen;
+        dmbMemCopy(pStr->data, pcStr, uLen);
+
+        o->ptr = pStr;
+        o->type = DMB_OBJ_TYPE_STRING;
+        o->encode = DMB_OBJ_ENCODE_EMBSTR;
+        o->published = FALSE;
+        o->ref = 1;
+    }
+    return o;
+}
+
 dmbObject* dmbCreateStringObject(dmbCHAR *pcStr, dmbUINT uLen)
 {
+    if (uLen <= DMB_OBJ_EMBSTR_MAX)
+        return createEmbStringObject(pcStr, uLen);
+
     dmbObject *o = (dmbObject*)dmbMalloc(sizeof(dmbObject));
     if (o != NULL)
     {
@@ -103,11 +165,183 @@ dmbObject* dmbCreateStringObject(dmbCHAR *pcStr, dmbUINT uLen)
 
         o->type = DMB_OBJ_TYPE_STRING;
         o->encode = DMB_OBJ_ENCODE_STRING;
+        o->published = FALSE;
+        o->ref = 1;
+    }
+    return o;
+}
+
+//only the canonical form, so the value reads back byte for byte
+static dmbBOOL string2Long(const dmbCHAR *pcStr, dmbUINT uLen, dmbLONG *pValue)
+{
+    dmbCHAR buf[DMB_OBJ_INT_STR_SIZE], out[DMB_OBJ_INT_STR_SIZE];
+    dmbUINT uOutLen = sizeof(out);
+
+    if (uLen == 0 || uLen > 20)
+        return FALSE;
+
+    dmbMemCopy(buf, pcStr, uLen);
+    buf[uLen] = '\0';
+    if (dmbString2Long(buf, pValue) != DMB_ERRCODE_OK || *pValue == LONG_MIN)
+        return FALSE;
+
+    return dmbLong2Str(*pValue, out, &uOutLen) == DMB_ERRCODE_OK && uOutLen == uLen && dmbMemCmp(out, pcStr, uLen) == 0;
+}
+
+dmbObject* dmbCreateStringIntObject(dmbLONG lValue)
+{
+    dmbObject *o;
+
+    if (lValue >= 0 && lValue < DMB_OBJ_SHARED_INTEGERS)
+        return &g_shared_integers[lValue];
+
+    o = (dmbObject*)dmbMalloc(sizeof(dmbObject));
+    if (o != NULL)
+    {
+        o->type = DMB_OBJ_TYPE_STRING;
+        o->encode = DMB_OBJ_ENCODE_INT;
+        o->published = FALSE;
+        o->ref = 1;
+        o->num = lValue;
+    }
+    return o;
+}
+
+dmbObject* dmbCreateStringValueObject(dmbCHAR *pcStr, dmbUINT uLen)
+{
+    dmbLONG lValue;
+
+    if (string2Long(pcStr, uLen, &lValue))
+        return dmbCreateStringIntObject(lValue);
+
+    return dmbCreateStringObject(pcStr, uLen);
+}
+
+void dmbStringObjectGetData(dmbObject *o, dmbCHAR *pcBuf, const dmbCHAR **pData, dmbUINT *pLen)
+{
+    if (o->encode == DMB_OBJ_ENCODE_INT)
+    {
+        *pLen = DMB_OBJ_INT_STR_SIZE;
+        dmbLong2Str(o->num, pcBuf, pLen);
+        *pData = pcBuf;
+        return;
+    }
+
+    dmbStringGetData((dmbString*)o->ptr, pData, pLen);
+}
+
+dmbCode dmbStringObjectIncrBy(dmbObject **ppObj, dmbLONG lDelta)
+{
+    dmbObject *o = *ppObj, *pNew;
+    dmbString *pStr;
+    dmbLONG lValue;
+
+    if (o->encode == DMB_OBJ_ENCODE_INT)
+    {
+        lValue = o->num;
+    }
+    else
+    {
+        pStr = (dmbString*)o->ptr;
+        if (!string2Long(dmbStringGet(pStr), dmbStringLength(pStr), &lValue))
+            return DMB_ERRCODE_CONVERT_TYPE_ERROR;
+    }
+
+    //LONG_MIN has no canonical text either
+    if ((lDelta > 0 && lValue > LONG_MAX - lDelta) || (lDelta < 0 && lValue <= LONG_MIN - lDelta))
+        return DMB_ERRCODE_STRING_INCR_OVERFLOW;
+    lValue += lDelta;
+
+    //nobody else sees this object, update it in place
+    if (o->encode == DMB_OBJ_ENCODE_INT && o->ref == 1 && (lValue < 0 || lValue >= DMB_OBJ_SHARED_INTEGERS))
+    {
+        o->num = lValue;
+        return DMB_ERRCODE_OK;
+    }
+
+    pNew = dmbCreateStringIntObject(lValue);
+    if (pNew == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    dmbObjectRelease(o);
+    *ppObj = pNew;
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbObject* dmbCreateZsetObject()
+{
+    dmbObject *o = (dmbObject*)dmbMalloc(sizeof(dmbObject));
+    if (o != NULL)
+    {
+        o->ptr = dmbZsetCreate();
+        if (o->ptr == NULL)
+        {
+            dmbFree(o);
+            return NULL;
+        }
+
+        o->type = DMB_OBJ_TYPE_ZSET;
+        o->encode = ((dmbZset*)o->ptr)->encode;
+        o->published = FALSE;
+        o->ref = 1;
+    }
+    return o;
+}
+
+dmbObject* dmbCreateMapObject()
+{
+    dmbObject *o = (dmbObject*)dmbMalloc(sizeof(dmbObject));
+    if (o != NULL)
+    {
+        o->ptr = dmbMapCreate();
+        if (o->ptr == NULL)
+        {
+            dmbFree(o);
+            return NULL;
+        }
+
+        o->type = DMB_OBJ_TYPE_MAP;
+        o->encode = ((dmbMap*)o->ptr)->encode;
+        o->published = FALSE;
+        o->ref = 1;
+    }
+    return o;
+}
+
+dmbObject* dmbCreateListObject()
+{
+    dmbObject *o = (dmbObject*)dmbMalloc(sizeof(dmbObject));
+    if (o != NULL)
+    {
+        o->ptr = dmbSegListCreate();
+        if (o->ptr == NULL)
+        {
+            dmbFree(o);
+            return NULL;
+        }
+
+        o->type = DMB_OBJ_TYPE_LIST;
+        o->encode = DMB_OBJ_ENCODE_SEGLIST;
+        o->published = FALSE;
         o->ref = 1;
     }
     return o;
 }
 
+dmbUINT32 dmbObjectEncoding(dmbObject *o)
+{
+    switch (o->type)
+    {
+    case DMB_OBJ_TYPE_ZSET:
+        return ((dmbZset*)o->ptr)->encode;
+    case DMB_OBJ_TYPE_MAP:
+        return ((dmbMap*)o->ptr)->encode;
+    default:
+        return o->encode;
+    }
+}
+
 void dmbDestroyIntObject(dmbObject *o)
 {
     dmbFree(o);
@@ -115,6 +349,7 @@ void dmbDestroyIntObject(dmbObject *o)
 
 void dmbDestroyStringObject(dmbObject *o)
 {
+    //an EMBSTR string goes away with the object, an INT one has none
     if (o->encode == DMB_OBJ_ENCODE_STRING)
         dmbStringDestroy((dmbString*)o->ptr);
     dmbFree(o);
@@ -122,7 +357,8 @@ void dmbDestroyStringObject(dmbObject *o)
 
 void dmbDestroyListObject(dmbObject *o)
 {
-    DMB_UNUSED(o);
+    dmbSegListDestroy((dmbSegList*)o->ptr);
+    dmbFree(o);
 }
 
 void dmbDestroySetObject(dmbObject *o)
@@ -132,10 +368,12 @@ void dmbDestroySetObject(dmbObject *o)
 
 void dmbDestroyZsetObject(dmbObject *o)
 {
-    DMB_UNUSED(o);
+    dmbZsetDestroy((dmbZset*)o->ptr);
+    dmbFree(o);
 }
 
 void dmbDestroyMapObject(dmbObject *o)
 {
-    DMB_UNUSED(o);
+    dmbMapDestroy((dmbMap*)o->ptr);
+    dmbFree(o);
 }
@@ -19,6 +19,7 @@
 #define DMBOBJECT_H
 
 #include "dmbdefines.h"
+#include <limits.h>
 
 #define DMB_OBJ_TYPE_BEGIN              0//起始
 
@@ -33,22 +34,90 @@
 
 #define DMB_OBJ_ENCODE_INT           101
 #define DMB_OBJ_ENCODE_STRING        102
+#define DMB_OBJ_ENCODE_SKIPLIST      103
+#define DMB_OBJ_ENCODE_BINLIST       104
+#define DMB_OBJ_ENCODE_DICT          105
+#define DMB_OBJ_ENCODE_BTREE         106
+#define DMB_OBJ_ENCODE_SEGLIST       107
+#define DMB_OBJ_ENCODE_EMBSTR        108
+
+//不超过该长度的字串与对象头在同一次分配中，ptr指向对象之后的dmbString
+#define DMB_OBJ_EMBSTR_MAX           44
+
+//[0, DMB_OBJ_SHARED_INTEGERS)的整数字串使用共享对象，不会被释放
+#define DMB_OBJ_SHARED_INTEGERS      10000
+//共享对象的引用计数，Retain和Release直接跳过
+#define DMB_OBJ_REF_SHARED           LONG_MAX
+//INT编码字串转为文本所需的缓冲区大小
+#define DMB_OBJ_INT_STR_SIZE         32
 
 typedef struct {
     dmbRef ref;
     dmbUINT32 type : 4;
-    dmbUINT32 encode : 28;
+    //0 while only the creating thread can reach the object, ref is then counted without atomics
+    dmbUINT32 published : 1;
+    dmbUINT32 encode : 27;
     union {
         volatile void *ptr;
         volatile dmbLONG num;
     };
 } dmbObject;
 
+/**
+ * @brief dmbObjectInitShared 初始化共享整数对象，需在创建任何对象之前调用
+ */
+void dmbObjectInitShared();
+
+static inline dmbBOOL dmbObjectIsShared(dmbObject *o)
+{
+    return o->ref == DMB_OBJ_REF_SHARED;
+}
+
+/**
+ * @brief dmbObjectPublish 对象交给其他线程之前调用，之后引用计数改用原子操作，不可撤销。
+ *        只发布对象本身，dmbDLList中的对象需要分别发布
+ */
+void dmbObjectPublish(dmbObject *o);
+
 dmbBOOL dmbObjectRetain(dmbObject *o);
 dmbBOOL dmbObjectRelease(dmbObject *o);
 
 dmbObject* dmbCreateIntObject(dmbLONG lValue);
+/**
+ * @brief dmbCreateStringObject 短字串使用EMBSTR编码，其余使用独立分配的dmbString，两种编码的ptr都指向dmbString
+ */
 dmbObject* dmbCreateStringObject(dmbCHAR *pcStr, dmbUINT uLen);
+/**
+ * @brief dmbCreateStringValueObject 用于值：能按dmbString2Long解析且转换回来不变的字串使用INT编码，
+ *        其余同dmbCreateStringObject。键请使用dmbCreateStringObject，字典元信息需要ptr指向dmbString
+ */
+dmbObject* dmbCreateStringValueObject(dmbCHAR *pcStr, dmbUINT uLen);
+
+/**
+ * @brief dmbCreateStringIntObject INT编码的字串，小整数返回共享对象
+ */
+dmbObject* dmbCreateStringIntObject(dmbLONG lValue);
+
+/**
+ * @brief dmbStringObjectGetData 字串对象的内容，INT编码时写入pcBuf（至少DMB_OBJ_INT_STR_SIZE字节）
+ */
+void dmbStringObjectGetData(dmbObject *o, dmbCHAR *pcBuf, const dmbCHAR **pData, dmbUINT *pLen);
+
+/**
+ * @brief dmbStringObjectIncrBy 整数字串加上lDelta，*ppObj可能被替换为新对象（原对象已释放），
+ *        结果在共享范围内或对象未被共享时不分配内存
+ * @return 不是整数返回DMB_ERRCODE_CONVERT_TYPE_ERROR，溢出返回DMB_ERRCODE_STRING_INCR_OVERFLOW
+ */
+dmbCode dmbStringObjectIncrBy(dmbObject **ppObj, dmbLONG lDelta);
+
+dmbObject* dmbCreateZsetObject();
+dmbObject* dmbCreateMapObject();
+dmbObject* dmbCreateListObject();
+
+/**
+ * @brief dmbObjectEncoding 对象当前的编码，zset和map的容器会自行从binlist转换，以容器记录的编码为准
+ */
+dmbUINT32 dmbObjectEncoding(dmbObject *o);
 void dmbDestroyIntObject(dmbObject *o);
 void dmbDestroyStringObject(dmbObject *o);
 void dmbDestroyListObject(dmbObject *o);
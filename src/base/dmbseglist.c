@@ -0,0 +1,717 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <pthread.h>
+#include "dmbseglist.h"
+#include "dmbsettings.h"
+#include "core/dmballoc.h"
+
+//integers of up to 18 digits always fit an int64 entry
+#define SEGLIST_INT_MAX_DIGITS 18
+//large enough for any int64 in decimal
+#define SEGLIST_NUM_BUF 32
+//entries a reverse scan collects on the stack
+#define SEGLIST_STACK_ENTRIES 256
+//segments below this size are never worth a decode
+#define SEGLIST_COMPRESS_MIN 512
+//upper bound of an entry head
+#define SEGLIST_ENTRY_HEAD_MAX 9
+//free directory slots at each end of a fresh positional index
+#define SEGLIST_INDEX_SPARE 16
+
+static dmbLzfAllocator g_seglist_lzf;
+static pthread_once_t g_seglist_lzf_once = PTHREAD_ONCE_INIT;
+
+static void initLzf()
+{
+    dmbInitLzfAllocator(&g_seglist_lzf, SEGLIST_COMPRESS_MIN);
+}
+
+static inline dmbSegment* segFirst(dmbSegList *pList)
+{
+    return dmbListIsEmpty(&pList->segments) ? NULL : dmbListEntry(pList->segments.pNext, dmbSegment, node);
+}
+
+static inline dmbSegment* segLast(dmbSegList *pList)
+{
+    return dmbListIsEmpty(&pList->segments) ? NULL : dmbListEntry(pList->segments.pPrev, dmbSegment, node);
+}
+
+static inline dmbSegment* segNext(dmbSegList *pList, dmbSegment *pSeg)
+{
+    return pSeg->node.pNext == &pList->segments ? NULL : dmbListEntry(pSeg->node.pNext, dmbSegment, node);
+}
+
+static inline dmbSegment* segPrev(dmbSegList *pList, dmbSegment *pSeg)
+{
+    return pSeg->node.pPrev == &pList->segments ? NULL : dmbListEntry(pSeg->node.pPrev, dmbSegment, node);
+}
+
+static void indexDrop(dmbSegList *pList)
+{
+    if (pList->index.slots == NULL)
+        return;
+
+    dmbFree(pList->index.slots);
+    pList->index.slots = NULL;
+    dmbFenwickClear(&pList->index.counts);
+}
+
+//lays the segments out in the middle of a directory with room at both ends
+static void indexBuild(dmbSegList *pList)
+{
+    dmbUINT uCapacity = pList->count * 2 + SEGLIST_INDEX_SPARE * 2, uSlot;
+    dmbSegment **ppSlots, *pSeg;
+
+    indexDrop(pList);
+    ppSlots = (dmbSegment**)dmbMalloc(sizeof(dmbSegment*) * uCapacity);
+    if (ppSlots == NULL)
+        return;
+    if (dmbFenwickInit(&pList->index.counts, uCapacity) != DMB_ERRCODE_OK)
+    {
+        dmbFree(ppSlots);
+        return;
+    }
+
+    uSlot = (uCapacity - pList->count) / 2;
+    pList->index.first = uSlot;
+    dmbListForeachEntry(pSeg, &pList->segments, node)
+    {
+        pSeg->slot = uSlot;
+        ppSlots[uSlot] = pSeg;
+        dmbFenwickAdd(&pList->index.counts, uSlot, dmbBinlistLen(pSeg->bl));
+        ++uSlot;
+    }
+    pList->index.last = uSlot;
+    pList->index.slots = ppSlots;
+}
+
+static inline void indexAdd(dmbSegList *pList, dmbSegment *pSeg, dmbLONG lDelta)
+{
+    if (pList->index.slots != NULL)
+        dmbFenwickAdd(&pList->index.counts, pSeg->slot, lDelta);
+}
+
+//the last segment changed other than at its end
+static inline void tailReset(dmbSegList *pList, dmbSegment *pSeg)
+{
+    if (pSeg == segLast(pList))
+        pList->tail.num = 0;
+}
+
+static void segDestroy(dmbSegList *pList, dmbSegment *pSeg)
+{
+    tailReset(pList, pSeg);
+    if (pList->index.slots != NULL)
+    {
+        if (pSeg->slot == pList->index.first)
+            pList->index.first++;
+        else if (pSeg->slot + 1 == pList->index.last)
+            pList->index.last--;
+        else
+            indexDrop(pList);
+        indexAdd(pList, pSeg, -(dmbLONG)dmbBinlistLen(pSeg->bl));
+    }
+    dmbListRemove(&pSeg->node);
+    dmbBinlistDestroy(pList->allocator, pSeg->bl);
+    dmbFree(pSeg);
+    pList->count--;
+}
+
+//compresses pSeg unless it lies within compressDepth segments of an end
+static void segCompress(dmbSegList *pList, dmbSegment *pSeg)
+{
+    dmbSegment *pFront = pSeg, *pBack = pSeg;
+    dmbUINT i;
+
+    if (pList->compressDepth == 0 || pSeg->incompressible || dmbBinlistIsCompressed(pSeg->bl))
+        return;
+
+    for (i = 0; i < pList->compressDepth; ++i)
+    {
+        pFront = segPrev(pList, pFront);
+        pBack = segNext(pList, pBack);
+        if (pFront == NULL || pBack == NULL)
+            return;
+    }
+
+    //a failed compression leaves the segment as it was
+    dmbBinlistCompress(pList->allocator, &pSeg->bl);
+    pSeg->incompressible = !dmbBinlistIsCompressed(pSeg->bl);
+}
+
+static inline dmbCode segOpen(dmbSegList *pList, dmbSegment *pSeg)
+{
+    return dmbBinlistDecompress(pList->allocator, &pSeg->bl);
+}
+
+static dmbSegment* segAdd(dmbSegList *pList, dmbBOOL bFront)
+{
+    dmbSegment *pSeg = (dmbSegment*)dmbMalloc(sizeof(dmbSegment)), *pInner;
+    dmbUINT i;
+
+    if (pSeg == NULL)
+        return NULL;
+
+    pSeg->bl = dmbBinlistCreate(pList->allocator);
+    if (pSeg->bl == NULL)
+    {
+        dmbFree(pSeg);
+        return NULL;
+    }
+    pSeg->incompressible = FALSE;
+
+    if (bFront)
+        dmbListPushFront(&pList->segments, &pSeg->node);
+    else
+        dmbListPushBack(&pList->segments, &pSeg->node);
+    pList->count++;
+    tailReset(pList, pSeg);
+
+    if (pList->index.slots != NULL)
+    {
+        //a full end of the directory recentres it
+        if (bFront ? pList->index.first == 0 : pList->index.last == pList->index.counts.size)
+        {
+            indexBuild(pList);
+        }
+        else
+        {
+            pSeg->slot = bFront ? --pList->index.first : pList->index.last++;
+            pList->index.slots[pSeg->slot] = pSeg;
+        }
+    }
+
+    //the segment compressDepth steps in has just left the uncompressed end
+    if (pList->compressDepth > 0)
+    {
+        pInner = pSeg;
+        for (i = 0; i < pList->compressDepth && pInner != NULL; ++i)
+            pInner = bFront ? segNext(pList, pInner) : segPrev(pList, pInner);
+        if (pInner != NULL)
+            segCompress(pList, pInner);
+    }
+
+    return pSeg;
+}
+
+//segment holding lIndex (0 <= lIndex < len), walking from the nearer end
+static dmbSegment* segFind(dmbSegList *pList, dmbLONG lIndex, dmbUINT *pOffset)
+{
+    dmbSegment *pSeg;
+    dmbLONG lPos;
+    dmbUINT uSlot;
+
+    if (pList->index.slots == NULL && g_settings.list_index_min_segments > 0
+            && pList->count >= g_settings.list_index_min_segments)
+        indexBuild(pList);
+
+    if (pList->index.slots != NULL)
+    {
+        uSlot = dmbFenwickFind(&pList->index.counts, lIndex, &lPos);
+        *pOffset = (dmbUINT)(lIndex - lPos);
+        return pList->index.slots[uSlot];
+    }
+
+    if (lIndex < pList->len / 2)
+    {
+        pSeg = segFirst(pList);
+        lPos = 0;
+        while (lPos + dmbBinlistLen(pSeg->bl) <= lIndex)
+        {
+            lPos += dmbBinlistLen(pSeg->bl);
+            pSeg = segNext(pList, pSeg);
+        }
+    }
+    else
+    {
+        pSeg = segLast(pList);
+        lPos = pList->len - dmbBinlistLen(pSeg->bl);
+        while (lPos > lIndex)
+        {
+            pSeg = segPrev(pList, pSeg);
+            lPos -= dmbBinlistLen(pSeg->bl);
+        }
+    }
+
+    *pOffset = (dmbUINT)(lIndex - lPos);
+    return pSeg;
+}
+
+//canonical decimal only, so the value reads back exactly as it was pushed
+static dmbBOOL parseInt(const dmbCHAR *pcValue, dmbUINT uLen, dmbINT64 *pValue)
+{
+    dmbUINT i = 0;
+    dmbINT64 value = 0;
+    dmbBOOL bNeg = FALSE;
+
+    if (uLen > 0 && pcValue[0] == '-')
+    {
+        bNeg = TRUE;
+        i = 1;
+    }
+
+    if (uLen == i || uLen - i > SEGLIST_INT_MAX_DIGITS)
+        return FALSE;
+
+    //no leading zeros and no "-0"
+    if (pcValue[i] == '0' && (uLen - i > 1 || bNeg))
+        return FALSE;
+
+    for (; i < uLen; ++i)
+    {
+        if (pcValue[i] < '0' || pcValue[i] > '9')
+            return FALSE;
+        value = value * 10 + (pcValue[i] - '0');
+    }
+
+    *pValue = bNeg ? -value : value;
+    return TRUE;
+}
+
+static dmbCode makeItem(dmbBinItem *pItem, const dmbCHAR *pcValue, dmbUINT uLen)
+{
+    dmbINT64 value;
+
+    if (uLen == 0)
+        return DMB_ERRCODE_BINENTRY_IS_EMPTY;
+
+    if (!parseInt(pcValue, uLen, &value))
+        return dmbBinItemStr(pItem, (dmbBYTE*)pcValue, uLen);
+
+    if (value == (dmbINT16)value)
+        DMB_BINITEM_I16(pItem, (dmbINT16)value);
+    else if (value == (dmbINT32)value)
+        DMB_BINITEM_I32(pItem, (dmbINT32)value);
+    else
+        DMB_BINITEM_I64(pItem, value);
+
+    return DMB_ERRCODE_OK;
+}
+
+//integer entries are printed into pcBuf of SEGLIST_NUM_BUF bytes
+static void entryValue(dmbBinEntry *pEntry, dmbCHAR *pcBuf, const dmbCHAR **ppcValue, dmbUINT *pLen)
+{
+    dmbBinVar var;
+    dmbLONG value;
+    dmbUINT uSize = SEGLIST_NUM_BUF;
+
+    dmbBinEntryGet(pEntry, &var);
+    switch (DMB_BINCODE(pEntry))
+    {
+    case DMB_BINCODE_I16:
+        value = var.i16;
+        break;
+    case DMB_BINCODE_I32:
+        value = var.i32;
+        break;
+    case DMB_BINCODE_I64:
+        value = var.i64;
+        break;
+    default:
+        *ppcValue = (const dmbCHAR*)var.data;
+        *pLen = var.len;
+        return;
+    }
+
+    dmbLong2Str(value, pcBuf, &uSize);
+    *ppcValue = pcBuf;
+    *pLen = uSize;
+}
+
+static dmbString* entryCopy(dmbBinEntry *pEntry)
+{
+    dmbCHAR buf[SEGLIST_NUM_BUF];
+    const dmbCHAR *pcValue;
+    dmbUINT uLen;
+
+    entryValue(pEntry, buf, &pcValue, &uLen);
+    return dmbStringCreateWithBuffer(pcValue, uLen);
+}
+
+//same bounds as dmbZsetRangeByRank, FALSE when nothing is covered
+static dmbBOOL normalizeRange(dmbSegList *pList, dmbLONG *pStart, dmbLONG *pEnd)
+{
+    if (*pStart < 0)
+        *pStart += pList->len;
+    if (*pEnd < 0)
+        *pEnd += pList->len;
+
+    if (*pStart < 0 || *pStart >= pList->len)
+        return FALSE;
+    if (*pEnd < 0 || *pEnd >= pList->len)
+        *pEnd = pList->len - 1;
+
+    return *pStart <= *pEnd;
+}
+
+dmbSegList* dmbSegListCreate()
+{
+    dmbSegList *pList = (dmbSegList*)dmbMalloc(sizeof(dmbSegList));
+    if (pList == NULL)
+        return NULL;
+
+    dmbListInit(&pList->segments);
+    pList->count = 0;
+    pList->len = 0;
+    pList->compressDepth = g_settings.list_compress_depth;
+    dmbBinlistIndexInit(&pList->tail, 1);
+    pList->index.slots = NULL;
+    if (pList->compressDepth > 0)
+    {
+        pthread_once(&g_seglist_lzf_once, initLzf);
+        pList->allocator = &g_seglist_lzf.allocator;
+    }
+    else
+    {
+        pList->allocator = DMB_DEFAULT_BINALLOCATOR;
+    }
+
+    return pList;
+}
+
+void dmbSegListDestroy(dmbSegList *pList)
+{
+    dmbSegment *pSeg;
+
+    while ((pSeg = segFirst(pList)) != NULL)
+        segDestroy(pList, pSeg);
+
+    dmbBinlistIndexClear(&pList->tail);
+    indexDrop(pList);
+    dmbFree(pList);
+}
+
+dmbLONG dmbSegListSize(dmbSegList *pList)
+{
+    return pList->len;
+}
+
+static dmbCode push(dmbSegList *pList, const dmbCHAR *pcValue, dmbUINT uLen, dmbBOOL bFront)
+{
+    dmbSegment *pSeg = bFront ? segFirst(pList) : segLast(pList);
+    dmbBinItem item;
+    dmbCode code;
+
+    code = makeItem(&item, pcValue, uLen);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    if (pSeg != NULL)
+    {
+        code = segOpen(pList, pSeg);
+        if (code != DMB_ERRCODE_OK)
+            return code;
+    }
+
+    //a value larger than a whole segment still gets one of its own
+    if (pSeg == NULL || (dmbBinlistLen(pSeg->bl) > 0
+                         && dmbBinlistRawSize(pSeg->bl) + uLen + SEGLIST_ENTRY_HEAD_MAX > g_settings.list_max_segment_size))
+    {
+        pSeg = segAdd(pList, bFront);
+        if (pSeg == NULL)
+            return DMB_ERRCODE_ALLOC_FAILED;
+    }
+
+    //appends leave the tail offsets valid, the missing ones are added on the next pop
+    if (bFront)
+        tailReset(pList, pSeg);
+    pSeg->incompressible = FALSE;
+    code = dmbBinlistInsertAt(pList->allocator, &pSeg->bl, bFront ? dmbBinlistFirst(pSeg->bl) : NULL, &item, 1);
+    if (code != DMB_ERRCODE_OK)
+    {
+        if (dmbBinlistLen(pSeg->bl) == 0)
+            segDestroy(pList, pSeg);
+        return code;
+    }
+
+    indexAdd(pList, pSeg, 1);
+    pList->len++;
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbSegListPushBack(dmbSegList *pList, const dmbCHAR *pcValue, dmbUINT uLen)
+{
+    return push(pList, pcValue, uLen, FALSE);
+}
+
+dmbCode dmbSegListPushFront(dmbSegList *pList, const dmbCHAR *pcValue, dmbUINT uLen)
+{
+    return push(pList, pcValue, uLen, TRUE);
+}
+
+static dmbString* pop(dmbSegList *pList, dmbBOOL bFront)
+{
+    dmbSegment *pSeg = bFront ? segFirst(pList) : segLast(pList);
+    dmbBinEntry *pEntry;
+    dmbString *pStr;
+    dmbUINT uLen;
+    dmbCode code;
+
+    if (pSeg == NULL || segOpen(pList, pSeg) != DMB_ERRCODE_OK)
+        return NULL;
+
+    uLen = dmbBinlistLen(pSeg->bl);
+    if (bFront)
+    {
+        pEntry = dmbBinlistFirst(pSeg->bl);
+    }
+    else
+    {
+        if (pList->tail.num != uLen && dmbBinlistIndexUpdate(&pList->tail, pSeg->bl, pList->tail.num) != DMB_ERRCODE_OK)
+            return NULL;
+        pEntry = pSeg->bl + pList->tail.offsets[uLen - 1];
+    }
+
+    pStr = entryCopy(pEntry);
+    if (pStr == NULL)
+        return NULL;
+
+    if (uLen == 1)
+    {
+        segDestroy(pList, pSeg);
+    }
+    else
+    {
+        pSeg->incompressible = FALSE;
+        if (bFront)
+        {
+            tailReset(pList, pSeg);
+            code = dmbBinlistDeleteRange(pList->allocator, &pSeg->bl, pEntry, 1);
+        }
+        else
+        {
+            code = dmbBinlistTruncate(pList->allocator, &pSeg->bl, pSeg->bl + pList->tail.offsets[uLen - 2]);
+            pList->tail.num--;
+        }
+
+        if (code != DMB_ERRCODE_OK)
+        {
+            dmbStringDestroy(pStr);
+            return NULL;
+        }
+        indexAdd(pList, pSeg, -1);
+    }
+
+    pList->len--;
+    return pStr;
+}
+
+dmbString* dmbSegListPopBack(dmbSegList *pList)
+{
+    return pop(pList, FALSE);
+}
+
+dmbString* dmbSegListPopFront(dmbSegList *pList)
+{
+    return pop(pList, TRUE);
+}
+
+dmbString* dmbSegListIndex(dmbSegList *pList, dmbLONG lIndex)
+{
+    dmbSegment *pSeg;
+    dmbUINT uOffset;
+    dmbString *pStr;
+
+    if (lIndex < 0)
+        lIndex += pList->len;
+    if (lIndex < 0 || lIndex >= pList->len)
+        return NULL;
+
+    pSeg = segFind(pList, lIndex, &uOffset);
+    if (segOpen(pList, pSeg) != DMB_ERRCODE_OK)
+        return NULL;
+
+    pStr = entryCopy(dmbBinlistGet(pSeg->bl, uOffset));
+    segCompress(pList, pSeg);
+    return pStr;
+}
+
+static dmbCode scanForward(dmbSegment *pSeg, dmbUINT uOffset, dmbLONG *pLeft, dmbSegListScanFunc fn, void *pData)
+{
+    dmbBinEntry *pEntry = dmbBinlistGet(pSeg->bl, uOffset);
+    dmbCHAR buf[SEGLIST_NUM_BUF];
+    const dmbCHAR *pcValue;
+    dmbUINT uLen;
+    dmbCode code;
+
+    while (pEntry != NULL && *pLeft > 0)
+    {
+        entryValue(pEntry, buf, &pcValue, &uLen);
+        code = fn(pData, pcValue, uLen);
+        if (code != DMB_ERRCODE_OK)
+            return code;
+
+        --(*pLeft);
+        pEntry = dmbBinlistNext(pEntry);
+    }
+
+    return DMB_ERRCODE_OK;
+}
+
+//entries only link forward, collect entries 0..uOffset and hand them out backwards
+static dmbCode scanBackward(dmbSegment *pSeg, dmbUINT uOffset, dmbLONG *pLeft, dmbSegListScanFunc fn, void *pData)
+{
+    dmbBinEntry *stackEntries[SEGLIST_STACK_ENTRIES], **ppEntries = stackEntries, *pEntry;
+    dmbCHAR buf[SEGLIST_NUM_BUF];
+    const dmbCHAR *pcValue;
+    dmbUINT uLen, i;
+    dmbCode code = DMB_ERRCODE_OK;
+
+    if (uOffset >= SEGLIST_STACK_ENTRIES)
+    {
+        ppEntries = (dmbBinEntry**)dmbMalloc(sizeof(dmbBinEntry*) * (uOffset + 1));
+        if (ppEntries == NULL)
+            return DMB_ERRCODE_ALLOC_FAILED;
+    }
+
+    pEntry = dmbBinlistFirst(pSeg->bl);
+    for (i = 0; i <= uOffset; ++i)
+    {
+        ppEntries[i] = pEntry;
+        pEntry = dmbBinlistNext(pEntry);
+    }
+
+    for (i = uOffset + 1; i > 0 && *pLeft > 0; --i)
+    {
+        entryValue(ppEntries[i - 1], buf, &pcValue, &uLen);
+        code = fn(pData, pcValue, uLen);
+        if (code != DMB_ERRCODE_OK)
+            break;
+        --(*pLeft);
+    }
+
+    if (ppEntries != stackEntries)
+        dmbFree(ppEntries);
+
+    return code;
+}
+
+dmbCode dmbSegListRange(dmbSegList *pList, dmbLONG start, dmbLONG end, dmbBOOL reverse, dmbSegListScanFunc fn, void *pData)
+{
+    dmbSegment *pSeg;
+    dmbUINT uOffset;
+    dmbLONG lLeft;
+    dmbCode code = DMB_ERRCODE_OK;
+
+    if (!normalizeRange(pList, &start, &end))
+        return DMB_ERRCODE_OK;
+
+    pSeg = segFind(pList, reverse ? end : start, &uOffset);
+    lLeft = end - start + 1;
+    while (lLeft > 0 && code == DMB_ERRCODE_OK)
+    {
+        code = segOpen(pList, pSeg);
+        if (code != DMB_ERRCODE_OK)
+            break;
+
+        if (reverse)
+            code = scanBackward(pSeg, uOffset, &lLeft, fn, pData);
+        else
+            code = scanForward(pSeg, uOffset, &lLeft, fn, pData);
+        segCompress(pList, pSeg);
+
+        pSeg = reverse ? segPrev(pList, pSeg) : segNext(pList, pSeg);
+        if (pSeg == NULL)
+            break;
+        uOffset = reverse ? dmbBinlistLen(pSeg->bl) - 1 : 0;
+    }
+
+    return code == DMB_ERRCODE_LIST_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+}
+
+dmbCode dmbSegListEncodeRange(dmbSegList *pList, dmbLONG start, dmbLONG end, dmbBinAllocator *pAllocator, dmbBinlist **pDest)
+{
+    dmbSegment *pSeg;
+    dmbUINT uOffset, uLen, uCount;
+    dmbLONG lLeft;
+    dmbCode code;
+
+    if (!normalizeRange(pList, &start, &end))
+        return DMB_ERRCODE_OK;
+
+    pSeg = segFind(pList, start, &uOffset);
+    lLeft = end - start + 1;
+    while (lLeft > 0 && pSeg != NULL)
+    {
+        code = segOpen(pList, pSeg);
+        if (code != DMB_ERRCODE_OK)
+            return code;
+
+        uLen = dmbBinlistLen(pSeg->bl);
+        uCount = uLen - uOffset < lLeft ? uLen - uOffset : (dmbUINT)lLeft;
+        code = dmbBinlistAppendRange(pAllocator, pDest, dmbBinlistGet(pSeg->bl, uOffset), uCount);
+        segCompress(pList, pSeg);
+        if (code != DMB_ERRCODE_OK)
+            return code;
+
+        lLeft -= uCount;
+        uOffset = 0;
+        pSeg = segNext(pList, pSeg);
+    }
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbLONG dmbSegListRemoveRange(dmbSegList *pList, dmbLONG start, dmbLONG end)
+{
+    dmbSegment *pSeg, *pNext;
+    dmbUINT uOffset, uLen, uCount;
+    dmbLONG lLeft, lRemoved = 0;
+
+    if (!normalizeRange(pList, &start, &end))
+        return 0;
+
+    pSeg = segFind(pList, start, &uOffset);
+    lLeft = end - start + 1;
+    while (lLeft > 0 && pSeg != NULL)
+    {
+        pNext = segNext(pList, pSeg);
+        uLen = dmbBinlistLen(pSeg->bl);
+        uCount = uLen - uOffset < lLeft ? uLen - uOffset : (dmbUINT)lLeft;
+
+        //whole segments go without being decoded
+        if (uOffset == 0 && uCount == uLen)
+        {
+            segDestroy(pList, pSeg);
+        }
+        else
+        {
+            tailReset(pList, pSeg);
+            pSeg->incompressible = FALSE;
+            if (segOpen(pList, pSeg) != DMB_ERRCODE_OK
+                    || dmbBinlistDeleteRange(pList->allocator, &pSeg->bl, dmbBinlistGet(pSeg->bl, uOffset), uCount) != DMB_ERRCODE_OK)
+                break;
+            indexAdd(pList, pSeg, -(dmbLONG)uCount);
+            segCompress(pList, pSeg);
+        }
+
+        pList->len -= uCount;
+        lRemoved += uCount;
+        lLeft -= uCount;
+        uOffset = 0;
+        pSeg = pNext;
+    }
+
+    return lRemoved;
+}
+
+dmbBinCompressStats* dmbSegListCompressStats()
+{
+    pthread_once(&g_seglist_lzf_once, initLzf);
+    return &g_seglist_lzf.stats;
+}
@@ -0,0 +1,120 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBSEGLIST_H
+#define DMBSEGLIST_H
+
+#include "core/dmblist.h"
+#include "core/dmbbinlist.h"
+#include "core/dmbstring.h"
+#include "core/dmbfenwick.h"
+
+/*
+ * List of values kept as a doubly linked list of binlist segments, each up
+ * to list_max_segment_size bytes of g_settings. Pushes and pops work on the
+ * end segments and open or drop a segment when it fills up or runs empty.
+ * Every segment knows its entry count, so reaching an index skips whole
+ * segments from the nearer end. Once a list has list_index_min_segments
+ * segments of g_settings, a Fenwick tree over the segment counts finds
+ * the segment of an index in O(log segments) instead. The segments sit in
+ * the middle of a directory with free slots at both ends, so segments
+ * opened or dropped at the ends keep the tree; dropping one from the
+ * middle rebuilds it on the next lookup.
+ * Values that are canonical decimal integers below 10^18 are stored as
+ * integer entries and come back in the same decimal form. The binlist has
+ * no empty entries, so empty values are refused.
+ * With list_compress_depth of g_settings above 0, the segments more than
+ * that many steps from both ends are LZF compressed through the shared
+ * allocator of dmbSegListCompressStats. Reading one decodes it, and it is
+ * compressed again when the access is done.
+ */
+
+typedef struct dmbSegment {
+    dmbNode node;
+    dmbBinlist *bl;
+    //the last compression saved too little, not tried again until the segment changes
+    dmbBOOL incompressible;
+    //position in the directory of the positional index
+    dmbUINT slot;
+} dmbSegment;
+
+typedef struct dmbSegList {
+    dmbList segments;
+    dmbUINT count;
+    dmbLONG len;
+    //segments kept uncompressed at each end, 0 never compresses
+    dmbUINT compressDepth;
+    dmbBinAllocator *allocator;
+    //entry offsets of the last segment, popping from the back would walk it otherwise
+    dmbBinlistIndex tail;
+    //positional index, slots is NULL while the list has none
+    struct {
+        dmbSegment **slots;
+        dmbUINT first;
+        dmbUINT last;
+        dmbFenwick counts;
+    } index;
+} dmbSegList;
+
+//pcValue is only valid during the call, return DMB_ERRCODE_LIST_SCAN_BREAK to stop
+typedef dmbCode (*dmbSegListScanFunc)(void *pData, const dmbCHAR *pcValue, dmbUINT uLen);
+
+dmbSegList* dmbSegListCreate();
+void dmbSegListDestroy(dmbSegList *pList);
+dmbLONG dmbSegListSize(dmbSegList *pList);
+
+dmbCode dmbSegListPushBack(dmbSegList *pList, const dmbCHAR *pcValue, dmbUINT uLen);
+dmbCode dmbSegListPushFront(dmbSegList *pList, const dmbCHAR *pcValue, dmbUINT uLen);
+
+/**
+ * @brief dmbSegListPopBack 取出最后一个值，调用者负责dmbStringDestroy，空链表返回NULL
+ */
+dmbString* dmbSegListPopBack(dmbSegList *pList);
+
+/**
+ * @brief dmbSegListPopFront 取出第一个值，调用者负责dmbStringDestroy，空链表返回NULL
+ */
+dmbString* dmbSegListPopFront(dmbSegList *pList);
+
+/**
+ * @brief dmbSegListIndex 复制第lIndex个值，负数表示从末尾倒数，越界返回NULL
+ */
+dmbString* dmbSegListIndex(dmbSegList *pList, dmbLONG lIndex);
+
+/**
+ * @brief dmbSegListRange 遍历区间[start, end]，负数表示从末尾倒数，边界处理同dmbZsetRangeByRank，遍历期间不能修改链表
+ */
+dmbCode dmbSegListRange(dmbSegList *pList, dmbLONG start, dmbLONG end, dmbBOOL reverse, dmbSegListScanFunc fn, void *pData);
+
+/**
+ * @brief dmbSegListEncodeRange 把区间[start, end]的元素按binlist entry原样追加到*pDest，不解码也不分配中间对象，
+ *        每个segment只复制一次，边界处理同dmbSegListRange；分配器空间不足时*pDest中只有前面一部分元素
+ */
+dmbCode dmbSegListEncodeRange(dmbSegList *pList, dmbLONG start, dmbLONG end, dmbBinAllocator *pAllocator, dmbBinlist **pDest);
+
+/**
+ * @brief dmbSegListRemoveRange 删除区间[start, end]，整段落在区间内的segment直接释放
+ * @return 删除的个数
+ */
+dmbLONG dmbSegListRemoveRange(dmbSegList *pList, dmbLONG start, dmbLONG end);
+
+/**
+ * @brief dmbSegListCompressStats 所有链表共用的压缩统计，计数以原子操作更新，各项之间不是同一时刻的快照
+ */
+dmbBinCompressStats* dmbSegListCompressStats();
+
+#endif // DMBSEGLIST_H
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #define DEFAULT_CONF_PATH "dmb.conf"
 #define UNIT_KB 1024
@@ -70,6 +71,14 @@ void dmbResetDefaultSettings()
     g_settings.net_write_bufsize = 4194304; //4MB
     g_settings.thread_size = 10;
     g_settings.open_files = 1024;
+    g_settings.zset_max_binlist_entries = 128;
+    g_settings.zset_max_binlist_value = 64;
+    g_settings.map_max_binlist_entries = 128;
+    g_settings.map_max_binlist_value = 64;
+    g_settings.zset_use_btree = 0;
+    g_settings.list_max_segment_size = 8192;
+    g_settings.list_compress_depth = 0;
+    g_settings.list_index_min_segments = 64;
 }
 
 dmbCode CheckConfig()
@@ -77,6 +86,11 @@ dmbCode CheckConfig()
 //    if (g_settings.key_max_size > 32767)
 //        return DMB_ERROR;
 
+    //two binlist entries per member and the entry count is 32 bits; lookups in the
+    //binlist are linear, so useful thresholds stay far below this anyway
+    if (g_settings.zset_max_binlist_entries > UINT_MAX / 2 || g_settings.map_max_binlist_entries > UINT_MAX / 2)
+        return DMB_ERROR;
+
     return DMB_OK;
 }
 
@@ -157,6 +171,14 @@ dmbCode dmbLoadSettings(const dmbCHAR *confPath)
     PARSE_INT(property, g_settings.net_rw_timeout, "net_rw_timeout");
     PARSE_INTSTRING(property, g_settings.net_read_bufsize, "net_read_bufsize");
     PARSE_INTSTRING(property, g_settings.net_write_bufsize, "net_write_bufsize");
+    PARSE_INT(property, g_settings.zset_max_binlist_entries, "zset_max_binlist_entries");
+    PARSE_INT(property, g_settings.zset_max_binlist_value, "zset_max_binlist_value");
+    PARSE_INT(property, g_settings.map_max_binlist_entries, "map_max_binlist_entries");
+    PARSE_INT(property, g_settings.map_max_binlist_value, "map_max_binlist_value");
+    PARSE_INT(property, g_settings.zset_use_btree, "zset_use_btree");
+    PARSE_INTSTRING(property, g_settings.list_max_segment_size, "list_max_segment_size");
+    PARSE_INT(property, g_settings.list_compress_depth, "list_compress_depth");
+    PARSE_INT(property, g_settings.list_index_min_segments, "list_index_min_segments");
 
     dmbSetMaxMemSize((size_t) g_settings.max_mem_size);
 
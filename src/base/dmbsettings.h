@@ -31,6 +31,18 @@ typedef struct dmbSettings{
     dmbUINT net_rw_timeout;
     dmbUINT net_read_bufsize;
     dmbUINT net_write_bufsize;
+    //小有序集与字典使用binlist紧凑编码，超过个数或单个成员长度后转换为skiplist/dict
+    dmbUINT zset_max_binlist_entries;
+    dmbUINT zset_max_binlist_value;
+    dmbUINT map_max_binlist_entries;
+    dmbUINT map_max_binlist_value;
+    //非0时大有序集转换为B+树而不是skiplist
+    dmbUINT zset_use_btree;
+    //链表每个binlist段的最大字节数，两端各list_compress_depth个段之外的段压缩，0不压缩
+    dmbUINT list_max_segment_size;
+    dmbUINT list_compress_depth;
+    //链表段数达到该值后建立位置索引，0不建索引
+    dmbUINT list_index_min_segments;
 } dmbSettings;
 
 void dmbResetDefaultSettings();
@@ -0,0 +1,588 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbzset.h"
+#include "dmbobject.h"
+#include "dmbsettings.h"
+#include "core/dmballoc.h"
+#include "core/dmbdictmetas.h"
+
+#define ZSET_BL_ALLOCATOR DMB_DEFAULT_BINALLOCATOR
+//pairs the binlist range functions index on the stack
+#define ZSET_BL_STACK_PAIRS 128
+
+typedef union {
+    double score;
+    dmbINT64 i64;
+} zsetScore;
+
+static inline dmbZSkipListNode* getNode(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbDictEntry *pEntry = dmbDictGetByData(pZset->dict, pcMember, uLen);
+    return pEntry == NULL ? NULL : DMB_ENTRY(pEntry, dmbZSkipListNode, data);
+}
+
+static dmbCode slInsert(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, double score)
+{
+    dmbZSkipListNode *pNew;
+    dmbString *pMember = dmbStringCreateWithBuffer(pcMember, uLen);
+    dmbCode code;
+
+    if (pMember == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    code = dmbZSkipListInsert(pZset->list, score, pMember, &pNew);
+    if (code != DMB_ERRCODE_OK)
+    {
+        dmbStringDestroy(pMember);
+        return code;
+    }
+
+    dmbDictPut(pZset->dict, &pNew->data);
+    return DMB_ERRCODE_OK;
+}
+
+static dmbCode btInsert(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, double score)
+{
+    dmbDictEntry *pEntry = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry));
+    dmbString *pMember = dmbStringCreateWithBuffer(pcMember, uLen);
+    dmbCode code = pEntry == NULL || pMember == NULL ? DMB_ERRCODE_ALLOC_FAILED : DMB_ERRCODE_OK;
+
+    if (code == DMB_ERRCODE_OK)
+        code = dmbZBTreeInsert(pZset->tree, score, pMember);
+
+    if (code != DMB_ERRCODE_OK)
+    {
+        if (pMember != NULL)
+            dmbStringDestroy(pMember);
+        dmbFree(pEntry);
+        return code;
+    }
+
+    //the tree owns the member string
+    pEntry->k.val = pMember;
+    pEntry->v.d = score;
+    dmbDictPut(pZset->dict, pEntry);
+    return DMB_ERRCODE_OK;
+}
+
+//frees the dict of the btree encoding, its entries own nothing
+static void btPurgeDict(dmbDict *pDict)
+{
+    dmbDictIter iter;
+    dmbDictEntry *pEntry;
+
+    dmbDictInitIter(pDict, &iter);
+    while ((pEntry = dmbDictNext(&iter)) != NULL)
+        dmbFree(pEntry);
+    dmbDictDestroy(pDict);
+}
+
+static inline dmbBinEntry* blFirst(dmbBinlist *pList)
+{
+    return dmbBinlistLen(pList) == 0 ? NULL : dmbBinlistFirst(pList);
+}
+
+static inline void blGetMember(dmbBinEntry *pEntry, const dmbCHAR **ppcMember, dmbUINT *pLen)
+{
+    dmbBinVar var;
+
+    dmbBinEntryGet(pEntry, &var);
+    *ppcMember = (const dmbCHAR*)var.data;
+    *pLen = var.len;
+}
+
+static inline double blGetScore(dmbBinEntry *pEntry)
+{
+    dmbBinVar var;
+    zsetScore s;
+
+    dmbBinEntryGet(pEntry, &var);
+    s.i64 = var.i64;
+    return s.score;
+}
+
+static inline dmbUINT blSize(dmbZset *pZset)
+{
+    return dmbBinlistLen(pZset->bl) / 2;
+}
+
+//pair index of the member, -1 if it does not exist
+static dmbLONG blFind(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, double *pScore)
+{
+    dmbBinEntry *pEntry = blFirst(pZset->bl), *pScoreEntry;
+    const dmbCHAR *pcCur;
+    dmbUINT uCurLen;
+    dmbLONG lIndex = 0;
+
+    while (pEntry != NULL)
+    {
+        pScoreEntry = dmbBinlistNext(pEntry);
+        blGetMember(pEntry, &pcCur, &uCurLen);
+        if (uCurLen == uLen && dmbMemCmp(pcCur, pcMember, uLen) == 0)
+        {
+            if (pScore != NULL)
+                *pScore = blGetScore(pScoreEntry);
+            return lIndex;
+        }
+
+        pEntry = dmbBinlistNext(pScoreEntry);
+        ++lIndex;
+    }
+
+    return -1;
+}
+
+//pair index the member has to be put before, the pair lSkip is ignored
+static dmbLONG blInsertPos(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, double score, dmbLONG lSkip)
+{
+    dmbBinEntry *pEntry = blFirst(pZset->bl), *pScoreEntry;
+    const dmbCHAR *pcCur;
+    dmbUINT uCurLen;
+    dmbLONG lIndex = 0;
+    double curScore;
+
+    while (pEntry != NULL)
+    {
+        pScoreEntry = dmbBinlistNext(pEntry);
+        if (lIndex != lSkip)
+        {
+            curScore = blGetScore(pScoreEntry);
+            if (score < curScore)
+                return lIndex;
+
+            blGetMember(pEntry, &pcCur, &uCurLen);
+            if (score == curScore && dmbStringDumpKeyCompare(pcMember, uLen, pcCur, uCurLen) < 0)
+                return lIndex;
+        }
+
+        pEntry = dmbBinlistNext(pScoreEntry);
+        ++lIndex;
+    }
+
+    return lIndex;
+}
+
+static inline dmbBinEntry* blPair(dmbZset *pZset, dmbLONG lIndex)
+{
+    return dmbBinlistGet(pZset->bl, (dmbUINT)lIndex * 2);
+}
+
+//puts the member before the pair lIndex, blSize appends
+static dmbCode blInsertPair(dmbZset *pZset, dmbLONG lIndex, const dmbCHAR *pcMember, dmbUINT uLen, double score)
+{
+    dmbBinItem items[2];
+    zsetScore s;
+    dmbCode code;
+
+    code = dmbBinItemStr(&items[0], (dmbBYTE*)pcMember, uLen);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    s.score = score;
+    DMB_BINITEM_I64(&items[1], s.i64);
+    return dmbBinlistInsertAt(ZSET_BL_ALLOCATOR, &pZset->bl, lIndex < (dmbLONG)blSize(pZset) ? blPair(pZset, lIndex) : NULL, items, 2);
+}
+
+static inline dmbCode blRemovePair(dmbZset *pZset, dmbLONG lIndex)
+{
+    return dmbBinlistDeleteRange(ZSET_BL_ALLOCATOR, &pZset->bl, blPair(pZset, lIndex), 2);
+}
+
+//moves the pair lIndex to the position of the new score
+static dmbCode blUpdateScore(dmbZset *pZset, dmbLONG lIndex, const dmbCHAR *pcMember, dmbUINT uLen, double score)
+{
+    dmbLONG lInsert = blInsertPos(pZset, pcMember, uLen, score, lIndex);
+    dmbBinItem item;
+    zsetScore s;
+    dmbCode code;
+
+    //the pair keeps its place, only the score entry changes
+    if (lInsert == lIndex || lInsert == lIndex + 1)
+    {
+        s.score = score;
+        DMB_BINITEM_I64(&item, s.i64);
+        return dmbBinlistReplace(ZSET_BL_ALLOCATOR, &pZset->bl, dmbBinlistNext(blPair(pZset, lIndex)), &item);
+    }
+
+    //insert first so the set is untouched if it fails
+    code = blInsertPair(pZset, lInsert, pcMember, uLen, score);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    return blRemovePair(pZset, lInsert < lIndex ? lIndex + 1 : lIndex);
+}
+
+//moves all pairs into a skiplist or btree and a dict, the set keeps its binlist on failure
+static dmbCode blConvert(dmbZset *pZset)
+{
+    dmbBinEntry *pEntry, *pScoreEntry;
+    const dmbCHAR *pcMember;
+    dmbUINT uLen;
+    dmbBOOL bTree = g_settings.zset_use_btree != 0;
+    dmbCode code = DMB_ERRCODE_OK;
+
+    if (bTree)
+        pZset->tree = dmbZBTreeCreate();
+    else
+        pZset->list = dmbZSkipListCreate();
+    pZset->dict = dmbDictCreate(&dmbDictMetaStr, 0);
+    if ((pZset->list == NULL && pZset->tree == NULL) || pZset->dict == NULL)
+        code = DMB_ERRCODE_ALLOC_FAILED;
+
+    //the pairs are sorted, every insert lands at the tail
+    for (pEntry = blFirst(pZset->bl); pEntry != NULL && code == DMB_ERRCODE_OK; pEntry = dmbBinlistNext(pScoreEntry))
+    {
+        pScoreEntry = dmbBinlistNext(pEntry);
+        blGetMember(pEntry, &pcMember, &uLen);
+        code = bTree ? btInsert(pZset, pcMember, uLen, blGetScore(pScoreEntry))
+                     : slInsert(pZset, pcMember, uLen, blGetScore(pScoreEntry));
+    }
+
+    if (code != DMB_ERRCODE_OK)
+    {
+        if (pZset->dict != NULL)
+        {
+            if (bTree)
+                btPurgeDict(pZset->dict);
+            else
+                dmbDictDestroy(pZset->dict);
+        }
+        if (pZset->list != NULL)
+            dmbZSkipListDestroy(pZset->list);
+        if (pZset->tree != NULL)
+            dmbZBTreeDestroy(pZset->tree);
+        pZset->dict = NULL;
+        pZset->list = NULL;
+        pZset->tree = NULL;
+        return code;
+    }
+
+    dmbBinlistDestroy(ZSET_BL_ALLOCATOR, pZset->bl);
+    pZset->bl = NULL;
+    pZset->encode = bTree ? DMB_OBJ_ENCODE_BTREE : DMB_OBJ_ENCODE_SKIPLIST;
+    return DMB_ERRCODE_OK;
+}
+
+//member entries in order, ppBuf is used if it is large enough
+static dmbBinEntry** blIndexPairs(dmbZset *pZset, dmbBinEntry **ppBuf, dmbUINT uBufLen)
+{
+    dmbUINT uSize = blSize(pZset), i;
+    dmbBinEntry **ppPairs = uSize <= uBufLen ? ppBuf : (dmbBinEntry**)dmbMalloc(sizeof(dmbBinEntry*) * uSize);
+    dmbBinEntry *pEntry = blFirst(pZset->bl);
+
+    if (ppPairs == NULL)
+        return NULL;
+
+    for (i=0; i<uSize; ++i)
+    {
+        ppPairs[i] = pEntry;
+        pEntry = dmbBinlistNext(dmbBinlistNext(pEntry));
+    }
+
+    return ppPairs;
+}
+
+//calls fn on the pairs [lStart, lEnd], from lEnd down when reverse
+static dmbCode blScanPairs(dmbBinEntry **ppPairs, dmbLONG lStart, dmbLONG lEnd, dmbBOOL reverse, dmbZsetScanFunc fn, void *pData)
+{
+    dmbLONG i = reverse ? lEnd : lStart, lStep = reverse ? -1 : 1;
+    const dmbCHAR *pcMember;
+    dmbUINT uLen;
+    dmbCode code;
+
+    for (; i >= lStart && i <= lEnd; i += lStep)
+    {
+        blGetMember(ppPairs[i], &pcMember, &uLen);
+        code = fn(pData, blGetScore(dmbBinlistNext(ppPairs[i])), pcMember, uLen);
+        if (code != DMB_ERRCODE_OK)
+            return code == DMB_ERRCODE_SKIPLIST_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+    }
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbZset* dmbZsetCreate()
+{
+    dmbZset *pZset = (dmbZset*)dmbMalloc(sizeof(dmbZset));
+    if (pZset == NULL)
+        return NULL;
+
+    pZset->encode = DMB_OBJ_ENCODE_BINLIST;
+    pZset->list = NULL;
+    pZset->tree = NULL;
+    pZset->dict = NULL;
+    pZset->bl = dmbBinlistCreate(ZSET_BL_ALLOCATOR);
+    if (pZset->bl == NULL)
+    {
+        dmbFree(pZset);
+        return NULL;
+    }
+
+    return pZset;
+}
+
+void dmbZsetDestroy(dmbZset *pZset)
+{
+    if (pZset->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        dmbBinlistDestroy(ZSET_BL_ALLOCATOR, pZset->bl);
+    }
+    else if (pZset->encode == DMB_OBJ_ENCODE_BTREE)
+    {
+        btPurgeDict(pZset->dict);
+        dmbZBTreeDestroy(pZset->tree);
+    }
+    else
+    {
+        //the dict only links entries inside the skiplist nodes
+        dmbDictDestroy(pZset->dict);
+        dmbZSkipListDestroy(pZset->list);
+    }
+    dmbFree(pZset);
+}
+
+dmbLONG dmbZsetSize(dmbZset *pZset)
+{
+    if (pZset->encode == DMB_OBJ_ENCODE_BINLIST)
+        return blSize(pZset);
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BTREE)
+        return dmbZBTreeSize(pZset->tree);
+
+    return dmbZSkipListSize(pZset->list);
+}
+
+dmbCode dmbZsetAdd(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, double score, dmbBOOL *pAdded)
+{
+    dmbZSkipListNode *pNode;
+    dmbDictEntry *pEntry;
+    dmbLONG lIndex;
+    double curScore;
+    dmbCode code;
+
+    //NaN has no place in the order
+    if (score != score)
+        return DMB_ERRCODE_WRONG_ARGUMENT_VALUE;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        lIndex = blFind(pZset, pcMember, uLen, &curScore);
+        if (pAdded != NULL)
+            *pAdded = lIndex < 0;
+
+        if (lIndex >= 0)
+        {
+            if (curScore == score)
+                return DMB_ERRCODE_OK;
+            return blUpdateScore(pZset, lIndex, pcMember, uLen, score);
+        }
+
+        //an empty string has no binlist encoding
+        if (blSize(pZset) < g_settings.zset_max_binlist_entries && uLen <= g_settings.zset_max_binlist_value && uLen > 0)
+            return blInsertPair(pZset, blInsertPos(pZset, pcMember, uLen, score, -1), pcMember, uLen, score);
+
+        code = blConvert(pZset);
+        if (code != DMB_ERRCODE_OK)
+            return code;
+        return pZset->encode == DMB_OBJ_ENCODE_BTREE ? btInsert(pZset, pcMember, uLen, score) : slInsert(pZset, pcMember, uLen, score);
+    }
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BTREE)
+    {
+        pEntry = dmbDictGetByData(pZset->dict, pcMember, uLen);
+        if (pAdded != NULL)
+            *pAdded = pEntry == NULL;
+
+        if (pEntry == NULL)
+            return btInsert(pZset, pcMember, uLen, score);
+
+        if (pEntry->v.d == score)
+            return DMB_ERRCODE_OK;
+
+        //a failed update keeps the member under its old score
+        code = dmbZBTreeUpdateScore(pZset->tree, pEntry->v.d, pcMember, uLen, score);
+        if (code != DMB_ERRCODE_OK)
+            return code;
+
+        pEntry->v.d = score;
+        return DMB_ERRCODE_OK;
+    }
+
+    pNode = getNode(pZset, pcMember, uLen);
+    if (pAdded != NULL)
+        *pAdded = pNode == NULL;
+
+    if (pNode == NULL)
+        return slInsert(pZset, pcMember, uLen, score);
+
+    if (DMB_ZSL_GETSCORE(pNode) == score)
+        return DMB_ERRCODE_OK;
+
+    //the node keeps its address, so its dict entry stays where it is
+    return dmbZSkipListUpdateScore(pZset->list, DMB_ZSL_GETSCORE(pNode), pcMember, uLen, score, NULL);
+}
+
+dmbCode dmbZsetScore(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, double *pScore)
+{
+    dmbDictEntry *pEntry;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BINLIST)
+        return blFind(pZset, pcMember, uLen, pScore) < 0 ? DMB_ERRCODE_ZSETMEMBER_NOT_EXIST : DMB_ERRCODE_OK;
+
+    //both encodings keep the score in the dict entry
+    pEntry = dmbDictGetByData(pZset->dict, pcMember, uLen);
+    if (pEntry == NULL)
+        return DMB_ERRCODE_ZSETMEMBER_NOT_EXIST;
+
+    *pScore = pEntry->v.d;
+    return DMB_ERRCODE_OK;
+}
+
+dmbBOOL dmbZsetRemove(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbDictEntry *pEntry;
+    dmbLONG lIndex;
+    dmbBOOL bRemoved;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        lIndex = blFind(pZset, pcMember, uLen, NULL);
+        return lIndex >= 0 && blRemovePair(pZset, lIndex) == DMB_ERRCODE_OK;
+    }
+
+    pEntry = dmbDictPopByData(pZset->dict, pcMember, uLen);
+    if (pEntry == NULL)
+        return FALSE;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BTREE)
+    {
+        //frees the member string
+        bRemoved = dmbZBTreeRemove(pZset->tree, pEntry->v.d, pcMember, uLen);
+        dmbFree(pEntry);
+        return bRemoved;
+    }
+
+    //frees the node and the member string
+    return dmbZSkipListRemove(pZset->list, pEntry->v.d, pcMember, uLen);
+}
+
+dmbLONG dmbZsetRank(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, dmbBOOL reverse)
+{
+    dmbDictEntry *pEntry;
+    dmbLONG lIndex;
+    dmbUINT rank;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        lIndex = blFind(pZset, pcMember, uLen, NULL);
+        return lIndex < 0 || !reverse ? lIndex : (dmbLONG)blSize(pZset) - 1 - lIndex;
+    }
+
+    pEntry = dmbDictGetByData(pZset->dict, pcMember, uLen);
+    if (pEntry == NULL)
+        return -1;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BTREE)
+        rank = dmbZBTreeGetRank(pZset->tree, pEntry->v.d, pcMember, uLen);
+    else
+        rank = dmbZSkipListGetRank(pZset->list, pEntry->v.d, pcMember, uLen);
+    if (rank == 0)
+        return -1;
+
+    return reverse ? dmbZsetSize(pZset) - rank : (dmbLONG)rank - 1;
+}
+
+dmbLONG dmbZsetCount(dmbZset *pZset, double min, double max)
+{
+    dmbBinEntry *pEntry, *pScoreEntry;
+    dmbLONG lCount = 0;
+    double score;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BINLIST)
+    {
+        for (pEntry = blFirst(pZset->bl); pEntry != NULL; pEntry = dmbBinlistNext(pScoreEntry))
+        {
+            pScoreEntry = dmbBinlistNext(pEntry);
+            score = blGetScore(pScoreEntry);
+            if (score > max)
+                break;
+            lCount += score >= min;
+        }
+        return lCount;
+    }
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BTREE)
+        return dmbZBTreeGetRangeCount(pZset->tree, min, max);
+
+    return dmbZSkipListGetRangeCount(pZset->list, min, max);
+}
+
+dmbCode dmbZsetRangeByScore(dmbZset *pZset, double min, double max, dmbBOOL reverse, dmbZsetScanFunc fn, void *pData)
+{
+    dmbBinEntry *ppBuf[ZSET_BL_STACK_PAIRS], **ppPairs;
+    dmbLONG lStart, lEnd, lSize;
+    dmbCode code;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BTREE)
+        return dmbZBTreeGetRangeByScore(pZset->tree, min, max, reverse, fn, pData);
+    if (pZset->encode != DMB_OBJ_ENCODE_BINLIST)
+        return dmbZSkipListGetRangeByScore(pZset->list, min, max, reverse, fn, pData);
+
+    ppPairs = blIndexPairs(pZset, ppBuf, ZSET_BL_STACK_PAIRS);
+    if (ppPairs == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    lSize = blSize(pZset);
+    for (lStart = 0; lStart < lSize && blGetScore(dmbBinlistNext(ppPairs[lStart])) < min; ++lStart);
+    for (lEnd = lSize - 1; lEnd >= lStart && blGetScore(dmbBinlistNext(ppPairs[lEnd])) > max; --lEnd);
+
+    code = blScanPairs(ppPairs, lStart, lEnd, reverse, fn, pData);
+    if (ppPairs != ppBuf)
+        dmbFree(ppPairs);
+    return code;
+}
+
+dmbCode dmbZsetRangeByRank(dmbZset *pZset, dmbLONG start, dmbLONG end, dmbBOOL reverse, dmbZsetScanFunc fn, void *pData)
+{
+    dmbBinEntry *ppBuf[ZSET_BL_STACK_PAIRS], **ppPairs;
+    dmbLONG lSize;
+    dmbCode code;
+
+    if (pZset->encode == DMB_OBJ_ENCODE_BTREE)
+        return dmbZBTreeScanByRank(pZset->tree, start, end, reverse, fn, pData);
+    if (pZset->encode != DMB_OBJ_ENCODE_BINLIST)
+        return dmbZSkipListScanByRank(pZset->list, start, end, reverse, fn, pData);
+
+    //same bounds as dmbZSkipListScanByRank
+    lSize = blSize(pZset);
+    start = start < 0 ? lSize + start : start;
+    end = end < 0 ? lSize + end : end;
+    if (start >= lSize || start < 0)
+        return DMB_ERRCODE_OK;
+    if (end >= lSize || end < 0)
+        end = lSize - 1;
+
+    ppPairs = blIndexPairs(pZset, ppBuf, ZSET_BL_STACK_PAIRS);
+    if (ppPairs == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    code = blScanPairs(ppPairs, start, end, reverse, fn, pData);
+    if (ppPairs != ppBuf)
+        dmbFree(ppPairs);
+    return code;
+}
@@ -0,0 +1,92 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBZSET_H
+#define DMBZSET_H
+
+#include "core/dmbzskiplist.h"
+#include "core/dmbzbtree.h"
+#include "core/dmbbinlist.h"
+#include "core/dmbstring.h"
+
+/*
+ * Sorted set: a skiplist ordered by (score, member) and a member dict.
+ * The dmbDictEntry embedded in every skiplist node (k = member, v = score)
+ * is put into the dict directly, so the dict costs no extra allocation and
+ * a member lookup leads straight to its node.
+ * The skiplist is dmbZSkipList, which keeps the double score inline.
+ * With zset_use_btree of g_settings set, large sets use a dmbZBTree
+ * instead. Its entries move between nodes, so the dict then holds
+ * separately allocated entries (k = the member string owned by the tree,
+ * v = score).
+ *
+ * Small sets start as a sorted binlist of member/score pairs (the score as
+ * the raw bits of the double in an int64 entry) and are converted to the
+ * skiplist once zset_max_binlist_entries or zset_max_binlist_value of
+ * g_settings is exceeded. The conversion is one way.
+ */
+
+typedef struct dmbZset {
+    //DMB_OBJ_ENCODE_BINLIST, DMB_OBJ_ENCODE_SKIPLIST or DMB_OBJ_ENCODE_BTREE
+    dmbUINT32 encode;
+    dmbBinlist *bl;
+    dmbZSkipList *list;
+    dmbZBTree *tree;
+    dmbDict *dict;
+} dmbZset;
+
+//pcMember is only valid during the call
+typedef dmbCode (*dmbZsetScanFunc)(void *pData, double score, const dmbCHAR *pcMember, dmbUINT uLen);
+
+dmbZset* dmbZsetCreate();
+void dmbZsetDestroy(dmbZset *pZset);
+dmbLONG dmbZsetSize(dmbZset *pZset);
+
+/**
+ * @brief dmbZsetAdd 添加成员，已存在时更新分数
+ * @param pAdded 输出，新加入为TRUE，更新为FALSE，可以为NULL
+ */
+dmbCode dmbZsetAdd(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, double score, dmbBOOL *pAdded);
+
+/**
+ * @brief dmbZsetScore O(1)获取成员分数
+ * @return 成员不存在返回DMB_ERRCODE_ZSETMEMBER_NOT_EXIST
+ */
+dmbCode dmbZsetScore(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, double *pScore);
+
+dmbBOOL dmbZsetRemove(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen);
+
+/**
+ * @brief dmbZsetRank 成员排名，从0开始
+ * @param reverse TRUE时按分数从大到小排名
+ * @return 成员不存在返回-1
+ */
+dmbLONG dmbZsetRank(dmbZset *pZset, const dmbCHAR *pcMember, dmbUINT uLen, dmbBOOL reverse);
+
+dmbLONG dmbZsetCount(dmbZset *pZset, double min, double max);
+
+/**
+ * @brief dmbZsetRangeByScore 按分数区间[min, max]遍历，fn返回DMB_ERRCODE_SKIPLIST_SCAN_BREAK提前结束
+ */
+dmbCode dmbZsetRangeByScore(dmbZset *pZset, double min, double max, dmbBOOL reverse, dmbZsetScanFunc fn, void *pData);
+
+/**
+ * @brief dmbZsetRangeByRank 按排名区间[start, end]遍历，负数表示从末尾倒数
+ */
+dmbCode dmbZsetRangeByRank(dmbZset *pZset, dmbLONG start, dmbLONG end, dmbBOOL reverse, dmbZsetScanFunc fn, void *pData);
+
+#endif // DMBZSET_H
@@ -18,9 +18,9 @@
 /*
  ********************************************************************************************
     binlist:
-     ------------------  -----------------------  ----------------  -------  -------     -------  -------------------
-    |total length 4byte||last entry offset 4byte||entry size 2byte||entry 1||entry 2|...|entry n||end code 0x00 1byte|
-     ------------------  -----------------------  ----------------  -------  -------     -------  -------------------
+     ------------------  -----------------------  -----------------  -------  -------     -------  -------------------
+    |total length 4byte||last entry offset 4byte||entry count 4byte||entry 1||entry 2|...|entry n||end code 0x00 1byte|
+     ------------------  -----------------------  -----------------  -------  -------     -------  -------------------
 
     tiny string entry:
      --------   ----------
@@ -46,27 +46,56 @@
      --------   -------------
     |11100000| |content 8byte|
      --------   -------------
+
+    compressed binlist (the last entry offset 0 marks it):
+     ------------------  -------  -----------------  ------------------  -----------------------  -------------
+    |total length 4byte||0 4byte||entry count 4byte||raw length 4byte  ||last entry offset 4byte||LZF data     |
+     ------------------  -------  -----------------  ------------------  -----------------------  -------------
  ********************************************************************************************
 **/
 
 #include "dmbbinlist.h"
 #include "core/dmballoc.h"
+#include "core/dmblzf.h"
+#include "utils/dmbtime.h"
+#include "thread/dmbatomic.h"
 #include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) && !defined(DMB_BINLIST_NO_SIMD)
+#include <emmintrin.h>
+#define DMB_BINLIST_SSE2
+#endif
 
-const dmbUINT DMB_BINLIST_HEAD_SIZE = sizeof(dmbUINT)*2 + sizeof(dmbUINT16);
+const dmbUINT DMB_BINLIST_HEAD_SIZE = sizeof(dmbUINT)*3;
 const dmbUINT DMB_BINLIST_TAIL_SIZE = sizeof(dmbBYTE);
 
-#define BINLIST_SIZE(LIST_PTR) (*((dmbUINT*)&((LIST_PTR)[0])))
-#define BINLIST_LAST(LIST_PTR) (*((dmbUINT*)&((LIST_PTR)[sizeof(dmbUINT)])))
-#define BINLIST_LEN(LIST_PTR) (*((dmbUINT16*)&((LIST_PTR)[(sizeof(dmbUINT)*2)])))
+//a list built in a write buffer may start at any address
+static inline dmbUINT readUint(const dmbBYTE *p)
+{
+    dmbUINT u;
+    memcpy(&u, p, sizeof(u));
+    return u;
+}
+
+#define BINLIST_SIZE(LIST_PTR) readUint(&((LIST_PTR)[0]))
+#define BINLIST_LAST(LIST_PTR) readUint(&((LIST_PTR)[sizeof(dmbUINT)]))
+#define BINLIST_LEN(LIST_PTR) readUint(&((LIST_PTR)[(sizeof(dmbUINT)*2)]))
 #define BINLIST_UPDATE_SIZE(LIST_PTR, SIZE) dmbInt32ToByte((LIST_PTR), (SIZE))
 #define BINLIST_UPDATE_LAST(LIST_PTR, OFFSET) dmbInt32ToByte((LIST_PTR)+sizeof(dmbUINT), (OFFSET))
-#define BINLIST_UPDATE_LEN(LIST_PTR, NUM) dmbInt16ToByte((LIST_PTR)+sizeof(dmbUINT)+sizeof(dmbUINT), (NUM))
+#define BINLIST_UPDATE_LEN(LIST_PTR, NUM) dmbInt32ToByte((LIST_PTR)+sizeof(dmbUINT)+sizeof(dmbUINT), (NUM))
 #define BINLIST_UPDATE_ENDCODE(LIST_PTR) do { \
                         (LIST_PTR)[BINLIST_SIZE(LIST_PTR)-DMB_BINLIST_TAIL_SIZE] = DMB_BINLIST_ENDCODE; \
                     } while (0)
 #define BINLIST_LAST_LEN(LIST_PTR) (BINLIST_SIZE(LIST_PTR)-BINLIST_LAST(LIST_PTR)-DMB_BINLIST_TAIL_SIZE)
 
+#define BINLIST_PACKED_HEAD_SIZE (sizeof(dmbUINT)*5)
+#define BINLIST_RAW_SIZE(LIST_PTR) readUint(&((LIST_PTR)[(sizeof(dmbUINT)*3)]))
+#define BINLIST_RAW_LAST(LIST_PTR) readUint(&((LIST_PTR)[(sizeof(dmbUINT)*4)]))
+#define BINLIST_UPDATE_RAW_SIZE(LIST_PTR, SIZE) dmbInt32ToByte((LIST_PTR)+sizeof(dmbUINT)*3, (SIZE))
+#define BINLIST_UPDATE_RAW_LAST(LIST_PTR, OFFSET) dmbInt32ToByte((LIST_PTR)+sizeof(dmbUINT)*4, (OFFSET))
+
 static inline dmbBOOL dmbBinEntryLen(dmbBinEntry *pEntry, dmbUINT *pLen, dmbUINT *pAllLen);
 static inline dmbBOOL setStrLen(dmbBinEntry *pEntry, dmbUINT uLen);
 
@@ -99,7 +128,7 @@ dmbCode dmbBinlistClear(dmbBinAllocator *pAllocator, dmbBinlist **pList)
     return DMB_ERRCODE_OK;
 }
 
-inline dmbUINT16 dmbBinlistLen(dmbBinlist *pList)
+inline dmbUINT dmbBinlistLen(dmbBinlist *pList)
 {
     return BINLIST_LEN(pList);
 }
@@ -108,7 +137,7 @@ inline dmbUINT16 dmbBinlistLen(dmbBinlist *pList)
 dmbCode dmbBinlistPushBack(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinItem *pItem)
 {
     dmbUINT uLen, uAllLen, uCurrent, uLenNew, uAllLenNew, uAllocLen;
-    if (dmbBinlistLen(*pList) == USHRT_MAX)
+    if (dmbBinlistLen(*pList) == UINT_MAX)
         return DMB_ERRCODE_BINLIST_ENTRY_OOR;
 
     dmbBinEntryLen(pItem->entryhead, &uLenNew, &uAllLenNew);
@@ -150,7 +179,7 @@ dmbCode dmbBinlistPushBack(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbB
 dmbCode dmbBinlistPushBack(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinItem *pItem, dmbBOOL bPart)
 {
     dmbUINT uLen, uAllLen, uCurrent, uLenNew, uAllLenNew, uAllocLen;
-    if (dmbBinlistLen(*pList) == USHRT_MAX)
+    if (dmbBinlistLen(*pList) == UINT_MAX)
         return DMB_ERRCODE_BINLIST_ENTRY_OOR;
 
     dmbBinEntryLen(pItem->entryhead, &uLenNew, &uAllLenNew);
@@ -241,6 +270,513 @@ void dmbBinlistDestroy(dmbBinAllocator *pAllocator, dmbBinlist *pList)
     pAllocator->free(pAllocator, pList);
 }
 
+//writes the item at pDest, returns its size
+static dmbUINT writeItem(dmbBinAllocator *pAllocator, dmbBinEntry *pDest, dmbBinItem *pItem)
+{
+    dmbUINT uLen, uAllLen;
+
+    dmbBinEntryLen(pItem->entryhead, &uLen, &uAllLen);
+    if (DMB_BINENTRY_IS_STR(pItem->entryhead))
+    {
+        pAllocator->memcpy(pAllocator, pDest, pItem->entryhead, uAllLen - uLen);
+        pAllocator->memcpy(pAllocator, pDest + (uAllLen - uLen), pItem->data, uLen);
+    }
+    else
+    {
+        pAllocator->memcpy(pAllocator, pDest, pItem->entryhead, uAllLen);
+    }
+
+    return uAllLen;
+}
+
+//size of the item, 0 if it is empty
+static inline dmbUINT itemSize(dmbBinItem *pItem)
+{
+    dmbUINT uLen, uAllLen;
+
+    dmbBinEntryLen(pItem->entryhead, &uLen, &uAllLen);
+    return uLen == 0 ? 0 : uAllLen;
+}
+
+//resizes the list to uAllocLen, partial allocations are failures
+static inline dmbCode resizeList(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbUINT uAllocLen)
+{
+    dmbUINT uLen = uAllocLen;
+    dmbCode code = pAllocator->realloc(pAllocator, pList, &uLen);
+
+    if (code == DMB_ERRCODE_BINLIST_ALLOC_FAILED)
+        return code;
+    return uLen == uAllocLen ? DMB_ERRCODE_OK : DMB_ERRCODE_BINLIST_NO_ENOUGH_SPACE;
+}
+
+//gives back the space freed by an edit, the list is already consistent so
+//an allocator that keeps the old block is fine
+static inline dmbCode shrinkList(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbUINT uAllocLen)
+{
+    dmbCode code = resizeList(pAllocator, pList, uAllocLen);
+
+    return code == DMB_ERRCODE_BINLIST_NO_ENOUGH_SPACE ? DMB_ERRCODE_OK : code;
+}
+
+dmbCode dmbBinlistInsertAt(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pEntry, dmbBinItem *pItems, dmbUINT uCount)
+{
+    dmbUINT uSize = BINLIST_SIZE(*pList), uOffset, uAdd = 0, uItem, uLastItem = 0, i;
+    dmbCode code;
+
+    if (uCount == 0)
+        return DMB_ERRCODE_OK;
+
+    if (BINLIST_LEN(*pList) > UINT_MAX - uCount)
+        return DMB_ERRCODE_BINLIST_ENTRY_OOR;
+
+    for (i=0; i<uCount; ++i)
+    {
+        uItem = itemSize(&pItems[i]);
+        if (uItem == 0)
+            return DMB_ERRCODE_BINENTRY_IS_EMPTY;
+        if (uItem > UINT_MAX - uSize - uAdd)
+            return DMB_ERRCODE_BINLIST_FULL;
+        uAdd += uItem;
+    }
+
+    //NULL or the end code append
+    uOffset = (pEntry == NULL || pEntry[0] == DMB_BINLIST_ENDCODE) ? uSize - DMB_BINLIST_TAIL_SIZE : (dmbUINT)(pEntry - *pList);
+
+    code = resizeList(pAllocator, pList, uSize + uAdd);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    //one move opens the gap, the end code moves with the tail
+    dmbMemMove(*pList + uOffset + uAdd, *pList + uOffset, uSize - uOffset);
+    for (i=0, uItem=uOffset; i<uCount; ++i)
+    {
+        uLastItem = uItem;
+        uItem += writeItem(pAllocator, *pList + uItem, &pItems[i]);
+    }
+
+    if (uOffset == uSize - DMB_BINLIST_TAIL_SIZE)
+        BINLIST_UPDATE_LAST(*pList, uLastItem);
+    else
+        BINLIST_UPDATE_LAST(*pList, BINLIST_LAST(*pList) + uAdd);
+    BINLIST_UPDATE_SIZE(*pList, uSize + uAdd);
+    BINLIST_UPDATE_LEN(*pList, BINLIST_LEN(*pList) + uCount);
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbBinlistDeleteRange(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pEntry, dmbUINT uCount)
+{
+    dmbUINT uSize = BINLIST_SIZE(*pList), uOffset = (dmbUINT)(pEntry - *pList), uEnd, uLast, uLen, uAllLen, uRemoved = 0;
+    dmbBinEntry *pEnd = pEntry, *pPrev;
+
+    while (uRemoved < uCount && dmbBinEntryLen(pEnd, &uLen, &uAllLen))
+    {
+        pEnd += uAllLen;
+        ++uRemoved;
+    }
+
+    if (uRemoved == 0)
+        return DMB_ERRCODE_OK;
+
+    uEnd = (dmbUINT)(pEnd - *pList);
+    if (uEnd == uSize - DMB_BINLIST_TAIL_SIZE)
+    {
+        //the last entry goes, the new last one is found from the head
+        uLast = DMB_BINLIST_HEAD_SIZE;
+        for (pPrev = dmbBinlistFirst(*pList); pPrev < pEntry; pPrev += uAllLen)
+        {
+            uLast = (dmbUINT)(pPrev - *pList);
+            dmbBinEntryLen(pPrev, &uLen, &uAllLen);
+        }
+    }
+    else
+    {
+        uLast = BINLIST_LAST(*pList) - (uEnd - uOffset);
+    }
+
+    dmbMemMove(*pList + uOffset, *pList + uEnd, uSize - uEnd);
+    BINLIST_UPDATE_SIZE(*pList, uSize - (uEnd - uOffset));
+    BINLIST_UPDATE_LAST(*pList, uLast);
+    BINLIST_UPDATE_LEN(*pList, BINLIST_LEN(*pList) - uRemoved);
+
+    return shrinkList(pAllocator, pList, uSize - (uEnd - uOffset));
+}
+
+dmbCode dmbBinlistTruncate(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pLast)
+{
+    dmbUINT uOffset, uLen, uAllLen, uRemoved = 0;
+    dmbBinEntry *pEntry;
+
+    if (pLast == NULL)
+        pEntry = dmbBinlistFirst(*pList);
+    else if (dmbBinEntryLen(pLast, &uLen, &uAllLen))
+        pEntry = pLast + uAllLen;
+    else
+        return DMB_ERRCODE_OK;
+
+    //only the removed entries are walked, to count them
+    uOffset = (dmbUINT)(pEntry - *pList);
+    for (; dmbBinEntryLen(pEntry, &uLen, &uAllLen); pEntry += uAllLen)
+        ++uRemoved;
+
+    if (uRemoved == 0)
+        return DMB_ERRCODE_OK;
+
+    (*pList)[uOffset] = DMB_BINLIST_ENDCODE;
+    BINLIST_UPDATE_SIZE(*pList, uOffset + DMB_BINLIST_TAIL_SIZE);
+    BINLIST_UPDATE_LAST(*pList, pLast == NULL ? DMB_BINLIST_HEAD_SIZE : (dmbUINT)(pLast - *pList));
+    BINLIST_UPDATE_LEN(*pList, BINLIST_LEN(*pList) - uRemoved);
+
+    return shrinkList(pAllocator, pList, uOffset + DMB_BINLIST_TAIL_SIZE);
+}
+
+dmbCode dmbBinlistAppendRange(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pFrom, dmbUINT uCount)
+{
+    dmbUINT uSize = BINLIST_SIZE(*pList), uLen, uAllLen, uAdd, uLast = 0, uCopied = 0;
+    dmbBinEntry *pEnd = pFrom;
+    dmbCode code;
+
+    while (uCopied < uCount && dmbBinEntryLen(pEnd, &uLen, &uAllLen))
+    {
+        uLast = (dmbUINT)(pEnd - pFrom);
+        pEnd += uAllLen;
+        ++uCopied;
+    }
+
+    if (uCopied == 0)
+        return DMB_ERRCODE_OK;
+
+    uAdd = (dmbUINT)(pEnd - pFrom);
+    if (BINLIST_LEN(*pList) > UINT_MAX - uCopied)
+        return DMB_ERRCODE_BINLIST_ENTRY_OOR;
+    if (uAdd > UINT_MAX - uSize)
+        return DMB_ERRCODE_BINLIST_FULL;
+
+    code = resizeList(pAllocator, pList, uSize + uAdd);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    //entries are self-describing, the bytes are valid at any position
+    pAllocator->memcpy(pAllocator, *pList + uSize - DMB_BINLIST_TAIL_SIZE, pFrom, uAdd);
+    BINLIST_UPDATE_SIZE(*pList, uSize + uAdd);
+    BINLIST_UPDATE_LAST(*pList, uSize - DMB_BINLIST_TAIL_SIZE + uLast);
+    BINLIST_UPDATE_LEN(*pList, BINLIST_LEN(*pList) + uCopied);
+    BINLIST_UPDATE_ENDCODE(*pList);
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbBinlistReplace(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pEntry, dmbBinItem *pItem)
+{
+    dmbUINT uSize = BINLIST_SIZE(*pList), uOffset = (dmbUINT)(pEntry - *pList), uLen, uOld, uNew;
+    dmbCode code;
+
+    if (!dmbBinEntryLen(pEntry, &uLen, &uOld))
+        return DMB_ERRCODE_BINLIST_ENTRY_OOR;
+
+    uNew = itemSize(pItem);
+    if (uNew == 0)
+        return DMB_ERRCODE_BINENTRY_IS_EMPTY;
+    if (uNew > uOld && uNew - uOld > UINT_MAX - uSize)
+        return DMB_ERRCODE_BINLIST_FULL;
+
+    if (uNew > uOld)
+    {
+        code = resizeList(pAllocator, pList, uSize + (uNew - uOld));
+        if (code != DMB_ERRCODE_OK)
+            return code;
+    }
+
+    //entries after the replaced one move by the size difference
+    if (uNew != uOld)
+        dmbMemMove(*pList + uOffset + uNew, *pList + uOffset + uOld, uSize - uOffset - uOld);
+    writeItem(pAllocator, *pList + uOffset, pItem);
+
+    if (uOffset < BINLIST_LAST(*pList))
+        BINLIST_UPDATE_LAST(*pList, BINLIST_LAST(*pList) + uNew - uOld);
+    BINLIST_UPDATE_SIZE(*pList, uSize + uNew - uOld);
+
+    return uNew < uOld ? shrinkList(pAllocator, pList, uSize - (uOld - uNew)) : DMB_ERRCODE_OK;
+}
+
+dmbCode dmbBinlistCompress(dmbBinAllocator *pAllocator, dmbBinlist **pList)
+{
+    if (pAllocator->compress == NULL || dmbBinlistIsCompressed(*pList))
+        return DMB_ERRCODE_OK;
+
+    return pAllocator->compress(pAllocator, pList);
+}
+
+dmbCode dmbBinlistDecompress(dmbBinAllocator *pAllocator, dmbBinlist **pList)
+{
+    if (!dmbBinlistIsCompressed(*pList))
+        return DMB_ERRCODE_OK;
+    if (pAllocator->decompress == NULL)
+        return DMB_ERRCODE_BINLIST_NO_CODEC;
+
+    return pAllocator->decompress(pAllocator, pList);
+}
+
+inline dmbBOOL dmbBinlistIsCompressed(dmbBinlist *pList)
+{
+    return BINLIST_LAST(pList) == 0;
+}
+
+dmbUINT dmbBinlistRawSize(dmbBinlist *pList)
+{
+    return dmbBinlistIsCompressed(pList) ? BINLIST_RAW_SIZE(pList) : BINLIST_SIZE(pList);
+}
+
+//walks uCount entries from pEntry, pEntry must have at least uCount entries after it
+static inline dmbBinEntry* skipEntries(dmbBinEntry *pEntry, dmbUINT uCount)
+{
+    dmbUINT uLen, uAllLen;
+
+    while (uCount--)
+    {
+        dmbBinEntryLen(pEntry, &uLen, &uAllLen);
+        pEntry += uAllLen;
+    }
+    return pEntry;
+}
+
+dmbBinEntry* dmbBinlistGet(dmbBinlist *pList, dmbUINT uPos)
+{
+    if (uPos >= BINLIST_LEN(pList))
+        return NULL;
+
+    return skipEntries(dmbBinlistFirst(pList), uPos);
+}
+
+#ifdef DMB_BINLIST_SSE2
+typedef struct findKey {
+    __m128i head;
+    dmbUINT mask;
+} findKey;
+
+static inline void initKey(findKey *pKey, const dmbBYTE *pData, dmbUINT uLen)
+{
+    dmbBYTE buf[16] = {0};
+
+    dmbMemCopy(buf, pData, uLen < 16 ? uLen : 16);
+    pKey->head = _mm_loadu_si128((const __m128i*)buf);
+    pKey->mask = uLen < 16 ? (1U << uLen) - 1 : 0xFFFF;
+}
+
+//pContent has the key length, the first 16 bytes are compared at once
+//when they can be loaded without passing pEnd
+static inline dmbBOOL matchKey(findKey *pKey, const dmbBYTE *pContent, const dmbBYTE *pEnd, const dmbBYTE *pData, dmbUINT uLen)
+{
+    __m128i head;
+
+    if (pContent + 16 > pEnd)
+        return dmbMemCmp(pContent, pData, uLen) == 0;
+
+    head = _mm_loadu_si128((const __m128i*)pContent);
+    if (((dmbUINT)_mm_movemask_epi8(_mm_cmpeq_epi8(head, pKey->head)) & pKey->mask) != pKey->mask)
+        return FALSE;
+
+    return uLen <= 16 || dmbMemCmp(pContent + 16, pData + 16, uLen - 16) == 0;
+}
+#else
+typedef struct findKey {
+    dmbBYTE first;
+} findKey;
+
+static inline void initKey(findKey *pKey, const dmbBYTE *pData, dmbUINT uLen)
+{
+    DMB_UNUSED(uLen);
+    pKey->first = pData[0];
+}
+
+static inline dmbBOOL matchKey(findKey *pKey, const dmbBYTE *pContent, const dmbBYTE *pEnd, const dmbBYTE *pData, dmbUINT uLen)
+{
+    DMB_UNUSED(pEnd);
+    return pContent[0] == pKey->first && dmbMemCmp(pContent, pData, uLen) == 0;
+}
+#endif
+
+dmbBinEntry* dmbBinlistFind(dmbBinlist *pList, dmbBinEntry *pEntry, const dmbBYTE *pData, dmbUINT uLen, dmbUINT uSkip)
+{
+    const dmbBYTE *pEnd = pList + BINLIST_SIZE(pList);
+    dmbUINT uContent, uAllLen, uSkipped = 0;
+    findKey key;
+
+    //there are no empty entries
+    if (uLen == 0)
+        return NULL;
+
+    initKey(&key, pData, uLen);
+    if (pEntry == NULL)
+        pEntry = dmbBinlistFirst(pList);
+
+    while (pEntry[0] != DMB_BINLIST_ENDCODE)
+    {
+        //a tiny string header is its length, the common case needs no decoding
+        if (pEntry[0] <= DMB_TINYSTR_LENMAX)
+        {
+            uContent = pEntry[0];
+            uAllLen = uContent + 1;
+        }
+        else
+        {
+            dmbBinEntryLen(pEntry, &uContent, &uAllLen);
+        }
+
+        if (uSkipped > 0)
+        {
+            --uSkipped;
+        }
+        else
+        {
+            if (uContent == uLen && DMB_BINENTRY_IS_STR(pEntry) && matchKey(&key, pEntry + (uAllLen - uContent), pEnd, pData, uLen))
+                return pEntry;
+            uSkipped = uSkip;
+        }
+
+        pEntry += uAllLen;
+    }
+
+    return NULL;
+}
+
+dmbBinEntry* dmbBinlistFindInt(dmbBinlist *pList, dmbBinEntry *pEntry, dmbINT64 value, dmbUINT uSkip)
+{
+    dmbBinItem i16, i32, i64;
+    dmbBOOL bI16 = value >= INT16_MIN && value <= INT16_MAX;
+    dmbBOOL bI32 = value >= INT32_MIN && value <= INT32_MAX;
+    dmbUINT uContent, uAllLen, uSkipped = 0;
+    dmbBOOL bMatch;
+
+    //packed forms of the value, entries are compared without decoding them
+    if (bI16)
+        DMB_BINITEM_I16(&i16, (dmbINT16)value);
+    if (bI32)
+        DMB_BINITEM_I32(&i32, (dmbINT32)value);
+    DMB_BINITEM_I64(&i64, value);
+
+    if (pEntry == NULL)
+        pEntry = dmbBinlistFirst(pList);
+
+    while (pEntry[0] != DMB_BINLIST_ENDCODE)
+    {
+        switch (pEntry[0]) {
+        case DMB_BINCODE_I16:
+            uAllLen = 1 + sizeof(dmbINT16);
+            bMatch = bI16 && dmbMemCmp(pEntry, i16.entryhead, 1 + sizeof(dmbINT16)) == 0;
+            break;
+        case DMB_BINCODE_I32:
+            uAllLen = 1 + sizeof(dmbINT32);
+            bMatch = bI32 && dmbMemCmp(pEntry, i32.entryhead, 1 + sizeof(dmbINT32)) == 0;
+            break;
+        case DMB_BINCODE_I64:
+            uAllLen = 1 + sizeof(dmbINT64);
+            bMatch = dmbMemCmp(pEntry, i64.entryhead, 1 + sizeof(dmbINT64)) == 0;
+            break;
+        default:
+            dmbBinEntryLen(pEntry, &uContent, &uAllLen);
+            bMatch = FALSE;
+            break;
+        }
+
+        if (uSkipped > 0)
+        {
+            --uSkipped;
+        }
+        else
+        {
+            if (bMatch)
+                return pEntry;
+            uSkipped = uSkip;
+        }
+
+        pEntry += uAllLen;
+    }
+
+    return NULL;
+}
+
+void dmbBinlistIndexInit(dmbBinlistIndex *pIndex, dmbUINT uStep)
+{
+    pIndex->step = uStep;
+    pIndex->num = 0;
+    pIndex->capacity = 0;
+    pIndex->offsets = NULL;
+}
+
+dmbCode dmbBinlistIndexUpdate(dmbBinlistIndex *pIndex, dmbBinlist *pList, dmbUINT uFrom)
+{
+    dmbUINT uLen = BINLIST_LEN(pList), uNeed, uPos;
+    dmbUINT *pOffsets;
+    dmbBinEntry *pEntry;
+
+    if (pIndex->step == 0)
+        return DMB_ERRCODE_OK;
+
+    uNeed = (uLen + pIndex->step - 1) / pIndex->step;
+    if (uNeed > pIndex->capacity)
+    {
+        //grow by half so appending entries one by one stays amortized O(1)
+        uNeed += uNeed / 2;
+        pOffsets = (dmbUINT*)dmbRealloc(pIndex->offsets, sizeof(dmbUINT) * uNeed);
+        if (pOffsets == NULL)
+        {
+            pIndex->num = 0;
+            return DMB_ERRCODE_ALLOC_FAILED;
+        }
+        pIndex->offsets = pOffsets;
+        pIndex->capacity = uNeed;
+    }
+
+    //offsets of the entries up to uFrom are still right, resume at the last of them
+    if (uFrom / pIndex->step < pIndex->num)
+        pIndex->num = uFrom / pIndex->step + 1;
+    if (pIndex->num == 0)
+    {
+        pEntry = dmbBinlistFirst(pList);
+        uPos = 0;
+    }
+    else
+    {
+        pIndex->num--;
+        pEntry = pList + pIndex->offsets[pIndex->num];
+        uPos = pIndex->num * pIndex->step;
+    }
+
+    for (; uPos < uLen; uPos += pIndex->step)
+    {
+        pIndex->offsets[pIndex->num++] = (dmbUINT)(pEntry - pList);
+        if (uPos + pIndex->step < uLen)
+            pEntry = skipEntries(pEntry, pIndex->step);
+    }
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbBinEntry* dmbBinlistIndexGet(dmbBinlistIndex *pIndex, dmbBinlist *pList, dmbUINT uPos)
+{
+    dmbUINT uSlot;
+
+    if (uPos >= BINLIST_LEN(pList))
+        return NULL;
+
+    if (pIndex->num == 0)
+        return skipEntries(dmbBinlistFirst(pList), uPos);
+
+    uSlot = uPos / pIndex->step;
+    //entries appended since the last update are walked from the last offset
+    if (uSlot >= pIndex->num)
+        uSlot = pIndex->num - 1;
+
+    return skipEntries(pList + pIndex->offsets[uSlot], uPos - uSlot * pIndex->step);
+}
+
+void dmbBinlistIndexClear(dmbBinlistIndex *pIndex)
+{
+    dmbFree(pIndex->offsets);
+    dmbBinlistIndexInit(pIndex, pIndex->step);
+}
+
 static inline dmbBOOL dmbBinEntryLen(dmbBinEntry *pEntry, dmbUINT *pLen, dmbUINT *pAllLen)
 {
     if (pEntry[0] == DMB_BINLIST_ENDCODE)
@@ -556,7 +1092,9 @@ const dmbBinAllocator g_default_binlist_allcator = {
     default_free,
     default_memcpy,
     default_reset,
-    default_getMember
+    default_getMember,
+    NULL,
+    NULL
 };
 
 dmbCode void_realloc(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbUINT *pLen)
@@ -584,7 +1122,9 @@ const dmbBinAllocator g_void_binlist_allcator = {
     default_free,
     void_memcpy,
     default_reset,
-    default_getMember
+    default_getMember,
+    NULL,
+    NULL
 };
 
 dmbCode fixmem_malloc(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbUINT *pLen)
@@ -656,6 +1196,8 @@ dmbBinAllocator* dmbInitFixmemAllocator(dmbFixmemAllocator *pAllocator, dmbBYTE
     pAllocator->allocator.memcpy = default_memcpy;
     pAllocator->allocator.reset = fixmem_reset;
     pAllocator->allocator.getData = fixmem_getData;
+    pAllocator->allocator.compress = NULL;
+    pAllocator->allocator.decompress = NULL;
 
     pAllocator->data.ptr = ptr;
     pAllocator->data.offset = 0;
@@ -663,3 +1205,130 @@ dmbBinAllocator* dmbInitFixmemAllocator(dmbFixmemAllocator *pAllocator, dmbBYTE
 
     return &pAllocator->allocator;
 }
+
+void* lzf_getData(dmbBinAllocator *pAllocator)
+{
+    dmbLzfAllocator* lzf = DMB_ENTRY(pAllocator, dmbLzfAllocator, allocator);
+    return lzf;
+}
+
+dmbCode lzf_free(dmbBinAllocator *pAllocator, dmbBinlist *pList)
+{
+    dmbLzfAllocator* lzf = (dmbLzfAllocator*)pAllocator->getData(pAllocator);
+
+    if (dmbBinlistIsCompressed(pList))
+    {
+        dmbAtomicDecr(&lzf->stats.segments);
+        dmbAtomicAdd(&lzf->stats.rawBytes, -(dmbUINT64)BINLIST_RAW_SIZE(pList));
+        dmbAtomicAdd(&lzf->stats.packedBytes, -(dmbUINT64)BINLIST_SIZE(pList));
+    }
+    dmbFree(pList);
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode lzf_compress(dmbBinAllocator *pAllocator, dmbBinlist **pList)
+{
+    dmbLzfAllocator* lzf = (dmbLzfAllocator*)pAllocator->getData(pAllocator);
+    dmbUINT uSize = BINLIST_SIZE(*pList), uBody = uSize - DMB_BINLIST_HEAD_SIZE, uPacked;
+    dmbBinlist *pPacked, *pShrunk;
+
+    if (uSize < lzf->threshold || uSize <= BINLIST_PACKED_HEAD_SIZE)
+        return DMB_ERRCODE_OK;
+
+    //every access pays a decode, keep the list as it is unless an eighth is saved
+    pPacked = (dmbBinlist*)dmbMalloc(BINLIST_PACKED_HEAD_SIZE + uBody - uBody / 8);
+    if (pPacked == NULL)
+        return DMB_ERRCODE_BINLIST_ALLOC_FAILED;
+
+    uPacked = dmbLzfCompress(*pList + DMB_BINLIST_HEAD_SIZE, uBody, pPacked + BINLIST_PACKED_HEAD_SIZE, uBody - uBody / 8);
+    if (uPacked == 0)
+    {
+        dmbFree(pPacked);
+        dmbAtomicIncr(&lzf->stats.rejected);
+        return DMB_ERRCODE_OK;
+    }
+
+    pShrunk = (dmbBinlist*)dmbRealloc(pPacked, BINLIST_PACKED_HEAD_SIZE + uPacked);
+    if (pShrunk != NULL)
+        pPacked = pShrunk;
+
+    BINLIST_UPDATE_SIZE(pPacked, BINLIST_PACKED_HEAD_SIZE + uPacked);
+    BINLIST_UPDATE_LAST(pPacked, 0);
+    BINLIST_UPDATE_LEN(pPacked, BINLIST_LEN(*pList));
+    BINLIST_UPDATE_RAW_SIZE(pPacked, uSize);
+    BINLIST_UPDATE_RAW_LAST(pPacked, BINLIST_LAST(*pList));
+
+    dmbFree(*pList);
+    *pList = pPacked;
+
+    dmbAtomicIncr(&lzf->stats.segments);
+    dmbAtomicAdd(&lzf->stats.rawBytes, (dmbUINT64)uSize);
+    dmbAtomicAdd(&lzf->stats.packedBytes, (dmbUINT64)(BINLIST_PACKED_HEAD_SIZE + uPacked));
+    dmbAtomicIncr(&lzf->stats.compressions);
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode lzf_decompress(dmbBinAllocator *pAllocator, dmbBinlist **pList)
+{
+    dmbLzfAllocator* lzf = (dmbLzfAllocator*)pAllocator->getData(pAllocator);
+    dmbUINT uSize = BINLIST_SIZE(*pList), uRaw = BINLIST_RAW_SIZE(*pList);
+    dmbLONG lStart = dmbMonotonicNanos();
+    dmbBinlist *pRaw;
+
+    pRaw = (dmbBinlist*)dmbMalloc(uRaw);
+    if (pRaw == NULL)
+        return DMB_ERRCODE_BINLIST_ALLOC_FAILED;
+
+    if (dmbLzfDecompress(*pList + BINLIST_PACKED_HEAD_SIZE, uSize - BINLIST_PACKED_HEAD_SIZE,
+                         pRaw + DMB_BINLIST_HEAD_SIZE, uRaw - DMB_BINLIST_HEAD_SIZE) != uRaw - DMB_BINLIST_HEAD_SIZE)
+    {
+        dmbFree(pRaw);
+        return DMB_ERRCODE_BINLIST_CORRUPT;
+    }
+
+    BINLIST_UPDATE_SIZE(pRaw, uRaw);
+    BINLIST_UPDATE_LAST(pRaw, BINLIST_RAW_LAST(*pList));
+    BINLIST_UPDATE_LEN(pRaw, BINLIST_LEN(*pList));
+
+    dmbAtomicDecr(&lzf->stats.segments);
+    dmbAtomicAdd(&lzf->stats.rawBytes, -(dmbUINT64)uRaw);
+    dmbAtomicAdd(&lzf->stats.packedBytes, -(dmbUINT64)uSize);
+    dmbAtomicIncr(&lzf->stats.decodes);
+
+    dmbFree(*pList);
+    *pList = pRaw;
+
+    dmbAtomicAdd(&lzf->stats.decodeNanos, (dmbUINT64)(dmbMonotonicNanos() - lStart));
+    return DMB_ERRCODE_OK;
+}
+
+dmbBinAllocator* dmbInitLzfAllocator(dmbLzfAllocator *pAllocator, dmbUINT uThreshold)
+{
+    pAllocator->allocator.malloc = default_malloc;
+    pAllocator->allocator.realloc = default_realloc;
+    pAllocator->allocator.free = lzf_free;
+    pAllocator->allocator.memcpy = default_memcpy;
+    pAllocator->allocator.reset = default_reset;
+    pAllocator->allocator.getData = lzf_getData;
+    pAllocator->allocator.compress = lzf_compress;
+    pAllocator->allocator.decompress = lzf_decompress;
+
+    pAllocator->threshold = uThreshold;
+    dmbMemSet(&pAllocator->stats, 0, sizeof(dmbBinCompressStats));
+
+    return &pAllocator->allocator;
+}
+
+double dmbBinCompressRatio(dmbBinCompressStats *pStats)
+{
+    dmbUINT64 uRaw = dmbAtomicAdd(&pStats->rawBytes, 0), uPacked = dmbAtomicAdd(&pStats->packedBytes, 0);
+    return uPacked == 0 ? 0 : (double)uRaw / uPacked;
+}
+
+double dmbBinDecodeNanos(dmbBinCompressStats *pStats)
+{
+    dmbUINT64 uDecodes = dmbAtomicAdd(&pStats->decodes, 0), uNanos = dmbAtomicAdd(&pStats->decodeNanos, 0);
+    return uDecodes == 0 ? 0 : (double)uNanos / uDecodes;
+}
@@ -34,7 +34,8 @@
 
 #define DMB_BINENTRY_IS_STR(ENTRY_PTR) (((ENTRY_PTR)[0] & 0xC0) != 0xC0)
 
-#define DMB_BINCODE(ENTRY) (0xF0 & (ENTRY)[0])
+//string codes only use the two high bits, the rest is length
+#define DMB_BINCODE(ENTRY) (DMB_BINENTRY_IS_STR(ENTRY) ? (0xC0 & (ENTRY)[0]) : (0xF0 & (ENTRY)[0]))
 
 typedef dmbBYTE dmbBinEntry, dmbBinlist;
 typedef struct dmbBinItem {
@@ -52,6 +53,20 @@ typedef struct dmbBinVar {
     dmbUINT len;
 } dmbBinVar;
 
+/*
+ * Optional sparse index of a binlist: the offset of every step-th entry, so
+ * reaching entry i walks at most step - 1 entries instead of i. The index
+ * lives outside the binlist and is not updated by the binlist functions,
+ * after changing entries from position uFrom on call dmbBinlistIndexUpdate
+ * with uFrom (the old length after appends).
+ */
+typedef struct dmbBinlistIndex {
+    dmbUINT step;
+    dmbUINT num;
+    dmbUINT capacity;
+    dmbUINT *offsets;
+} dmbBinlistIndex;
+
 typedef struct dmbBinAllocator {
     dmbCode (*malloc)(struct dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbUINT *pLen);
     dmbCode (*realloc)(struct dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbUINT *pLen);
@@ -59,17 +74,101 @@ typedef struct dmbBinAllocator {
     dmbCode (*memcpy)(struct dmbBinAllocator *pAllocator, void *pDest, void *pSrc, dmbUINT uSize);
     dmbCode (*reset)(struct dmbBinAllocator *pAllocator);
     void* (*getData)(struct dmbBinAllocator *pAllocator);
+    //optional, NULL when the allocator never compresses, see dmbBinlistCompress
+    dmbCode (*compress)(struct dmbBinAllocator *pAllocator, dmbBinlist **pList);
+    dmbCode (*decompress)(struct dmbBinAllocator *pAllocator, dmbBinlist **pList);
 } dmbBinAllocator;
 
 dmbBinlist* dmbBinlistCreate(dmbBinAllocator *pAllocator);
 dmbCode dmbBinlistClear(dmbBinAllocator *pAllocator, dmbBinlist **pList);
-dmbUINT16 dmbBinlistLen(dmbBinlist *pList);
+dmbUINT dmbBinlistLen(dmbBinlist *pList);
 //dmbCode dmbBinlistPushBack(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinItem *pItem);
 dmbCode dmbBinlistPushBack(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinItem *pItem, dmbBOOL bPart);
 dmbBinEntry* dmbBinlistFirst(dmbBinlist *pList);
 dmbBinEntry* dmbBinlistLast(dmbBinlist *pList);
 dmbBinEntry* dmbBinlistNext(dmbBinEntry *pEntry);
 void dmbBinlistDestroy(dmbBinAllocator *pAllocator, dmbBinlist *pList);
+
+/**
+ * @brief dmbBinlistInsertAt 在pEntry之前插入uCount个元素，pEntry为NULL时追加到末尾，只移动一次数据，
+ *        成功后原有的元素指针失效，元素数据不能指向list本身
+ */
+dmbCode dmbBinlistInsertAt(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pEntry, dmbBinItem *pItems, dmbUINT uCount);
+
+/**
+ * @brief dmbBinlistDeleteRange 删除从pEntry开始的uCount个元素（不足时删到末尾），删除最后一个元素时需从头查找新的末元素
+ */
+dmbCode dmbBinlistDeleteRange(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pEntry, dmbUINT uCount);
+
+/**
+ * @brief dmbBinlistTruncate 删除pLast之后的所有元素，pLast成为新的末元素，为NULL时删除全部，已知新末元素时不需要从头查找
+ */
+dmbCode dmbBinlistTruncate(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pLast);
+
+/**
+ * @brief dmbBinlistAppendRange 把另一个binlist中从pFrom开始的uCount个元素（不足时到末尾）按原编码一次复制到末尾，不解码
+ */
+dmbCode dmbBinlistAppendRange(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pFrom, dmbUINT uCount);
+
+/**
+ * @brief dmbBinlistReplace 用pItem替换pEntry，长度不同时移动其后的元素
+ */
+dmbCode dmbBinlistReplace(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbBinEntry *pEntry, dmbBinItem *pItem);
+
+/**
+ * @brief dmbBinlistGet 第uPos个元素，从头遍历，越界返回NULL
+ */
+dmbBinEntry* dmbBinlistGet(dmbBinlist *pList, dmbUINT uPos);
+
+/**
+ * @brief dmbBinlistCompress 分配器支持压缩时压缩整个binlist，分配器可以按大小或收益决定不压缩，
+ *        压缩后只有dmbBinlistLen、dmbBinlistRawSize、dmbBinlistDecompress和dmbBinlistDestroy可用
+ */
+dmbCode dmbBinlistCompress(dmbBinAllocator *pAllocator, dmbBinlist **pList);
+
+/**
+ * @brief dmbBinlistDecompress 解压后恢复为普通binlist，未压缩时直接返回
+ */
+dmbCode dmbBinlistDecompress(dmbBinAllocator *pAllocator, dmbBinlist **pList);
+
+dmbBOOL dmbBinlistIsCompressed(dmbBinlist *pList);
+
+/**
+ * @brief dmbBinlistRawSize 未压缩时的字节数
+ */
+dmbUINT dmbBinlistRawSize(dmbBinlist *pList);
+
+/**
+ * @brief dmbBinlistFind 从pEntry（NULL表示第一个元素）开始查找内容等于pData的字符串元素，
+ *        每比较一个元素后跳过uSkip个元素，整数元素不参与比较，找不到返回NULL
+ *        有SSE2时一次比较字符串的前16字节，定义DMB_BINLIST_NO_SIMD可关闭
+ */
+dmbBinEntry* dmbBinlistFind(dmbBinlist *pList, dmbBinEntry *pEntry, const dmbBYTE *pData, dmbUINT uLen, dmbUINT uSkip);
+
+/**
+ * @brief dmbBinlistFindInt 同dmbBinlistFind，查找值等于value的整数元素，直接比较编码后的字节
+ */
+dmbBinEntry* dmbBinlistFindInt(dmbBinlist *pList, dmbBinEntry *pEntry, dmbINT64 value, dmbUINT uSkip);
+
+/**
+ * @brief dmbBinlistIndexInit 初始化索引，每uStep个元素记录一个偏移，0表示不建索引
+ */
+void dmbBinlistIndexInit(dmbBinlistIndex *pIndex, dmbUINT uStep);
+
+/**
+ * @brief dmbBinlistIndexUpdate 重建第uFrom个元素之后的偏移，uFrom为0时完全重建
+ */
+dmbCode dmbBinlistIndexUpdate(dmbBinlistIndex *pIndex, dmbBinlist *pList, dmbUINT uFrom);
+
+/**
+ * @brief dmbBinlistIndexGet 通过索引取第uPos个元素，越界返回NULL
+ */
+dmbBinEntry* dmbBinlistIndexGet(dmbBinlistIndex *pIndex, dmbBinlist *pList, dmbUINT uPos);
+
+/**
+ * @brief dmbBinlistIndexClear 释放索引的偏移数组
+ */
+void dmbBinlistIndexClear(dmbBinlistIndex *pIndex);
 dmbUINT dmbBinContentLen(dmbBinEntry *pEntry);
 dmbBOOL dmbBinEntryIsEmpty(dmbBinEntry *pEntry);
 dmbCode dmbBinEntryGet(dmbBinEntry *pEntry, dmbBinVar *var);
@@ -112,4 +211,36 @@ typedef struct dmbFixmemAllocator{
 
 dmbBinAllocator* dmbInitFixmemAllocator(dmbFixmemAllocator *pAllocator, dmbBYTE *ptr, dmbUINT size);
 
+//updated with atomic operations, so an allocator may be shared by threads
+typedef struct dmbBinCompressStats {
+    //binlists compressed right now, their size before and after compression
+    dmbUINT64 segments;
+    dmbUINT64 rawBytes;
+    dmbUINT64 packedBytes;
+    dmbUINT64 compressions;
+    //compressions given up because they saved too little
+    dmbUINT64 rejected;
+    dmbUINT64 decodes;
+    dmbUINT64 decodeNanos;
+} dmbBinCompressStats;
+
+//malloc binlist that LZF compresses binlists of at least threshold bytes
+typedef struct dmbLzfAllocator {
+    dmbBinAllocator allocator;
+    dmbUINT threshold;
+    dmbBinCompressStats stats;
+} dmbLzfAllocator;
+
+dmbBinAllocator* dmbInitLzfAllocator(dmbLzfAllocator *pAllocator, dmbUINT uThreshold);
+
+/**
+ * @brief dmbBinCompressRatio 当前压缩数据的压缩比（原大小/压缩后大小），没有压缩数据时返回0
+ */
+double dmbBinCompressRatio(dmbBinCompressStats *pStats);
+
+/**
+ * @brief dmbBinDecodeNanos 平均每次解压的纳秒数
+ */
+double dmbBinDecodeNanos(dmbBinCompressStats *pStats);
+
 #endif // DMBBINLIST_H
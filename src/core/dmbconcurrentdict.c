@@ -0,0 +1,162 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbconcurrentdict.h"
+#include "dmballoc.h"
+#include "utils/dmbtime.h"
+
+//high bits choose the segment, the low bits are used by the segment buckets
+#define SEGMENT_OF(DICT, HASH) (&(DICT)->segments[(dmbUINT)((HASH) >> 32) & (DICT)->segmentMask])
+
+dmbConcurrentDict* dmbConcurrentDictCreate(dmbDictMeta *pMeta, dmbUINT uSegments, dmbUINT uSize)
+{
+    dmbConcurrentDict *pDict;
+    dmbUINT i, count = 1;
+
+    if (uSegments == 0)
+        uSegments = DMB_CONCURRENTDICT_DEFAULT_SEGMENTS;
+    while (count < uSegments && count < 0x10000)
+        count <<= 1;
+
+    pDict = (dmbConcurrentDict*)dmbMalloc(sizeof(dmbConcurrentDict));
+    if (pDict == NULL)
+        return NULL;
+
+    pDict->meta = pMeta;
+    pDict->segmentCount = count;
+    pDict->segmentMask = count - 1;
+    //dmbMalloc only gives 8 byte alignment, each segment has to start its own cache line
+    pDict->segments = (dmbDictSegment*)dmbMallocAligned(sizeof(dmbDictSegment) * count, 64);
+    if (pDict->segments == NULL)
+    {
+        dmbFree(pDict);
+        return NULL;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        pDict->segments[i].dict = dmbDictCreate(pMeta, uSize / count);
+        if (pDict->segments[i].dict == NULL || dmbRWLockInit(&pDict->segments[i].lock) != DMB_ERRCODE_OK)
+        {
+            if (pDict->segments[i].dict != NULL)
+                dmbDictDestroy(pDict->segments[i].dict);
+            pDict->segmentCount = i;
+            dmbConcurrentDictDestroy(pDict);
+            return NULL;
+        }
+    }
+
+    return pDict;
+}
+
+void dmbConcurrentDictDestroy(dmbConcurrentDict *pDict)
+{
+    dmbUINT i;
+
+    for (i = 0; i < pDict->segmentCount; ++i)
+    {
+        dmbDictDestroy(pDict->segments[i].dict);
+        dmbRWLockDestroy(&pDict->segments[i].lock);
+    }
+
+    dmbFreeAligned(pDict->segments);
+    dmbFree(pDict);
+}
+
+dmbBOOL dmbConcurrentDictRead(dmbConcurrentDict *pDict, const void *pKeyData, dmbSIZE size,
+                              dmbConcurrentDictReadFunc fn, void *pPrivdata)
+{
+    dmbUINT64 hash = pDict->meta->dumpHashFunc(pKeyData, size);
+    dmbDictSegment *pSegment = SEGMENT_OF(pDict, hash);
+    dmbDictEntry *pEntry;
+
+    dmbRWLockRead(&pSegment->lock);
+    //the WithHash lookup never steps the rehash, so readers don't write the segment
+    pEntry = dmbDictGetByDataWithHash(pSegment->dict, pKeyData, size, hash);
+    if (pEntry != NULL && fn != NULL)
+        fn(pPrivdata, pEntry);
+    dmbRWLockUnlock(&pSegment->lock);
+
+    return pEntry != NULL;
+}
+
+dmbDictEntry* dmbConcurrentDictPut(dmbConcurrentDict *pDict, dmbDictEntry *pEntry)
+{
+    dmbUINT64 hash = pDict->meta->hashFunc(pEntry->k.val);
+    dmbDictSegment *pSegment = SEGMENT_OF(pDict, hash);
+    dmbDictEntry *pOld;
+    void *data; dmbSIZE len;
+
+    pDict->meta->dumpKey(pEntry->k.val, &data, &len);
+
+    dmbRWLockWrite(&pSegment->lock);
+    pOld = dmbDictPopByDataWithHash(pSegment->dict, data, len, hash);
+    dmbDictPutWithHash(pSegment->dict, pEntry, hash);
+    dmbRWLockUnlock(&pSegment->lock);
+
+    return pOld;
+}
+
+dmbDictEntry* dmbConcurrentDictPopByData(dmbConcurrentDict *pDict, const void *pKeyData, dmbSIZE size)
+{
+    dmbUINT64 hash = pDict->meta->dumpHashFunc(pKeyData, size);
+    dmbDictSegment *pSegment = SEGMENT_OF(pDict, hash);
+    dmbDictEntry *pEntry;
+
+    dmbRWLockWrite(&pSegment->lock);
+    pEntry = dmbDictPopByDataWithHash(pSegment->dict, pKeyData, size, hash);
+    dmbRWLockUnlock(&pSegment->lock);
+
+    return pEntry;
+}
+
+dmbUINT dmbConcurrentDictSize(dmbConcurrentDict *pDict)
+{
+    dmbUINT i, uSize = 0;
+
+    for (i = 0; i < pDict->segmentCount; ++i)
+    {
+        dmbRWLockRead(&pDict->segments[i].lock);
+        uSize += dmbDictSize(pDict->segments[i].dict);
+        dmbRWLockUnlock(&pDict->segments[i].lock);
+    }
+
+    return uSize;
+}
+
+dmbUINT dmbConcurrentDictRehashMilliseconds(dmbConcurrentDict *pDict, dmbLONG lMillis)
+{
+    dmbLONG lStart = dmbLocalCurrentMillis();
+    dmbUINT i, uBuckets = 0;
+    dmbDictSegment *pSegment;
+
+    for (i = 0; i < pDict->segmentCount; ++i)
+    {
+        pSegment = &pDict->segments[i];
+
+        //one millisecond slices so the segment lock is never held for long
+        dmbRWLockWrite(&pSegment->lock);
+        if (dmbDictIsRehashing(pSegment->dict))
+            uBuckets += dmbDictRehashMilliseconds(pSegment->dict, 1);
+        dmbRWLockUnlock(&pSegment->lock);
+
+        if (dmbLocalCurrentMillis() - lStart >= lMillis)
+            break;
+    }
+
+    return uBuckets;
+}
@@ -0,0 +1,87 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBCONCURRENTDICT_H
+#define DMBCONCURRENTDICT_H
+
+#include "dmbdict.h"
+#include "thread/dmbthread.h"
+
+/*
+ * Keyspace dict shared by all work threads. The keys are spread over
+ * a power of two number of dmbDict segments by the high 32 bits of the hash
+ * (the segment dicts use the low bits for their buckets), every segment has
+ * its own reader-writer lock, so writers only contend inside one segment.
+ *
+ * Entries are intrusive like dmbDict: the caller owns them. An entry may only
+ * be touched inside a read callback or after it is popped/replaced, because
+ * another thread can pop it as soon as the segment lock is released.
+ */
+
+#define DMB_CONCURRENTDICT_DEFAULT_SEGMENTS 64
+
+typedef struct dmbDictSegment {
+    dmbRWLock lock;
+    dmbDict *dict;
+} __attribute__((aligned(64))) dmbDictSegment;
+
+typedef struct dmbConcurrentDict {
+    dmbDictMeta *meta;
+    dmbDictSegment *segments;
+    dmbUINT segmentCount;
+    dmbUINT segmentMask;
+} dmbConcurrentDict;
+
+typedef void (*dmbConcurrentDictReadFunc)(void *pPrivdata, dmbDictEntry *pEntry);
+
+/**
+ * @brief dmbConcurrentDictCreate 创建分段加锁的并发字典
+ * @param pMeta 字典meta
+ * @param uSegments 分段数，向上取2的幂，0使用默认值
+ * @param uSize 预估的总元素个数
+ */
+dmbConcurrentDict* dmbConcurrentDictCreate(dmbDictMeta *pMeta, dmbUINT uSegments, dmbUINT uSize);
+
+void dmbConcurrentDictDestroy(dmbConcurrentDict *pDict);
+
+/**
+ * @brief dmbConcurrentDictRead 在分段读锁内查找key并回调，回调中不能修改字典
+ * @return 找到返回TRUE
+ */
+dmbBOOL dmbConcurrentDictRead(dmbConcurrentDict *pDict, const void *pKeyData, dmbSIZE size,
+                              dmbConcurrentDictReadFunc fn, void *pPrivdata);
+
+/**
+ * @brief dmbConcurrentDictPut 插入，key已存在时替换
+ * @return 被替换的旧元素，由调用者释放，不存在返回NULL
+ */
+dmbDictEntry* dmbConcurrentDictPut(dmbConcurrentDict *pDict, dmbDictEntry *pEntry);
+
+dmbDictEntry* dmbConcurrentDictPopByData(dmbConcurrentDict *pDict, const void *pKeyData, dmbSIZE size);
+
+/**
+ * @brief dmbConcurrentDictSize 各分段元素个数之和，并发修改时只是近似值
+ */
+dmbUINT dmbConcurrentDictSize(dmbConcurrentDict *pDict);
+
+/**
+ * @brief dmbConcurrentDictRehashMilliseconds 依次推进各分段的rehash，读操作不推进rehash，需要定时调用
+ * @return 迁移的桶个数
+ */
+dmbUINT dmbConcurrentDictRehashMilliseconds(dmbConcurrentDict *pDict, dmbLONG lMillis);
+
+#endif // DMBCONCURRENTDICT_H
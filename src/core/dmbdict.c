@@ -17,60 +17,311 @@
 
 #include "dmbdict.h"
 #include "dmballoc.h"
+#include "utils/dmbtime.h"
+
+#define DMB_DICT_MIN_SIZE 4
+//expand when count/size reaches this ratio
+#define DMB_DICT_EXPAND_RATIO 1
+//shrink when count*100/size falls below this percent
+#define DMB_DICT_SHRINK_PERCENT 10
+//buckets migrated by every access while rehashing
+#define DMB_DICT_ACCESS_STEP 1
+//buckets migrated between two clock checks in dmbDictRehashMilliseconds
+#define DMB_DICT_TIMED_STEP 100
+//keys resolved together by dmbDictGetManyByData, enough to cover the memory latency
+#define DMB_DICT_PREFETCH_GROUP 16
+
+static dmbUINT nextPower(dmbUINT uSize)
+{
+    dmbUINT i = DMB_DICT_MIN_SIZE;
+
+    if (uSize >= 0x80000000U)
+        return 0x80000000U;
+
+    while (i < uSize)
+        i <<= 1;
+
+    return i;
+}
+
+static dmbCode initTable(dmbDictTable *pTable, dmbUINT uSize)
+{
+    pTable->entry = (dmbDictEntry**)dmbMalloc(sizeof(dmbDictEntry*) * uSize);
+    if (pTable->entry == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    dmbMemSet(pTable->entry, 0, sizeof(dmbDictEntry*) * uSize);
+    pTable->size = uSize;
+    pTable->sizemask = uSize - 1;
+    pTable->used = 0;
+
+    return DMB_ERRCODE_OK;
+}
+
+static void resetTable(dmbDictTable *pTable)
+{
+    pTable->entry = NULL;
+    pTable->size = 0;
+    pTable->sizemask = 0;
+    pTable->used = 0;
+}
+
+static void purgeTable(dmbDictTable *pTable)
+{
+    DMB_SAFE_FREE(pTable->entry);
+    resetTable(pTable);
+}
+
+static dmbCode resize(dmbDict *pDict, dmbUINT uSize)
+{
+    dmbCode code;
+    uSize = nextPower(uSize);
+
+    if (dmbDictIsRehashing(pDict) || uSize == pDict->table[0].size)
+        return DMB_ERRCODE_WRONG_ARGUMENT_VALUE;
+
+    code = initTable(&pDict->table[1], uSize);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    if (uSize > pDict->table[0].size)
+        pDict->expandTimes++;
+    else
+        pDict->shrinkTimes++;
+
+    pDict->rehashIndex = 0;
+
+    return DMB_ERRCODE_OK;
+}
+
+static inline void checkExpand(dmbDict *pDict)
+{
+    if (dmbDictIsRehashing(pDict))
+        return ;
+
+    if (pDict->table[0].used >= pDict->table[0].size * DMB_DICT_EXPAND_RATIO)
+        resize(pDict, pDict->table[0].used * 2);
+}
+
+static inline void checkShrink(dmbDict *pDict)
+{
+    if (dmbDictIsRehashing(pDict) || pDict->table[0].size <= pDict->minSize)
+        return ;
+
+    if ((dmbUINT64)pDict->table[0].used * 100 < (dmbUINT64)pDict->table[0].size * DMB_DICT_SHRINK_PERCENT)
+        resize(pDict, pDict->table[0].used < pDict->minSize ? pDict->minSize : pDict->table[0].used);
+}
+
+static inline dmbBOOL matchData(dmbDict *pDict, dmbDictEntry *pEntry, dmbUINT64 hash, const void *pKeyData, dmbSIZE size)
+{
+    void *data; dmbSIZE len;
+
+    //different hash means different key, no need to touch the key memory
+    if (pEntry->hash != hash)
+        return FALSE;
+
+    pDict->meta->dumpKey(pEntry->k.val, &data, &len);
+    return pDict->meta->dumpKeyCompare(pKeyData, size, data, len) == 0;
+}
+
+static inline void rehashStep(dmbDict *pDict)
+{
+    if (pDict->iterators == 0)
+        dmbDictRehash(pDict, DMB_DICT_ACCESS_STEP);
+}
 
 dmbDict* dmbDictCreate(dmbDictMeta *pMeta, dmbUINT uSize)
 {
-    dmbDict* dict = (dmbDict*)dmbMalloc(sizeof(dmbDict) + (sizeof(dmbDictEntry*)*uSize));
+    dmbDict* dict = (dmbDict*)dmbMalloc(sizeof(dmbDict));
     if (dict != NULL)
     {
-        dmbMemSet(dict, 0, sizeof(dmbDict) + (sizeof(dmbDictEntry*)*uSize));
+        dmbMemSet(dict, 0, sizeof(dmbDict));
         dict->meta = pMeta;
-        dict->size = uSize;
         dict->count = 0;
+        dict->minSize = nextPower(uSize);
+        dict->rehashIndex = -1;
+        dict->iterators = 0;
+        resetTable(&dict->table[1]);
+        if (initTable(&dict->table[0], dict->minSize) != DMB_ERRCODE_OK)
+        {
+            dmbFree(dict);
+            return NULL;
+        }
     }
     return dict;
 }
 
 void dmbDictDestroy(dmbDict *pDict)
 {
+    purgeTable(&pDict->table[0]);
+    purgeTable(&pDict->table[1]);
     dmbFree(pDict);
 }
 
 void dmbDictRemoveAll(dmbDict *pDict)
 {
-    dmbMemSet(((dmbBYTE*)pDict) + sizeof(dmbDict), 0, (sizeof(dmbDictEntry*)*pDict->size));
+    dmbDictTable table;
+
+    purgeTable(&pDict->table[1]);
+    pDict->rehashIndex = -1;
+
+    //give back the memory of a grown table if we can
+    if (pDict->table[0].size > pDict->minSize && initTable(&table, pDict->minSize) == DMB_ERRCODE_OK)
+    {
+        purgeTable(&pDict->table[0]);
+        pDict->table[0] = table;
+    }
+    else
+    {
+        dmbMemSet(pDict->table[0].entry, 0, (sizeof(dmbDictEntry*)*pDict->table[0].size));
+        pDict->table[0].used = 0;
+    }
     pDict->count = 0;
 }
 
+dmbUINT dmbDictSize(dmbDict *pDict)
+{
+    return pDict->count;
+}
+
+dmbBOOL dmbDictRehash(dmbDict *pDict, dmbUINT uStep)
+{
+    dmbDictTable *pOld = &pDict->table[0], *pNew = &pDict->table[1];
+    dmbDictEntry *pEntry, *pNext;
+    dmbUINT index, emptyVisits = uStep * 10;
+
+    if (!dmbDictIsRehashing(pDict))
+        return FALSE;
+
+    while (uStep-- && pOld->used != 0)
+    {
+        //rehashIndex can't overflow as there are more elements because used != 0
+        while (pOld->entry[pDict->rehashIndex] == NULL)
+        {
+            pDict->rehashIndex++;
+            if (--emptyVisits == 0)
+                return TRUE;
+        }
+
+        pEntry = pOld->entry[pDict->rehashIndex];
+        while (pEntry != NULL)
+        {
+            pNext = pEntry->next;
+            index = (dmbUINT)(pEntry->hash & pNew->sizemask);
+            pEntry->next = pNew->entry[index];
+            pNew->entry[index] = pEntry;
+            pOld->used--;
+            pNew->used++;
+            pDict->rehashedEntries++;
+            pEntry = pNext;
+        }
+        pOld->entry[pDict->rehashIndex] = NULL;
+        pDict->rehashIndex++;
+    }
+
+    if (pOld->used == 0)
+    {
+        purgeTable(pOld);
+        *pOld = *pNew;
+        resetTable(pNew);
+        pDict->rehashIndex = -1;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+dmbUINT dmbDictRehashMilliseconds(dmbDict *pDict, dmbLONG lMillis)
+{
+    dmbLONG lStart = dmbLocalCurrentMillis();
+    dmbUINT uMoved = 0;
+
+    if (pDict->iterators != 0)
+        return 0;
+
+    while (dmbDictRehash(pDict, DMB_DICT_TIMED_STEP))
+    {
+        uMoved += DMB_DICT_TIMED_STEP;
+        if (dmbLocalCurrentMillis() - lStart >= lMillis)
+            break;
+    }
+
+    return uMoved;
+}
+
+void dmbDictGetStats(dmbDict *pDict, dmbDictStats *pStats)
+{
+    pStats->count = pDict->count;
+    pStats->size = pDict->table[0].size + pDict->table[1].size;
+    pStats->loadFactor = pStats->size == 0 ? 0 : (dmbUINT)((dmbUINT64)pStats->count * 100 / pStats->size);
+    pStats->rehashing = dmbDictIsRehashing(pDict);
+    pStats->rehashDone = pStats->rehashing ? (dmbUINT)pDict->rehashIndex : 0;
+    pStats->rehashTotal = pStats->rehashing ? pDict->table[0].size : 0;
+    pStats->expandTimes = pDict->expandTimes;
+    pStats->shrinkTimes = pDict->shrinkTimes;
+    pStats->rehashedEntries = pDict->rehashedEntries;
+}
+
 dmbDictEntry* dmbDictGet(dmbDict *pDict, const void *pKey)
 {
-    dmbUINT index = pDict->meta->hashFunc(pKey) % pDict->size;
-    dmbDictEntry *pEntry = pDict->entry[index];
+    dmbUINT64 hash;
+    dmbUINT index, t;
+    dmbDictEntry *pEntry;
 
-    if (pEntry == NULL)
+    if (pDict->count == 0)
         return NULL;
 
-    do
+    if (dmbDictIsRehashing(pDict))
+        rehashStep(pDict);
+
+    hash = pDict->meta->hashFunc(pKey);
+    for (t = 0; t <= 1; ++t)
     {
-        if (pDict->meta->keyCompare(pKey, pEntry->k.val) == 0)
-            return pEntry;
+        index = (dmbUINT)(hash & pDict->table[t].sizemask);
+        pEntry = pDict->table[t].entry[index];
 
-        pEntry = pEntry->next;
-    } while (pEntry != NULL);
+        while (pEntry != NULL)
+        {
+            if (pEntry->hash == hash && pDict->meta->keyCompare(pKey, pEntry->k.val) == 0)
+                return pEntry;
+
+            pEntry = pEntry->next;
+        }
+
+        if (!dmbDictIsRehashing(pDict))
+            break;
+    }
 
     return NULL;
 }
 
 void dmbDictPut(dmbDict *pDict, dmbDictEntry *pEntry)
 {
-    dmbUINT index = pDict->meta->hashFunc(pEntry->k.val) % pDict->size;
-    dmbDictEntry *pDest = pDict->entry[index];
+    dmbDictPutWithHash(pDict, pEntry, pDict->meta->hashFunc(pEntry->k.val));
+}
+
+void dmbDictPutWithHash(dmbDict *pDict, dmbDictEntry *pEntry, dmbUINT64 hash)
+{
+    dmbDictTable *pTable;
+    dmbDictEntry *pDest;
+    dmbUINT index;
+
+    if (dmbDictIsRehashing(pDict))
+        rehashStep(pDict);
+    else
+        checkExpand(pDict);
+
+    //new entries always go to the new table while rehashing
+    pTable = dmbDictIsRehashing(pDict) ? &pDict->table[1] : &pDict->table[0];
+    pEntry->hash = hash;
+    index = (dmbUINT)(hash & pTable->sizemask);
+    pDest = pTable->entry[index];
     //Ensure pEntry->next is NULL.
     pEntry->next = NULL;
 
     if (pDest == NULL)
     {
-        pDict->entry[index] = pEntry;
+        pTable->entry[index] = pEntry;
     }
     else
     {
@@ -80,119 +331,365 @@ void dmbDictPut(dmbDict *pDict, dmbDictEntry *pEntry)
         pDest->next = pEntry;
     }
 
+    pTable->used++;
     pDict->count++;
 }
 
 dmbDictEntry* dmbDictPop(dmbDict *pDict, const void *pKey)
 {
-    dmbUINT index = pDict->meta->hashFunc(pKey) % pDict->size;
-    dmbDictEntry *pEntry = pDict->entry[index], *pPrev = NULL;
+    dmbUINT64 hash;
+    dmbUINT index, t;
+    dmbDictEntry *pEntry, *pPrev;
 
-    if (pEntry == NULL)
+    if (pDict->count == 0)
         return NULL;
 
-    do
+    if (dmbDictIsRehashing(pDict))
+        rehashStep(pDict);
+
+    hash = pDict->meta->hashFunc(pKey);
+    for (t = 0; t <= 1; ++t)
     {
-        if (pDict->meta->keyCompare(pKey, pEntry->k.val) == 0)
+        index = (dmbUINT)(hash & pDict->table[t].sizemask);
+        pEntry = pDict->table[t].entry[index];
+        pPrev = NULL;
+
+        while (pEntry != NULL)
         {
-            if (pDict->entry[index] == pEntry)
-            {
-                pDict->entry[index] = pEntry->next;
-            }
-            else
+            if (pEntry->hash == hash && pDict->meta->keyCompare(pKey, pEntry->k.val) == 0)
             {
-                pPrev->next = pEntry->next;
+                if (pPrev == NULL)
+                {
+                    pDict->table[t].entry[index] = pEntry->next;
+                }
+                else
+                {
+                    pPrev->next = pEntry->next;
+                }
+                pDict->table[t].used--;
+                pDict->count--;
+                checkShrink(pDict);
+                return pEntry;
             }
-            pDict->count--;
-            return pEntry;
+
+            pPrev = pEntry;
+            pEntry = pEntry->next;
         }
 
-        pPrev = pEntry;
-        pEntry = pEntry->next;
-    } while (pEntry != NULL);
+        if (!dmbDictIsRehashing(pDict))
+            break;
+    }
 
     return NULL;
 }
 
 dmbDictEntry* dmbDictGetByData(dmbDict *pDict, const void *pKeyData, dmbSIZE size)
 {
-    dmbUINT index = pDict->meta->dumpHashFunc(pKeyData, size) % pDict->size;
-    dmbDictEntry *pEntry = pDict->entry[index];
-    void *data; dmbSIZE len;
+    if (pDict->count == 0)
+        return NULL;
+
+    if (dmbDictIsRehashing(pDict))
+        rehashStep(pDict);
 
-    if (pEntry == NULL)
+    return dmbDictGetByDataWithHash(pDict, pKeyData, size, pDict->meta->dumpHashFunc(pKeyData, size));
+}
+
+dmbDictEntry* dmbDictGetByDataWithHash(dmbDict *pDict, const void *pKeyData, dmbSIZE size, dmbUINT64 hash)
+{
+    dmbUINT index, t;
+    dmbDictEntry *pEntry;
+
+    if (pDict->count == 0)
         return NULL;
 
-    do
+    for (t = 0; t <= 1; ++t)
     {
-        pDict->meta->dumpKey(pEntry->k.val, &data, &len);
-        if (pDict->meta->dumpKeyCompare(pKeyData, size, data, len) == 0)
-            return pEntry;
+        index = (dmbUINT)(hash & pDict->table[t].sizemask);
+        pEntry = pDict->table[t].entry[index];
+
+        while (pEntry != NULL)
+        {
+            if (matchData(pDict, pEntry, hash, pKeyData, size))
+                return pEntry;
 
-        pEntry = pEntry->next;
-    } while (pEntry != NULL);
+            pEntry = pEntry->next;
+        }
+
+        if (!dmbDictIsRehashing(pDict))
+            break;
+    }
 
     return NULL;
 }
 
-dmbDictEntry* dmbDictPopByData(dmbDict *pDict, const void *pKeyData, dmbSIZE size)
+static void getGroupByData(dmbDict *pDict, const void **ppKeyData, const dmbSIZE *pSizes, dmbUINT uCount, dmbDictEntry **ppEntrys)
 {
-    dmbUINT index = pDict->meta->dumpHashFunc(pKeyData, size) % pDict->size;
-    dmbDictEntry *pEntry = pDict->entry[index], *pPrev = NULL;
-    void *data; dmbSIZE len;
+    dmbUINT64 hashes[DMB_DICT_PREFETCH_GROUP];
+    dmbDictEntry *heads[DMB_DICT_PREFETCH_GROUP][2];
+    dmbDictEntry *pEntry;
+    dmbDictTable *pTable;
+    dmbUINT i, t, tables = dmbDictIsRehashing(pDict) ? 2 : 1;
+
+    //hash every key and ask for its buckets
+    for (i = 0; i < uCount; ++i)
+    {
+        hashes[i] = pDict->meta->dumpHashFunc(ppKeyData[i], pSizes[i]);
+        for (t = 0; t < tables; ++t)
+        {
+            pTable = &pDict->table[t];
+            __builtin_prefetch(&pTable->entry[hashes[i] & pTable->sizemask], 0, 1);
+        }
+    }
 
-    if (pEntry == NULL)
-        return NULL;
+    //the buckets have arrived by now, ask for the chain heads
+    for (i = 0; i < uCount; ++i)
+    {
+        heads[i][1] = NULL;
+        for (t = 0; t < tables; ++t)
+        {
+            pTable = &pDict->table[t];
+            heads[i][t] = pTable->entry[hashes[i] & pTable->sizemask];
+            if (heads[i][t] != NULL)
+                __builtin_prefetch(heads[i][t], 0, 1);
+        }
+    }
 
-    do
+    //ask for the key of the heads that are likely to match
+    for (i = 0; i < uCount; ++i)
     {
-        pDict->meta->dumpKey(pEntry->k.val, &data, &len);
-        if (pDict->meta->dumpKeyCompare(pKeyData, size, data, len) == 0)
+        for (t = 0; t < tables; ++t)
         {
-            if (pDict->entry[index] == pEntry)
+            if (heads[i][t] != NULL && heads[i][t]->hash == hashes[i])
+                __builtin_prefetch(heads[i][t]->k.val, 0, 1);
+        }
+    }
+
+    //resolve, longer chains fall back to plain pointer chasing
+    for (i = 0; i < uCount; ++i)
+    {
+        ppEntrys[i] = NULL;
+        for (t = 0; t < tables && ppEntrys[i] == NULL; ++t)
+        {
+            for (pEntry = heads[i][t]; pEntry != NULL; pEntry = pEntry->next)
             {
-                pDict->entry[index] = pEntry->next;
+                if (matchData(pDict, pEntry, hashes[i], ppKeyData[i], pSizes[i]))
+                {
+                    ppEntrys[i] = pEntry;
+                    break;
+                }
             }
-            else
+        }
+    }
+}
+
+dmbUINT dmbDictGetManyByData(dmbDict *pDict, const void **ppKeyData, const dmbSIZE *pSizes, dmbUINT uCount, dmbDictEntry **ppEntrys)
+{
+    dmbUINT i, n, uFound = 0;
+
+    if (pDict->count == 0)
+    {
+        for (i = 0; i < uCount; ++i)
+            ppEntrys[i] = NULL;
+        return 0;
+    }
+
+    for (i = 0; i < uCount; i += n)
+    {
+        n = uCount - i < DMB_DICT_PREFETCH_GROUP ? uCount - i : DMB_DICT_PREFETCH_GROUP;
+
+        //same progress as n single lookups, but never between the stages of a group
+        if (dmbDictIsRehashing(pDict) && pDict->iterators == 0)
+            dmbDictRehash(pDict, n * DMB_DICT_ACCESS_STEP);
+
+        getGroupByData(pDict, ppKeyData + i, pSizes + i, n, ppEntrys + i);
+    }
+
+    for (i = 0; i < uCount; ++i)
+        uFound += ppEntrys[i] != NULL;
+
+    return uFound;
+}
+
+dmbDictEntry* dmbDictPopByData(dmbDict *pDict, const void *pKeyData, dmbSIZE size)
+{
+    return dmbDictPopByDataWithHash(pDict, pKeyData, size, pDict->meta->dumpHashFunc(pKeyData, size));
+}
+
+dmbDictEntry* dmbDictPopByDataWithHash(dmbDict *pDict, const void *pKeyData, dmbSIZE size, dmbUINT64 hash)
+{
+    dmbUINT index, t;
+    dmbDictEntry *pEntry, *pPrev;
+
+    if (pDict->count == 0)
+        return NULL;
+
+    if (dmbDictIsRehashing(pDict))
+        rehashStep(pDict);
+
+    for (t = 0; t <= 1; ++t)
+    {
+        index = (dmbUINT)(hash & pDict->table[t].sizemask);
+        pEntry = pDict->table[t].entry[index];
+        pPrev = NULL;
+
+        while (pEntry != NULL)
+        {
+            if (matchData(pDict, pEntry, hash, pKeyData, size))
             {
-                pPrev->next = pEntry->next;
+                if (pPrev == NULL)
+                {
+                    pDict->table[t].entry[index] = pEntry->next;
+                }
+                else
+                {
+                    pPrev->next = pEntry->next;
+                }
+                pDict->table[t].used--;
+                pDict->count--;
+                checkShrink(pDict);
+                return pEntry;
             }
-            pDict->count--;
-            return pEntry;
+
+            pPrev = pEntry;
+            pEntry = pEntry->next;
         }
 
-        pPrev = pEntry;
-        pEntry = pEntry->next;
-    } while (pEntry != NULL);
+        if (!dmbDictIsRehashing(pDict))
+            break;
+    }
 
     return NULL;
 }
 
+static inline dmbUINT64 reverseBits(dmbUINT64 v)
+{
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(v);
+}
+
+static void scanBucket(dmbDictTable *pTable, dmbUINT64 cursor, dmbDictScanFunc fn, void *pPrivdata)
+{
+    dmbDictEntry *pEntry, *pNext;
+
+    pEntry = pTable->entry[cursor & pTable->sizemask];
+    while (pEntry != NULL)
+    {
+        //saved before so that fn can pop the current one
+        pNext = pEntry->next;
+        fn(pPrivdata, pEntry);
+        pEntry = pNext;
+    }
+}
+
+dmbUINT64 dmbDictScan(dmbDict *pDict, dmbUINT64 cursor, dmbDictScanFunc fn, void *pPrivdata)
+{
+    dmbDictTable *pSmall, *pLarge;
+    dmbUINT64 m0, m1;
+
+    if (pDict->count == 0)
+        return 0;
+
+    //fn may access the dict, entries must not move under our feet
+    pDict->iterators++;
+
+    if (!dmbDictIsRehashing(pDict))
+    {
+        pSmall = &pDict->table[0];
+        m0 = pSmall->sizemask;
+        scanBucket(pSmall, cursor, fn, pPrivdata);
+
+        //increase the reversed cursor, so buckets split or merged by a resize
+        //are still visited exactly in the order of the old table
+        cursor |= ~m0;
+        cursor = reverseBits(cursor);
+        cursor++;
+        cursor = reverseBits(cursor);
+    }
+    else
+    {
+        pSmall = &pDict->table[0];
+        pLarge = &pDict->table[1];
+        if (pSmall->size > pLarge->size)
+        {
+            pSmall = &pDict->table[1];
+            pLarge = &pDict->table[0];
+        }
+
+        m0 = pSmall->sizemask;
+        m1 = pLarge->sizemask;
+
+        scanBucket(pSmall, cursor, fn, pPrivdata);
+
+        //every bucket of the larger table that the small bucket expands to, stepping
+        //the reversed cursor of the large table also leaves it on the next small bucket
+        do
+        {
+            scanBucket(pLarge, cursor, fn, pPrivdata);
+            cursor |= ~m1;
+            cursor = reverseBits(cursor);
+            cursor++;
+            cursor = reverseBits(cursor);
+        } while (cursor & (m0 ^ m1));
+    }
+
+    pDict->iterators--;
+
+    return cursor;
+}
+
 void dmbDictInitIter(dmbDict *pDict, dmbDictIter *pIter)
 {
     pIter->entry = NULL;
+    pIter->nextEntry = NULL;
     //dmbDictNext will increase to to 0
     pIter->index = -1;
+    pIter->table = 0;
     pIter->dict = pDict;
+    pIter->paused = TRUE;
+    pDict->iterators++;
 }
 
 dmbDictEntry* dmbDictNext(dmbDictIter *pIter)
 {
-    //move to next entry
-    if (pIter->entry != NULL)
-        pIter->entry = pIter->entry->next;
+    dmbDictTable *pTable;
+
+    //move to next entry, saved before so that the current one can be popped
+    pIter->entry = pIter->nextEntry;
 
     //find next bucket
     while (pIter->entry == NULL)
     {
-        //end
-        if ((dmbUINT)(pIter->index + 1) >= pIter->dict->size)
+        pTable = &pIter->dict->table[pIter->table];
+        //end of table
+        if ((dmbUINT)(pIter->index + 1) >= pTable->size)
+        {
+            if (pIter->table == 0 && dmbDictIsRehashing(pIter->dict))
+            {
+                pIter->table = 1;
+                pIter->index = -1;
+                continue;
+            }
+            dmbDictReleaseIter(pIter);
             break;
+        }
         else
             ++(pIter->index);
 
-        pIter->entry = pIter->dict->entry[pIter->index];
+        pIter->entry = pTable->entry[pIter->index];
     };
 
+    pIter->nextEntry = pIter->entry != NULL ? pIter->entry->next : NULL;
+
     return pIter->entry;
 }
+
+void dmbDictReleaseIter(dmbDictIter *pIter)
+{
+    if (pIter->paused)
+    {
+        pIter->paused = FALSE;
+        pIter->dict->iterators--;
+    }
+}
@@ -33,51 +33,145 @@ typedef struct dmbDictEntry {
         dmbUINT64 u64;
         dmbINT64 i64;
         dmbLONG l;
+        double d;
     } v;
     struct dmbDictEntry *next;
+    //hash of k, set by dmbDictPut, checked before keyCompare and reused by rehash
+    dmbUINT64 hash;
 } dmbDictEntry;
 
 #define DMB_DICT_GETLONG(ENTRY) ((ENTRY)->v.l)
 
 typedef struct dmbDictMeta {
-    dmbUINT (*hashFunc) (const void *pKey);
+    dmbUINT64 (*hashFunc) (const void *pKey);
     dmbINT (*keyCompare) (const void *pKey1, const void *pKey2);
     void (*dumpKey) (const void *pKey, void **pKeyData, dmbSIZE *pKeyLen);
-    dmbUINT (*dumpHashFunc) (const void *pKeyData, dmbSIZE dataSize);
+    dmbUINT64 (*dumpHashFunc) (const void *pKeyData, dmbSIZE dataSize);
     dmbINT (*dumpKeyCompare)(const void *pKey1Data, dmbSIZE key1Len, const void *pKey2Data, dmbSIZE key2Len);
 } dmbDictMeta;
 
+typedef struct dmbDictTable {
+    dmbDictEntry **entry;
+    dmbUINT size;
+    dmbUINT sizemask;
+    dmbUINT used;
+} dmbDictTable;
+
 typedef struct dmbDict {
     dmbDictMeta *meta;
     dmbUINT count;
-    dmbUINT size;
-    dmbDictEntry *entry[];
+    dmbUINT minSize;
+    //-1 means not rehashing, otherwise the next bucket of table[0] to migrate
+    dmbLONG rehashIndex;
+    //iterators in use, rehash steps are paused while it is not 0
+    dmbINT iterators;
+    dmbDictTable table[2];
+    dmbUINT64 expandTimes;
+    dmbUINT64 shrinkTimes;
+    dmbUINT64 rehashedEntries;
 } dmbDict;
 
+typedef struct dmbDictStats {
+    dmbUINT count;
+    dmbUINT size;
+    //count * 100 / size
+    dmbUINT loadFactor;
+    dmbBOOL rehashing;
+    //buckets of the old table already migrated / to migrate
+    dmbUINT rehashDone;
+    dmbUINT rehashTotal;
+    dmbUINT64 expandTimes;
+    dmbUINT64 shrinkTimes;
+    dmbUINT64 rehashedEntries;
+} dmbDictStats;
+
 typedef struct dmbDictIter {
     dmbDict *dict;
     dmbDictEntry *entry;
+    dmbDictEntry *nextEntry;
     dmbINT index;
+    dmbINT table;
+    dmbBOOL paused;
 } dmbDictIter;
 
+typedef void (*dmbDictScanFunc)(void *pPrivdata, dmbDictEntry *pEntry);
+
+#define dmbDictIsRehashing(DICT) ((DICT)->rehashIndex != -1)
+
 dmbDict* dmbDictCreate(dmbDictMeta *pMeta, dmbUINT uSize);
 
 void dmbDictDestroy(dmbDict *pDict);
 
 void dmbDictRemoveAll(dmbDict *pDict);
 
+dmbUINT dmbDictSize(dmbDict *pDict);
+
 dmbDictEntry* dmbDictGet(dmbDict *pDict, const void *pKey);
 
 dmbDictEntry* dmbDictPop(dmbDict *pDict, const void *pKey);
 
 dmbDictEntry* dmbDictGetByData(dmbDict *pDict, const void *pKeyData, dmbSIZE size);
 
+/**
+ * @brief dmbDictGetManyByData 批量查找，先计算所有key的hash并预取桶，再统一遍历链表，隐藏缓存缺失延迟
+ * @param pDict 字典
+ * @param ppKeyData key数据数组
+ * @param pSizes key长度数组
+ * @param uCount key个数
+ * @param ppEntrys 输出，与key一一对应，未找到为NULL
+ * @return 找到的个数
+ */
+dmbUINT dmbDictGetManyByData(dmbDict *pDict, const void **ppKeyData, const dmbSIZE *pSizes, dmbUINT uCount, dmbDictEntry **ppEntrys);
+
 dmbDictEntry* dmbDictPopByData(dmbDict *pDict, const void *pKeyData, dmbSIZE size);
 
 void dmbDictPut(dmbDict *pDict, dmbDictEntry *pEntry);
 
+/**
+ * @brief dmbDictGetByDataWithHash 使用调用者已计算的hash查找，不推进rehash，不修改字典，可以在读锁下并发调用
+ */
+dmbDictEntry* dmbDictGetByDataWithHash(dmbDict *pDict, const void *pKeyData, dmbSIZE size, dmbUINT64 hash);
+
+dmbDictEntry* dmbDictPopByDataWithHash(dmbDict *pDict, const void *pKeyData, dmbSIZE size, dmbUINT64 hash);
+
+void dmbDictPutWithHash(dmbDict *pDict, dmbDictEntry *pEntry, dmbUINT64 hash);
+
+/**
+ * @brief dmbDictRehash 迁移最多uStep个桶到新表
+ * @param pDict 字典
+ * @param uStep 桶个数
+ * @return 迁移仍未完成返回TRUE，否则返回FALSE
+ */
+dmbBOOL dmbDictRehash(dmbDict *pDict, dmbUINT uStep);
+
+/**
+ * @brief dmbDictRehashMilliseconds 在指定时间内持续迁移，用于后台定时任务
+ * @param pDict 字典
+ * @param lMillis 最长执行时间，单位毫秒
+ * @return 迁移的桶个数
+ */
+dmbUINT dmbDictRehashMilliseconds(dmbDict *pDict, dmbLONG lMillis);
+
+void dmbDictGetStats(dmbDict *pDict, dmbDictStats *pStats);
+
+/**
+ * @brief dmbDictScan 无状态游标遍历，每次只访问一个桶（rehash时加上新表中对应的桶），
+ *        两次调用之间字典可以任意增删和扩缩容，全程存在的元素至少返回一次，可能重复
+ * @param pDict 字典
+ * @param cursor 游标，第一次传0
+ * @param fn 每个元素的回调，可以删除当前元素
+ * @param pPrivdata 回调参数
+ * @return 下一次的游标，返回0表示遍历结束
+ */
+dmbUINT64 dmbDictScan(dmbDict *pDict, dmbUINT64 cursor, dmbDictScanFunc fn, void *pPrivdata);
+
+/**
+ * @brief dmbDictInitIter 初始化迭代器，迭代期间暂停rehash，遍历结束或调用dmbDictReleaseIter后恢复
+ */
 void dmbDictInitIter(dmbDict *pDict, dmbDictIter *pIter);
 
 dmbDictEntry* dmbDictNext(dmbDictIter *pIter);
 
+void dmbDictReleaseIter(dmbDictIter *pIter);
+
 #endif // DMBDICT_H
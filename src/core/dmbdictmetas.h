@@ -22,6 +22,7 @@
 #include "base/dmbobject.h"
 #include "dmbdict.h"
 #include "dmballoc.h"
+#include "dmbhash.h"
 
 static inline __attribute__((always_inline)) dmbINT dmbCompareLong(dmbLONG l1, dmbLONG l2)
 {
@@ -35,28 +36,22 @@ static inline dmbINT dmbStringDumpKeyCompare (const void *pKey1Data, dmbSIZE key
 //        return ret;
 
 //    return dmbMemCmp(pKey1Data, pKey2Data, key1Len);
-    dmbINT ret = dmbMemCmp(pKey1Data, pKey2Data, key1Len);
+    dmbINT ret = dmbMemCmp(pKey1Data, pKey2Data, key1Len < key2Len ? key1Len : key2Len);
     if (ret == 0)
         ret = dmbCompareLong(key1Len, key2Len);
     return ret;
 }
 
-static inline dmbUINT dmbStringDumpHashFunc (const void *pKey, dmbSIZE len)
+static inline dmbUINT64 dmbStringDumpHashFunc (const void *pKey, dmbSIZE len)
 {
-    dmbUINT hash = 5381;
-    dmbSIZE i;
-    dmbCHAR *key = (dmbCHAR*)pKey;
-
-    for (i = 0; i < len; i++)
-    {
-        hash += (hash << 5) + key[i];
-    }
-    return hash;
+    return dmbHash(pKey, len);
 }
 
 static inline void dmbStringDumpKey (const void *pKey, void **pKeyData, dmbSIZE *pKeyLen)
 {
-    dmbStringGetData((const dmbString*)pKey, (const dmbCHAR **)pKeyData, (dmbUINT*)pKeyLen);
+    dmbUINT uLen;
+    dmbStringGetData((const dmbString*)pKey, (const dmbCHAR **)pKeyData, &uLen);
+    *pKeyLen = uLen;
 }
 
 static inline dmbINT dmbStringKeyCompare (const void *pKey1, const void *pKey2)
@@ -69,7 +64,7 @@ static inline dmbINT dmbStringKeyCompare (const void *pKey1, const void *pKey2)
     return dmbStringDumpKeyCompare(v1, n1, v2, n2);
 }
 
-static inline dmbUINT dmbStringHashFunc (const void *pKey)
+static inline dmbUINT64 dmbStringHashFunc (const void *pKey)
 {
     dmbSIZE len;
     void *key;
@@ -78,7 +73,7 @@ static inline dmbUINT dmbStringHashFunc (const void *pKey)
     return dmbStringDumpHashFunc(key, len);
 }
 
-static inline dmbUINT dmbStringObjHashFunc (const void *pKey)
+static inline dmbUINT64 dmbStringObjHashFunc (const void *pKey)
 {
     return dmbStringHashFunc((void*)((dmbObject*)pKey)->ptr);
 }
@@ -90,7 +85,7 @@ static inline dmbINT dmbStringObjKeyCompare (const void *pKey1, const void *pKey
 
 static inline void dmbStringObjDumpKey (const void *pKey, void **pKeyData, dmbSIZE *pKeyLen)
 {
-    dmbStringGetData((const dmbString*)((dmbObject*)pKey)->ptr, (const dmbCHAR **)pKeyData, (dmbUINT*)pKeyLen);
+    dmbStringDumpKey((void*)((dmbObject*)pKey)->ptr, pKeyData, pKeyLen);
 }
 
 extern struct dmbDictMeta dmbDictMetaStrObj;
@@ -0,0 +1,82 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbfenwick.h"
+#include "dmballoc.h"
+
+dmbCode dmbFenwickInit(dmbFenwick *pTree, dmbUINT uSize)
+{
+    pTree->tree = (dmbLONG*)dmbMalloc(sizeof(dmbLONG) * (uSize + 1));
+    if (pTree->tree == NULL)
+    {
+        pTree->size = 0;
+        return DMB_ERRCODE_ALLOC_FAILED;
+    }
+
+    dmbMemSet(pTree->tree, 0, sizeof(dmbLONG) * (uSize + 1));
+    pTree->size = uSize;
+
+    return DMB_ERRCODE_OK;
+}
+
+void dmbFenwickClear(dmbFenwick *pTree)
+{
+    dmbFree(pTree->tree);
+    pTree->tree = NULL;
+    pTree->size = 0;
+}
+
+void dmbFenwickAdd(dmbFenwick *pTree, dmbUINT uPos, dmbLONG lDelta)
+{
+    dmbUINT i;
+
+    for (i = uPos + 1; i <= pTree->size; i += i & -i)
+        pTree->tree[i] += lDelta;
+}
+
+dmbLONG dmbFenwickPrefix(dmbFenwick *pTree, dmbUINT uPos)
+{
+    dmbLONG lSum = 0;
+    dmbUINT i;
+
+    for (i = uPos; i > 0; i -= i & -i)
+        lSum += pTree->tree[i];
+
+    return lSum;
+}
+
+dmbUINT dmbFenwickFind(dmbFenwick *pTree, dmbLONG lRank, dmbLONG *pBefore)
+{
+    dmbUINT uPos = 0, uStep = 1;
+    dmbLONG lLeft = lRank;
+
+    while (uStep <= pTree->size / 2)
+        uStep <<= 1;
+
+    //descend from the largest power of two, keeping the prefix at most lRank
+    for (; uStep > 0; uStep >>= 1)
+    {
+        if (uPos + uStep <= pTree->size && pTree->tree[uPos + uStep] <= lLeft)
+        {
+            uPos += uStep;
+            lLeft -= pTree->tree[uPos];
+        }
+    }
+
+    *pBefore = lRank - lLeft;
+    return uPos;
+}
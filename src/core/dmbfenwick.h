@@ -0,0 +1,58 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBFENWICK_H
+#define DMBFENWICK_H
+
+#include "dmbdefines.h"
+
+/*
+ * Fenwick (binary indexed) tree over size non-negative counts: changing a
+ * count, a prefix sum and finding the position of the n-th counted item
+ * are all O(log size). Positions are 0 based.
+ */
+
+typedef struct dmbFenwick {
+    //1 based, tree[i] sums the i & -i counts ending at position i - 1
+    dmbLONG *tree;
+    dmbUINT size;
+} dmbFenwick;
+
+/**
+ * @brief dmbFenwickInit 创建uSize个计数都为0的树
+ */
+dmbCode dmbFenwickInit(dmbFenwick *pTree, dmbUINT uSize);
+
+void dmbFenwickClear(dmbFenwick *pTree);
+
+/**
+ * @brief dmbFenwickAdd 第uPos个计数加上lDelta
+ */
+void dmbFenwickAdd(dmbFenwick *pTree, dmbUINT uPos, dmbLONG lDelta);
+
+/**
+ * @brief dmbFenwickPrefix 前uPos个计数之和，即[0, uPos)
+ */
+dmbLONG dmbFenwickPrefix(dmbFenwick *pTree, dmbUINT uPos);
+
+/**
+ * @brief dmbFenwickFind 第lRank个（从0开始）计数项所在的位置，*pBefore为该位置之前的计数之和，
+ *        lRank不小于总数时返回size
+ */
+dmbUINT dmbFenwickFind(dmbFenwick *pTree, dmbLONG lRank, dmbLONG *pBefore);
+
+#endif // DMBFENWICK_H
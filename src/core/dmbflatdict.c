@@ -0,0 +1,392 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbflatdict.h"
+#include "dmballoc.h"
+
+#if defined(__SSE2__) && !defined(DMB_FLATDICT_NO_SIMD)
+#include <emmintrin.h>
+#define DMB_FLATDICT_SSE2
+#endif
+
+#define MIN_CAPACITY DMB_FLATDICT_GROUP
+//keep 1/8 slots empty, so that every probe sequence ends at an empty group
+#define MAX_LOAD(CAP) ((CAP) - ((CAP) >> 3))
+
+#define IS_FULL(CTRL) ((CTRL) >= 0)
+#define H1(HASH) ((dmbUINT)((HASH) >> 7))
+#define H2(HASH) ((dmbINT8)((HASH) & 0x7F))
+
+typedef dmbUINT dmbGroupMask;
+
+#ifdef DMB_FLATDICT_SSE2
+static inline dmbGroupMask matchTag(const dmbINT8 *pCtrl, dmbINT8 tag)
+{
+    __m128i group = _mm_loadu_si128((const __m128i*)pCtrl);
+    return (dmbGroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), group));
+}
+
+static inline dmbGroupMask matchEmpty(const dmbINT8 *pCtrl)
+{
+    return matchTag(pCtrl, DMB_FLATDICT_EMPTY);
+}
+
+static inline dmbGroupMask matchEmptyOrDeleted(const dmbINT8 *pCtrl)
+{
+    //EMPTY and DELETED are the only negative control bytes
+    return (dmbGroupMask)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)pCtrl));
+}
+#else
+static inline dmbGroupMask matchTag(const dmbINT8 *pCtrl, dmbINT8 tag)
+{
+    dmbGroupMask mask = 0;
+    dmbUINT i;
+    for (i=0; i<DMB_FLATDICT_GROUP; ++i)
+        mask |= (dmbGroupMask)(pCtrl[i] == tag) << i;
+    return mask;
+}
+
+static inline dmbGroupMask matchEmpty(const dmbINT8 *pCtrl)
+{
+    return matchTag(pCtrl, DMB_FLATDICT_EMPTY);
+}
+
+static inline dmbGroupMask matchEmptyOrDeleted(const dmbINT8 *pCtrl)
+{
+    dmbGroupMask mask = 0;
+    dmbUINT i;
+    for (i=0; i<DMB_FLATDICT_GROUP; ++i)
+        mask |= (dmbGroupMask)(pCtrl[i] < 0) << i;
+    return mask;
+}
+#endif
+
+static inline void setCtrl(dmbFlatDict *pDict, dmbUINT index, dmbINT8 ctrl)
+{
+    pDict->ctrl[index] = ctrl;
+    //the bytes after capacity mirror the first group, so a group can be loaded at any index
+    if (index < DMB_FLATDICT_GROUP)
+        pDict->ctrl[pDict->capacity + index] = ctrl;
+}
+
+static dmbUINT nextPower(dmbUINT uSize)
+{
+    dmbUINT i = MIN_CAPACITY;
+
+    if (uSize >= 0x80000000U)
+        return 0x80000000U;
+
+    while (i < uSize)
+        i <<= 1;
+
+    return i;
+}
+
+static dmbCode initTable(dmbFlatDict *pDict, dmbUINT uCapacity)
+{
+    dmbBYTE *p = (dmbBYTE*)dmbMalloc(sizeof(dmbFlatDictEntry) * uCapacity + uCapacity + DMB_FLATDICT_GROUP);
+    if (p == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    pDict->slots = (dmbFlatDictEntry*)p;
+    pDict->ctrl = (dmbINT8*)(p + sizeof(dmbFlatDictEntry) * uCapacity);
+    dmbMemSet(pDict->ctrl, DMB_FLATDICT_EMPTY, uCapacity + DMB_FLATDICT_GROUP);
+    pDict->capacity = uCapacity;
+    pDict->mask = uCapacity - 1;
+    pDict->count = 0;
+    pDict->deleted = 0;
+
+    return DMB_ERRCODE_OK;
+}
+
+//first empty or deleted slot on the probe sequence of hash
+static inline dmbUINT findInsertSlot(dmbFlatDict *pDict, dmbUINT64 hash)
+{
+    dmbUINT pos = H1(hash) & pDict->mask, step = 0;
+    dmbGroupMask bits;
+
+    while (TRUE)
+    {
+        bits = matchEmptyOrDeleted(pDict->ctrl + pos);
+        if (bits != 0)
+            return (pos + __builtin_ctz(bits)) & pDict->mask;
+
+        step += DMB_FLATDICT_GROUP;
+        pos = (pos + step) & pDict->mask;
+    }
+}
+
+static dmbCode resize(dmbFlatDict *pDict, dmbUINT uCapacity)
+{
+    dmbFlatDict old = *pDict;
+    dmbUINT i, index;
+    dmbUINT64 hash;
+    dmbCode code = initTable(pDict, uCapacity);
+    if (code != DMB_ERRCODE_OK)
+    {
+        *pDict = old;
+        return code;
+    }
+
+    for (i=0; i<old.capacity; ++i)
+    {
+        if (!IS_FULL(old.ctrl[i]))
+            continue;
+
+        hash = pDict->meta->hashFunc(old.slots[i].k.val);
+        index = findInsertSlot(pDict, hash);
+        setCtrl(pDict, index, H2(hash));
+        pDict->slots[index] = old.slots[i];
+    }
+    pDict->count = old.count;
+
+    dmbFree(old.slots);
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbFlatDict* dmbFlatDictCreate(dmbDictMeta *pMeta, dmbUINT uSize)
+{
+    dmbFlatDict* pDict = (dmbFlatDict*)dmbMalloc(sizeof(dmbFlatDict));
+    if (pDict != NULL)
+    {
+        pDict->meta = pMeta;
+        //capacity for uSize entries below the max load
+        pDict->minSize = nextPower(uSize + (uSize >> 3));
+        if (initTable(pDict, pDict->minSize) != DMB_ERRCODE_OK)
+        {
+            dmbFree(pDict);
+            return NULL;
+        }
+    }
+    return pDict;
+}
+
+void dmbFlatDictDestroy(dmbFlatDict *pDict)
+{
+    dmbFree(pDict->slots);
+    dmbFree(pDict);
+}
+
+void dmbFlatDictRemoveAll(dmbFlatDict *pDict)
+{
+    dmbFlatDict old = *pDict;
+
+    if (pDict->capacity > pDict->minSize && initTable(pDict, pDict->minSize) == DMB_ERRCODE_OK)
+    {
+        dmbFree(old.slots);
+        return ;
+    }
+
+    dmbMemSet(pDict->ctrl, DMB_FLATDICT_EMPTY, pDict->capacity + DMB_FLATDICT_GROUP);
+    pDict->count = 0;
+    pDict->deleted = 0;
+}
+
+dmbUINT dmbFlatDictSize(dmbFlatDict *pDict)
+{
+    return pDict->count;
+}
+
+static inline dmbINT findIndex(dmbFlatDict *pDict, const void *pKey, dmbUINT64 hash)
+{
+    dmbUINT pos = H1(hash) & pDict->mask, step = 0, index;
+    dmbINT8 tag = H2(hash);
+    dmbGroupMask bits;
+
+    while (TRUE)
+    {
+        bits = matchTag(pDict->ctrl + pos, tag);
+        while (bits != 0)
+        {
+            index = (pos + __builtin_ctz(bits)) & pDict->mask;
+            if (pDict->meta->keyCompare(pKey, pDict->slots[index].k.val) == 0)
+                return (dmbINT)index;
+            bits &= bits - 1;
+        }
+
+        if (matchEmpty(pDict->ctrl + pos) != 0)
+            return -1;
+
+        step += DMB_FLATDICT_GROUP;
+        pos = (pos + step) & pDict->mask;
+    }
+}
+
+static inline dmbINT findIndexByData(dmbFlatDict *pDict, const void *pKeyData, dmbSIZE size, dmbUINT64 hash)
+{
+    dmbUINT pos = H1(hash) & pDict->mask, step = 0, index;
+    dmbINT8 tag = H2(hash);
+    dmbGroupMask bits;
+    void *data; dmbSIZE len;
+
+    while (TRUE)
+    {
+        bits = matchTag(pDict->ctrl + pos, tag);
+        while (bits != 0)
+        {
+            index = (pos + __builtin_ctz(bits)) & pDict->mask;
+            pDict->meta->dumpKey(pDict->slots[index].k.val, &data, &len);
+            if (pDict->meta->dumpKeyCompare(pKeyData, size, data, len) == 0)
+                return (dmbINT)index;
+            bits &= bits - 1;
+        }
+
+        if (matchEmpty(pDict->ctrl + pos) != 0)
+            return -1;
+
+        step += DMB_FLATDICT_GROUP;
+        pos = (pos + step) & pDict->mask;
+    }
+}
+
+dmbFlatDictEntry* dmbFlatDictGet(dmbFlatDict *pDict, const void *pKey)
+{
+    dmbINT index;
+
+    if (pDict->count == 0)
+        return NULL;
+
+    index = findIndex(pDict, pKey, pDict->meta->hashFunc(pKey));
+    return index < 0 ? NULL : &pDict->slots[index];
+}
+
+dmbFlatDictEntry* dmbFlatDictGetByData(dmbFlatDict *pDict, const void *pKeyData, dmbSIZE size)
+{
+    dmbINT index;
+
+    if (pDict->count == 0)
+        return NULL;
+
+    index = findIndexByData(pDict, pKeyData, size, pDict->meta->dumpHashFunc(pKeyData, size));
+    return index < 0 ? NULL : &pDict->slots[index];
+}
+
+dmbFlatDictEntry* dmbFlatDictPut(dmbFlatDict *pDict, void *pKey, dmbBOOL *pExisted)
+{
+    dmbUINT64 hash = pDict->meta->hashFunc(pKey);
+    dmbINT index = findIndex(pDict, pKey, hash);
+    dmbUINT uSlot;
+
+    if (pExisted != NULL)
+        *pExisted = index >= 0;
+
+    if (index >= 0)
+        return &pDict->slots[index];
+
+    if (pDict->count + pDict->deleted + 1 > MAX_LOAD(pDict->capacity))
+    {
+        //mostly tombstones, rehash in place to clean them
+        if (pDict->count + 1 <= MAX_LOAD(pDict->capacity) / 2)
+        {
+            if (resize(pDict, pDict->capacity) != DMB_ERRCODE_OK)
+                return NULL;
+        }
+        else if (pDict->capacity == 0x80000000U || resize(pDict, pDict->capacity << 1) != DMB_ERRCODE_OK)
+        {
+            return NULL;
+        }
+    }
+
+    uSlot = findInsertSlot(pDict, hash);
+    if (pDict->ctrl[uSlot] == DMB_FLATDICT_DELETED)
+        pDict->deleted--;
+
+    setCtrl(pDict, uSlot, H2(hash));
+    pDict->slots[uSlot].k.val = pKey;
+    pDict->slots[uSlot].v.val = NULL;
+    pDict->count++;
+
+    return &pDict->slots[uSlot];
+}
+
+static void eraseIndex(dmbFlatDict *pDict, dmbUINT index)
+{
+    dmbGroupMask before = matchEmpty(pDict->ctrl + ((index - DMB_FLATDICT_GROUP) & pDict->mask));
+    dmbGroupMask after = matchEmpty(pDict->ctrl + index);
+    dmbUINT lead = before == 0 ? DMB_FLATDICT_GROUP : (dmbUINT)__builtin_clz(before) - (32 - DMB_FLATDICT_GROUP);
+    dmbUINT trail = after == 0 ? DMB_FLATDICT_GROUP : (dmbUINT)__builtin_ctz(after);
+
+    //no probe window has ever been full around this slot, so no lookup could pass over it
+    if (lead + trail < DMB_FLATDICT_GROUP)
+    {
+        setCtrl(pDict, index, DMB_FLATDICT_EMPTY);
+    }
+    else
+    {
+        setCtrl(pDict, index, DMB_FLATDICT_DELETED);
+        pDict->deleted++;
+    }
+    pDict->count--;
+}
+
+dmbBOOL dmbFlatDictPop(dmbFlatDict *pDict, const void *pKey, dmbFlatDictEntry *pEntry)
+{
+    dmbINT index;
+
+    if (pDict->count == 0)
+        return FALSE;
+
+    index = findIndex(pDict, pKey, pDict->meta->hashFunc(pKey));
+    if (index < 0)
+        return FALSE;
+
+    if (pEntry != NULL)
+        *pEntry = pDict->slots[index];
+    eraseIndex(pDict, (dmbUINT)index);
+
+    return TRUE;
+}
+
+dmbBOOL dmbFlatDictPopByData(dmbFlatDict *pDict, const void *pKeyData, dmbSIZE size, dmbFlatDictEntry *pEntry)
+{
+    dmbINT index;
+
+    if (pDict->count == 0)
+        return FALSE;
+
+    index = findIndexByData(pDict, pKeyData, size, pDict->meta->dumpHashFunc(pKeyData, size));
+    if (index < 0)
+        return FALSE;
+
+    if (pEntry != NULL)
+        *pEntry = pDict->slots[index];
+    eraseIndex(pDict, (dmbUINT)index);
+
+    return TRUE;
+}
+
+void dmbFlatDictInitIter(dmbFlatDict *pDict, dmbFlatDictIter *pIter)
+{
+    pIter->dict = pDict;
+    //dmbFlatDictNext will increase to to 0
+    pIter->index = -1;
+}
+
+dmbFlatDictEntry* dmbFlatDictNext(dmbFlatDictIter *pIter)
+{
+    dmbFlatDict *pDict = pIter->dict;
+
+    while ((dmbUINT)(pIter->index + 1) < pDict->capacity)
+    {
+        ++(pIter->index);
+        if (IS_FULL(pDict->ctrl[pIter->index]))
+            return &pDict->slots[pIter->index];
+    }
+
+    return NULL;
+}
@@ -0,0 +1,104 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBFLATDICT_H
+#define DMBFLATDICT_H
+
+#include "dmbdict.h"
+
+/*
+ * Open addressing dict, key/value are stored inline in a flat slot array,
+ * every slot has a control byte: the 7 low bits of the hash when it is full,
+ * or DMB_FLATDICT_EMPTY / DMB_FLATDICT_DELETED. Lookups compare a group of
+ * DMB_FLATDICT_GROUP control bytes at once (SSE2 when available) and only
+ * call keyCompare on the slots whose tag matched.
+ *
+ * Entries move when the table grows, so an entry pointer returned by
+ * dmbFlatDictGet/dmbFlatDictPut is valid until the next put.
+ * Define DMB_FLATDICT_NO_SIMD to force the portable group scan.
+ */
+
+#define DMB_FLATDICT_GROUP 16
+#define DMB_FLATDICT_EMPTY ((dmbINT8)-128)
+#define DMB_FLATDICT_DELETED ((dmbINT8)-2)
+
+typedef struct dmbFlatDictEntry {
+    union {
+        void *val;
+        dmbUINT64 u64;
+        dmbINT64 i64;
+        dmbLONG l;
+    } k;
+
+    union {
+        void *val;
+        dmbUINT64 u64;
+        dmbINT64 i64;
+        dmbLONG l;
+    } v;
+} dmbFlatDictEntry;
+
+typedef struct dmbFlatDict {
+    dmbDictMeta *meta;
+    dmbINT8 *ctrl;
+    dmbFlatDictEntry *slots;
+    dmbUINT capacity;
+    dmbUINT mask;
+    dmbUINT count;
+    dmbUINT deleted;
+    dmbUINT minSize;
+} dmbFlatDict;
+
+typedef struct dmbFlatDictIter {
+    dmbFlatDict *dict;
+    dmbINT index;
+} dmbFlatDictIter;
+
+dmbFlatDict* dmbFlatDictCreate(dmbDictMeta *pMeta, dmbUINT uSize);
+
+void dmbFlatDictDestroy(dmbFlatDict *pDict);
+
+void dmbFlatDictRemoveAll(dmbFlatDict *pDict);
+
+dmbUINT dmbFlatDictSize(dmbFlatDict *pDict);
+
+dmbFlatDictEntry* dmbFlatDictGet(dmbFlatDict *pDict, const void *pKey);
+
+dmbFlatDictEntry* dmbFlatDictGetByData(dmbFlatDict *pDict, const void *pKeyData, dmbSIZE size);
+
+/**
+ * @brief dmbFlatDictPut 查找key，不存在时插入key
+ * @param pDict 字典
+ * @param pKey key
+ * @param pExisted 返回key是否已经存在，可以为NULL
+ * @return key所在的entry，由调用者设置value，分配失败返回NULL
+ */
+dmbFlatDictEntry* dmbFlatDictPut(dmbFlatDict *pDict, void *pKey, dmbBOOL *pExisted);
+
+/**
+ * @brief dmbFlatDictPop 移除key，被移除的key/value拷贝到pEntry中
+ * @return 存在返回TRUE，否则返回FALSE
+ */
+dmbBOOL dmbFlatDictPop(dmbFlatDict *pDict, const void *pKey, dmbFlatDictEntry *pEntry);
+
+dmbBOOL dmbFlatDictPopByData(dmbFlatDict *pDict, const void *pKeyData, dmbSIZE size, dmbFlatDictEntry *pEntry);
+
+void dmbFlatDictInitIter(dmbFlatDict *pDict, dmbFlatDictIter *pIter);
+
+dmbFlatDictEntry* dmbFlatDictNext(dmbFlatDictIter *pIter);
+
+#endif // DMBFLATDICT_H
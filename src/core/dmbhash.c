@@ -0,0 +1,52 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbhash.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+dmbUINT64 g_hash_seed = DMB_HASH_P3;
+
+void dmbHashInitSeed()
+{
+    dmbUINT64 seed = 0;
+    struct timeval tv;
+    dmbINT fd = open("/dev/urandom", O_RDONLY);
+
+    if (fd != -1)
+    {
+        if (read(fd, &seed, sizeof(seed)) != sizeof(seed))
+            seed = 0;
+        close(fd);
+    }
+
+    //no urandom, fall back to time and pid
+    if (seed == 0)
+    {
+        gettimeofday(&tv, NULL);
+        seed = dmbHashMix(((dmbUINT64)tv.tv_sec << 20) ^ (dmbUINT64)tv.tv_usec ^ DMB_HASH_P0,
+                          (dmbUINT64)getpid() ^ DMB_HASH_P2);
+    }
+
+    g_hash_seed = seed;
+}
+
+void dmbHashSetSeed(dmbUINT64 seed)
+{
+    g_hash_seed = seed;
+}
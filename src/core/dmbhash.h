@@ -0,0 +1,139 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBHASH_H
+#define DMBHASH_H
+
+#include "dmbdefines.h"
+#include <string.h>
+
+/*
+ * Seeded 64 bit hash of the wyhash family: keys up to 16 bytes are read with
+ * at most four loads, longer keys are consumed 16 bytes per 64x64->128 bit
+ * multiply, three independent lanes (48 bytes) per round for long keys.
+ */
+
+extern dmbUINT64 g_hash_seed;
+
+/**
+ * @brief dmbHashInitSeed 用随机数初始化hash种子，必须在创建任何字典之前调用
+ */
+void dmbHashInitSeed();
+
+/**
+ * @brief dmbHashSetSeed 设置固定的hash种子，用于测试
+ */
+void dmbHashSetSeed(dmbUINT64 seed);
+
+#define DMB_HASH_P0 0xa0761d6478bd642fULL
+#define DMB_HASH_P1 0xe7037ed1a0b428dbULL
+#define DMB_HASH_P2 0x8ebc6af09c88c6e3ULL
+#define DMB_HASH_P3 0x589965cc75374cc3ULL
+
+static inline __attribute__((always_inline)) void dmbHashMum(dmbUINT64 *a, dmbUINT64 *b)
+{
+    __uint128_t r = *a;
+    r *= *b;
+    *a = (dmbUINT64)r;
+    *b = (dmbUINT64)(r >> 64);
+}
+
+static inline __attribute__((always_inline)) dmbUINT64 dmbHashMix(dmbUINT64 a, dmbUINT64 b)
+{
+    dmbHashMum(&a, &b);
+    return a ^ b;
+}
+
+static inline __attribute__((always_inline)) dmbUINT64 dmbHashRead8(const dmbBYTE *p)
+{
+    dmbUINT64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline __attribute__((always_inline)) dmbUINT64 dmbHashRead4(const dmbBYTE *p)
+{
+    dmbUINT32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline dmbUINT64 dmbHashWithSeed(const void *pKey, dmbSIZE len, dmbUINT64 seed)
+{
+    const dmbBYTE *p = (const dmbBYTE*)pKey;
+    dmbUINT64 a, b, see1, see2;
+    dmbSIZE i = len;
+
+    seed ^= dmbHashMix(seed ^ DMB_HASH_P0, DMB_HASH_P1);
+
+    if (__builtin_expect(len <= 16, 1))
+    {
+        if (len >= 4)
+        {
+            a = (dmbHashRead4(p) << 32) | dmbHashRead4(p + ((len >> 3) << 2));
+            b = (dmbHashRead4(p + len - 4) << 32) | dmbHashRead4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+        {
+            a = ((dmbUINT64)p[0] << 16) | ((dmbUINT64)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        if (i >= 48)
+        {
+            see1 = seed;
+            see2 = seed;
+            do
+            {
+                seed = dmbHashMix(dmbHashRead8(p) ^ DMB_HASH_P1, dmbHashRead8(p + 8) ^ seed);
+                see1 = dmbHashMix(dmbHashRead8(p + 16) ^ DMB_HASH_P2, dmbHashRead8(p + 24) ^ see1);
+                see2 = dmbHashMix(dmbHashRead8(p + 32) ^ DMB_HASH_P3, dmbHashRead8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16)
+        {
+            seed = dmbHashMix(dmbHashRead8(p) ^ DMB_HASH_P1, dmbHashRead8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        //the last 16 bytes, may overlap with the bytes already mixed
+        a = dmbHashRead8(p + i - 16);
+        b = dmbHashRead8(p + i - 8);
+    }
+
+    a ^= DMB_HASH_P1;
+    b ^= seed;
+    dmbHashMum(&a, &b);
+    return dmbHashMix(a ^ DMB_HASH_P0 ^ len, b ^ DMB_HASH_P1);
+}
+
+static inline dmbUINT64 dmbHash(const void *pKey, dmbSIZE len)
+{
+    return dmbHashWithSeed(pKey, len, g_hash_seed);
+}
+
+#endif // DMBHASH_H
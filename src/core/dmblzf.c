@@ -0,0 +1,185 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmblzf.h"
+#include "dmballoc.h"
+
+#define LZF_HASH_LOG 13
+#define LZF_MAX_LIT 32
+#define LZF_MAX_OFF (1 << 13)
+#define LZF_MAX_REF ((1 << 8) + (1 << 3))
+
+static inline dmbUINT hash3(const dmbBYTE *p)
+{
+    dmbUINT v = ((dmbUINT)p[0] << 16) | ((dmbUINT)p[1] << 8) | p[2];
+    return (v * 2654435761U) >> (32 - LZF_HASH_LOG);
+}
+
+dmbUINT dmbLzfCompress(const dmbBYTE *pIn, dmbUINT uInLen, dmbBYTE *pOut, dmbUINT uOutLen)
+{
+    //positions + 1 of the last sequence with every hash, 0 is none
+    dmbUINT table[1 << LZF_HASH_LOG];
+    const dmbBYTE *ip = pIn, *pInEnd = pIn + uInLen, *ref;
+    dmbBYTE *op = pOut, *pOutEnd = pOut + uOutLen;
+    dmbUINT h, uOff, uMatch, uMax, uLit = 0;
+
+    if (uInLen == 0 || uOutLen < 2)
+        return 0;
+
+    dmbMemSet(table, 0, sizeof(table));
+    //op always has a byte reserved for the control of the running literal run
+    ++op;
+
+    while (ip + 2 < pInEnd)
+    {
+        h = hash3(ip);
+        ref = table[h] == 0 ? NULL : pIn + table[h] - 1;
+        table[h] = (dmbUINT)(ip - pIn) + 1;
+
+        if (ref != NULL && (uOff = (dmbUINT)(ip - ref) - 1) < LZF_MAX_OFF
+                && ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2])
+        {
+            uMax = (dmbUINT)(pInEnd - ip);
+            if (uMax > LZF_MAX_REF)
+                uMax = LZF_MAX_REF;
+            for (uMatch = 3; uMatch < uMax && ref[uMatch] == ip[uMatch]; ++uMatch)
+                ;
+
+            //control, extra length, offset and the next reserved control
+            if (op + 4 > pOutEnd)
+                return 0;
+
+            //close the literal run, drop its reserved byte if it is empty
+            if (uLit > 0)
+                op[-(dmbINT)uLit - 1] = (dmbBYTE)(uLit - 1);
+            else
+                --op;
+
+            uMatch -= 2;
+            if (uMatch < 7)
+            {
+                *op++ = (dmbBYTE)((uMatch << 5) | (uOff >> 8));
+            }
+            else
+            {
+                *op++ = (dmbBYTE)((7 << 5) | (uOff >> 8));
+                *op++ = (dmbBYTE)(uMatch - 7);
+            }
+            *op++ = (dmbBYTE)uOff;
+
+            uLit = 0;
+            ++op;
+
+            //hash the start of the next match candidates inside the copy
+            ip += uMatch + 2;
+            if (ip + 2 < pInEnd)
+            {
+                table[hash3(ip - 1)] = (dmbUINT)(ip - 1 - pIn) + 1;
+            }
+            continue;
+        }
+
+        if (op >= pOutEnd)
+            return 0;
+
+        *op++ = *ip++;
+        if (++uLit == LZF_MAX_LIT)
+        {
+            op[-(dmbINT)uLit - 1] = (dmbBYTE)(uLit - 1);
+            uLit = 0;
+            if (op >= pOutEnd)
+                return 0;
+            ++op;
+        }
+    }
+
+    while (ip < pInEnd)
+    {
+        if (op >= pOutEnd)
+            return 0;
+
+        *op++ = *ip++;
+        if (++uLit == LZF_MAX_LIT)
+        {
+            op[-(dmbINT)uLit - 1] = (dmbBYTE)(uLit - 1);
+            uLit = 0;
+            if (op >= pOutEnd)
+                return 0;
+            ++op;
+        }
+    }
+
+    if (uLit > 0)
+        op[-(dmbINT)uLit - 1] = (dmbBYTE)(uLit - 1);
+    else
+        --op;
+
+    return (dmbUINT)(op - pOut);
+}
+
+dmbUINT dmbLzfDecompress(const dmbBYTE *pIn, dmbUINT uInLen, dmbBYTE *pOut, dmbUINT uOutLen)
+{
+    const dmbBYTE *ip = pIn, *pInEnd = pIn + uInLen, *ref;
+    dmbBYTE *op = pOut, *pOutEnd = pOut + uOutLen;
+    dmbUINT uCtrl, uLen, uOff;
+
+    while (ip < pInEnd)
+    {
+        uCtrl = *ip++;
+        if (uCtrl < LZF_MAX_LIT)
+        {
+            uLen = uCtrl + 1;
+            if (uLen > (dmbUINT)(pOutEnd - op) || uLen > (dmbUINT)(pInEnd - ip))
+                return 0;
+
+            dmbMemCopy(op, ip, uLen);
+            op += uLen;
+            ip += uLen;
+            continue;
+        }
+
+        uLen = uCtrl >> 5;
+        if (uLen == 7)
+        {
+            if (ip >= pInEnd)
+                return 0;
+            uLen += *ip++;
+        }
+        if (ip >= pInEnd)
+            return 0;
+
+        uLen += 2;
+        uOff = (((uCtrl & 0x1F) << 8) | *ip++) + 1;
+        if (uOff > (dmbUINT)(op - pOut) || uLen > (dmbUINT)(pOutEnd - op))
+            return 0;
+
+        //the source may overlap the bytes being written
+        ref = op - uOff;
+        if (uOff >= uLen)
+        {
+            dmbMemCopy(op, ref, uLen);
+            op += uLen;
+        }
+        else
+        {
+            while (uLen-- > 0)
+                *op++ = *ref++;
+        }
+    }
+
+    return (dmbUINT)(op - pOut);
+}
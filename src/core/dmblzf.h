@@ -0,0 +1,45 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBLZF_H
+#define DMBLZF_H
+
+#include "dmbdefines.h"
+
+/*
+ * Small LZ77 codec in the LZF format family, no dictionary and no
+ * checksum, for compressing binlist segments. The stream is a sequence of
+ *   000LLLLL + L+1 literal bytes
+ *   LLLooooo [+ extra length byte when LLL == 7] + oooooooo
+ * where a back reference copies LLL + extra + 2 bytes starting
+ * (ooooo << 8 | oooooooo) + 1 bytes behind the output, so matches are
+ * 3 to 264 bytes long and reach 8KB back.
+ */
+
+/**
+ * @brief dmbLzfCompress 压缩到pOut，输出超过uOutLen（通常给uInLen-1，压缩不划算时放弃）返回0
+ * @return 压缩后的长度
+ */
+dmbUINT dmbLzfCompress(const dmbBYTE *pIn, dmbUINT uInLen, dmbBYTE *pOut, dmbUINT uOutLen);
+
+/**
+ * @brief dmbLzfDecompress 解压到pOut，数据损坏或空间不足返回0
+ * @return 解压后的长度
+ */
+dmbUINT dmbLzfDecompress(const dmbBYTE *pIn, dmbUINT uInLen, dmbBYTE *pOut, dmbUINT uOutLen);
+
+#endif // DMBLZF_H
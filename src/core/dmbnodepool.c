@@ -0,0 +1,104 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbnodepool.h"
+#include "dmballoc.h"
+
+//nodes in the first page of a class
+#define DMB_NODEPOOL_FIRST_PAGE_NODES 4
+
+static inline dmbUINT nodeSize(dmbNodePool *pPool, dmbINT iLevel)
+{
+    dmbUINT uSize = pPool->baseSize + pPool->stepSize * (dmbUINT)iLevel;
+    //keep every node pointer aligned
+    return (uSize + sizeof(void*) - 1) & ~(dmbUINT)(sizeof(void*) - 1);
+}
+
+void dmbNodePoolInit(dmbNodePool *pPool, dmbUINT uBaseSize, dmbUINT uStepSize)
+{
+    dmbMemSet(pPool, 0, sizeof(dmbNodePool));
+    pPool->baseSize = uBaseSize;
+    pPool->stepSize = uStepSize;
+}
+
+static dmbBOOL newPage(dmbNodePool *pPool, dmbNodePoolClass *pClass, dmbUINT uSize)
+{
+    dmbNodePoolPage *pPage;
+    dmbUINT uNodes = pClass->pageNodes == 0 ? DMB_NODEPOOL_FIRST_PAGE_NODES : pClass->pageNodes;
+
+    pPage = (dmbNodePoolPage*)dmbMalloc(sizeof(dmbNodePoolPage) + uSize * uNodes);
+    if (pPage == NULL)
+        return FALSE;
+
+    pPage->next = pPool->pages;
+    pPool->pages = pPage;
+    pClass->cur = (dmbBYTE*)(pPage + 1);
+    pClass->left = uSize * uNodes;
+
+    //grow the next page by half while it stays under DMB_NODEPOOL_PAGE_MAX,
+    //so at most a third of the pages of a class is unused
+    if (uSize * (uNodes + uNodes / 2) <= DMB_NODEPOOL_PAGE_MAX)
+        uNodes += uNodes / 2;
+    pClass->pageNodes = uNodes;
+
+    return TRUE;
+}
+
+void* dmbNodePoolAlloc(dmbNodePool *pPool, dmbINT iLevel)
+{
+    dmbNodePoolClass *pClass = &pPool->classes[iLevel - 1];
+    dmbUINT uSize;
+    void *pNode;
+
+    if (pClass->free != NULL)
+    {
+        pNode = pClass->free;
+        pClass->free = *(void**)pNode;
+        return pNode;
+    }
+
+    uSize = nodeSize(pPool, iLevel);
+    if (pClass->left < uSize && !newPage(pPool, pClass, uSize))
+        return NULL;
+
+    pNode = pClass->cur;
+    pClass->cur += uSize;
+    pClass->left -= uSize;
+    return pNode;
+}
+
+void dmbNodePoolFree(dmbNodePool *pPool, dmbINT iLevel, void *pNode)
+{
+    dmbNodePoolClass *pClass = &pPool->classes[iLevel - 1];
+
+    *(void**)pNode = pClass->free;
+    pClass->free = pNode;
+}
+
+void dmbNodePoolReset(dmbNodePool *pPool)
+{
+    dmbNodePoolPage *pPage = pPool->pages, *pNext;
+
+    while (pPage != NULL)
+    {
+        pNext = pPage->next;
+        dmbFree(pPage);
+        pPage = pNext;
+    }
+
+    dmbNodePoolInit(pPool, pPool->baseSize, pPool->stepSize);
+}
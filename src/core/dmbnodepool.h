@@ -0,0 +1,76 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBNODEPOOL_H
+#define DMBNODEPOOL_H
+
+#include "dmbdefines.h"
+
+/*
+ * Slab pool for variable level nodes (skiplist nodes): one size class per
+ * level, node size = base + level * step. Nodes of a class are cut from
+ * pages owned by the pool, freed nodes are kept on a per class free list
+ * and reused by the next alloc of that level. Pages start small and grow
+ * up to DMB_NODEPOOL_PAGE_MAX bytes, they are only released all at once by
+ * dmbNodePoolReset, so dropping every node costs one free per page.
+ * Not thread safe, a pool belongs to one container.
+ */
+
+#define DMB_NODEPOOL_MAX_LEVEL 32
+#define DMB_NODEPOOL_PAGE_MAX (64 * 1024)
+
+typedef struct dmbNodePoolPage {
+    struct dmbNodePoolPage *next;
+} dmbNodePoolPage;
+
+typedef struct dmbNodePoolClass {
+    //recycled nodes, linked through their first word
+    void *free;
+    //unused tail of the newest page of this class
+    dmbBYTE *cur;
+    dmbUINT left;
+    dmbUINT pageNodes;
+} dmbNodePoolClass;
+
+typedef struct dmbNodePool {
+    dmbUINT baseSize;
+    dmbUINT stepSize;
+    dmbNodePoolPage *pages;
+    dmbNodePoolClass classes[DMB_NODEPOOL_MAX_LEVEL];
+} dmbNodePool;
+
+/**
+ * @brief dmbNodePoolInit 初始化节点池，层数为level的节点大小为uBaseSize + uStepSize * level
+ */
+void dmbNodePoolInit(dmbNodePool *pPool, dmbUINT uBaseSize, dmbUINT uStepSize);
+
+/**
+ * @brief dmbNodePoolAlloc 分配一个iLevel层的节点，内容未初始化，失败返回NULL
+ */
+void* dmbNodePoolAlloc(dmbNodePool *pPool, dmbINT iLevel);
+
+/**
+ * @brief dmbNodePoolFree 归还节点，iLevel必须与分配时相同
+ */
+void dmbNodePoolFree(dmbNodePool *pPool, dmbINT iLevel, void *pNode);
+
+/**
+ * @brief dmbNodePoolReset 释放所有页，之前分配的节点全部失效
+ */
+void dmbNodePoolReset(dmbNodePool *pPool);
+
+#endif // DMBNODEPOOL_H
@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBRANDOM_H
+#define DMBRANDOM_H
+
+#include "dmbhash.h"
+
+/*
+ * Per thread wyrand generator, a replacement for random() on hot paths:
+ * random() takes a glibc lock and shares one state between all threads.
+ * The state lives in thread local storage and is seeded on the first call
+ * of every thread from g_random_seed and the order in which threads first
+ * use it, so a fixed seed replays the same numbers on every run.
+ */
+
+extern dmbUINT64 g_random_seed;
+extern __thread dmbUINT64 t_random_state;
+
+/**
+ * @brief dmbRandomInitSeed 用随机数初始化种子，在工作线程启动之前调用
+ */
+void dmbRandomInitSeed();
+
+/**
+ * @brief dmbRandomSetSeed 设置固定种子用于可重现的测试，当前线程及之后首次使用的线程按顺序重新播种
+ */
+void dmbRandomSetSeed(dmbUINT64 seed);
+
+//seeds the calling thread and returns its first number
+dmbUINT64 dmbRandomSeedThread();
+
+static inline __attribute__((always_inline)) dmbUINT64 dmbRandomNext()
+{
+    if (__builtin_expect(t_random_state == 0, 0))
+        return dmbRandomSeedThread();
+
+    t_random_state += DMB_HASH_P0;
+    return dmbHashMix(t_random_state, t_random_state ^ DMB_HASH_P1);
+}
+
+/**
+ * @brief dmbRandomLevel 跳表节点层数，P = 1/4，返回值不超过iMaxLevel
+ */
+static inline __attribute__((always_inline)) dmbINT dmbRandomLevel(dmbINT iMaxLevel)
+{
+    //every two trailing zero bits add a level, bit 62 caps it at 32
+    dmbINT level = __builtin_ctzll(dmbRandomNext() | (1ULL << 62)) / 2 + 1;
+    return level < iMaxLevel ? level : iMaxLevel;
+}
+
+#endif // DMBRANDOM_H
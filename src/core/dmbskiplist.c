@@ -17,9 +17,10 @@
 
 #include "dmbskiplist.h"
 #include "dmballoc.h"
+#include "dmbrandom.h"
 
+//levels of the header, dmbRandomLevel uses P = 1/4
 #define CB_SKIPLIST_MAX_LEVEL 32
-#define CB_SKIPLIST_P 0.25
 
 static inline __attribute__((always_inline)) dmbINT CompareScore(dmbSkipList *pList, void *cmpScore, void *listScore)
 {
@@ -31,9 +32,22 @@ static inline __attribute__((always_inline)) dmbINT CompareValue(dmbSkipList *pL
     return pList->meta->CompareValue(cmpValue, listValue);
 }
 
-static dmbCode CreateNode(dmbSkipListNode **pNode, dmbINT iLevel)
+//CleanScore and CleanValue may be NULL when there is nothing to free
+static inline void CleanScore(dmbSkipList *pList, void *score)
 {
-    *pNode = (dmbSkipListNode*)dmbMalloc(sizeof(dmbSkipListNode) + (sizeof(dmbSkipListEntry) * iLevel));
+    if (pList->meta->CleanScore != NULL)
+        pList->meta->CleanScore(score);
+}
+
+static inline void CleanValue(dmbSkipList *pList, void *pValue)
+{
+    if (pList->meta->CleanValue != NULL)
+        pList->meta->CleanValue(pValue);
+}
+
+static dmbCode CreateNode(dmbSkipList *pList, dmbSkipListNode **pNode, dmbINT iLevel)
+{
+    *pNode = (dmbSkipListNode*)dmbNodePoolAlloc(&pList->pool, iLevel);
     if (*pNode == NULL)
         return DMB_ERRCODE_ALLOC_FAILED;
 
@@ -41,6 +55,14 @@ static dmbCode CreateNode(dmbSkipListNode **pNode, dmbINT iLevel)
     return DMB_ERRCODE_OK;
 }
 
+static inline void FreeNode(dmbSkipList *pList, dmbSkipListNode *pNode, dmbINT iLevel)
+{
+    dmbNodePoolFree(&pList->pool, iLevel, pNode);
+    //the list is empty, give the pages back
+    if (pList->len == 0)
+        dmbNodePoolReset(&pList->pool);
+}
+
 dmbSkipList* dmbSkipListCreate(dmbSkipListMeta *pMeta)
 {
     dmbSkipList *pList = (dmbSkipList*)dmbMalloc(sizeof(dmbSkipList) + (sizeof(dmbSkipListEntry) * CB_SKIPLIST_MAX_LEVEL));
@@ -51,23 +73,13 @@ dmbSkipList* dmbSkipListCreate(dmbSkipListMeta *pMeta)
     dmbMemSet(pList, 0, sizeof(dmbSkipList) + (sizeof(dmbSkipListEntry) * CB_SKIPLIST_MAX_LEVEL));
 
     pList->meta = pMeta;
+    dmbNodePoolInit(&pList->pool, sizeof(dmbSkipListNode), sizeof(dmbSkipListEntry));
 
     return pList;
 }
 
-static inline dmbINT randomLevel()
-{
-    dmbINT level = 1;
-    while (((random()&0xFFFF) < (CB_SKIPLIST_P * 0xFFFF)) && (CB_SKIPLIST_MAX_LEVEL > level))
-        level += 1;
-    return level;
-}
-
-dmbCode dmbSkipListInsert(dmbSkipList *pList, void *score, void *pValue, dmbSkipListNode **pNew)
+static dmbCode insertNode(dmbSkipList *pList, void *score, void *pValue, dmbSkipListNode **pNew)
 {
-    if (pValue == NULL)
-        return DMB_ERRCODE_NULL_POINTER;
-
     dmbSkipListNode *pNode = NULL, *pNewNode;
     dmbSkipListNode *updateArr[CB_SKIPLIST_MAX_LEVEL];
     dmbUINT rankArr[CB_SKIPLIST_MAX_LEVEL];
@@ -93,7 +105,11 @@ dmbCode dmbSkipListInsert(dmbSkipList *pList, void *score, void *pValue, dmbSkip
         updateArr[iLevel] = pNode;
     }
 
-    iLevel = randomLevel(pList);
+    iLevel = dmbRandomLevel(CB_SKIPLIST_MAX_LEVEL);
+
+    code = CreateNode(pList, &pNewNode, iLevel);
+    if (code != DMB_ERRCODE_OK)
+        return code;
 
     if (iLevel > pList->level)
     {
@@ -108,25 +124,6 @@ dmbCode dmbSkipListInsert(dmbSkipList *pList, void *score, void *pValue, dmbSkip
         pList->level = iLevel;
     }
 
-    code = CreateNode(&pNewNode, iLevel);
-    if (code != DMB_ERRCODE_OK)
-        return code;
-
-    code = pList->meta->InitScore(&score);
-    if (code != DMB_ERRCODE_OK)
-    {
-        dmbFree(pNewNode);
-        return code;
-    }
-
-    code = pList->meta->InitValue(&pValue);
-    if (code != DMB_ERRCODE_OK)
-    {
-        dmbFree(pNewNode);
-        pList->meta->CleanScore(score);
-        return code;
-    }
-
     DMB_SL_SETSCORE(pNewNode, score);
     DMB_SL_SETVALUE(pNewNode, pValue);
 
@@ -157,14 +154,44 @@ dmbCode dmbSkipListInsert(dmbSkipList *pList, void *score, void *pValue, dmbSkip
     return code;
 }
 
-static void removeNode(dmbSkipList *pList, dmbSkipListNode *pNode, dmbSkipListNode **pUpdateArr)
+dmbCode dmbSkipListInsert(dmbSkipList *pList, void *score, void *pValue, dmbSkipListNode **pNew)
+{
+    dmbCode code;
+
+    if (pValue == NULL)
+        return DMB_ERRCODE_NULL_POINTER;
+
+    code = pList->meta->InitScore(&score);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    code = pList->meta->InitValue(&pValue);
+    if (code != DMB_ERRCODE_OK)
+    {
+        CleanScore(pList, score);
+        return code;
+    }
+
+    code = insertNode(pList, score, pValue, pNew);
+    if (code != DMB_ERRCODE_OK)
+    {
+        CleanScore(pList, score);
+        CleanValue(pList, pValue);
+    }
+
+    return code;
+}
+
+//returns the level of the node
+static dmbINT removeNode(dmbSkipList *pList, dmbSkipListNode *pNode, dmbSkipListNode **pUpdateArr)
 {
-    dmbINT index;
+    dmbINT index, iLevel = 0;
 
     for (index=0; index<pList->level; ++index)
     {
         if (pUpdateArr[index]->entry[index].next == pNode)
         {
+            ++iLevel;
             pUpdateArr[index]->entry[index].step += pNode->entry[index].step - 1;
             pUpdateArr[index]->entry[index].next = pNode->entry[index].next;
         }
@@ -181,6 +208,7 @@ static void removeNode(dmbSkipList *pList, dmbSkipListNode *pNode, dmbSkipListNo
         pList->level--;
 
     pList->len--;
+    return iLevel;
 }
 
 static dmbSkipListNode* CBSkipListGetFirstByScore(dmbSkipList *pList, void *pScroe)
@@ -453,29 +481,31 @@ dmbBOOL dmbSkipListRemoveOne(dmbSkipList *pList, void *score, void *pValue)
     if (pNode != NULL && CompareScore(pList, score, DMB_SL_GETSCORE(pNode)) == 0 &&
             CompareValue(pList, pValue, DMB_SL_GETVALUE(pNode)) == 0)
     {
-        removeNode(pList, pNode, updateArr);
-        pList->meta->CleanScore(DMB_SL_GETSCORE(pNode));
-        pList->meta->CleanValue(DMB_SL_GETVALUE(pNode));
-        dmbFree(pNode);
+        iLevel = removeNode(pList, pNode, updateArr);
+        CleanScore(pList, DMB_SL_GETSCORE(pNode));
+        CleanValue(pList, DMB_SL_GETVALUE(pNode));
+        FreeNode(pList, pNode, iLevel);
         return TRUE;
     }
 
     return FALSE;
 }
 
-dmbCode dmbSkipListRemoveByScore(dmbSkipList *pList, void *lStartScore, void *lEndScore, dmbLONG *pCount, dmbSkipListRemoveOpt *pOpt)
+dmbCode dmbSkipListUpdateScore(dmbSkipList *pList, void *curScore, void *pValue, void *newScore, dmbSkipListNode **pNew)
 {
     dmbSkipListNode *pNode = NULL, *pNext;
     dmbSkipListNode *updateArr[CB_SKIPLIST_MAX_LEVEL];
     dmbINT iLevel = pList->level;
-    dmbLONG lCount = 0;
-    dmbCode code = DMB_ERRCODE_OK;
+    dmbCode code;
 
     pNode = &pList->header;
     while (iLevel--)
     {
         while ((pNode->entry[iLevel].next != NULL) &&
-               (CompareScore(pList, lStartScore, DMB_SL_GETSCORE(pNode->entry[iLevel].next)) > 0))
+                (CompareScore(pList, curScore, DMB_SL_GETSCORE(pNode->entry[iLevel].next)) > 0 ||
+                (CompareScore(pList, curScore, DMB_SL_GETSCORE(pNode->entry[iLevel].next)) == 0 &&
+                 CompareValue(pList, pValue, DMB_SL_GETVALUE(pNode->entry[iLevel].next)) > 0)
+               ))
         {
             pNode = pNode->entry[iLevel].next;
         }
@@ -483,38 +513,266 @@ dmbCode dmbSkipListRemoveByScore(dmbSkipList *pList, void *lStartScore, void *lE
     }
 
     pNode = pNode->entry[0].next;
+    if (pNode == NULL || CompareScore(pList, curScore, DMB_SL_GETSCORE(pNode)) != 0 ||
+            CompareValue(pList, pValue, DMB_SL_GETVALUE(pNode)) != 0)
+        return DMB_ERRCODE_ZSETMEMBER_NOT_EXIST;
 
-    while (pNode != NULL && (CompareScore(pList, lEndScore, DMB_SL_GETSCORE(pNode)) >= 0))
+    code = pList->meta->InitScore(&newScore);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    //still between its neighbours, only the score changes
+    pNext = pNode->entry[0].next;
+    if ((pNode->prev == NULL || CompareScore(pList, newScore, DMB_SL_GETSCORE(pNode->prev)) > 0) &&
+            (pNext == NULL || CompareScore(pList, newScore, DMB_SL_GETSCORE(pNext)) < 0))
+    {
+        CleanScore(pList, DMB_SL_GETSCORE(pNode));
+        DMB_SL_SETSCORE(pNode, newScore);
+        if (pNew != NULL)
+            *pNew = pNode;
+        return DMB_ERRCODE_OK;
+    }
+
+    //move the value to a new node, it is neither cleaned nor initialized again
+    iLevel = removeNode(pList, pNode, updateArr);
+    CleanScore(pList, DMB_SL_GETSCORE(pNode));
+    pValue = DMB_SL_GETVALUE(pNode);
+    //recycled before the insert, so the new node may reuse it
+    dmbNodePoolFree(&pList->pool, iLevel, pNode);
+    code = insertNode(pList, newScore, pValue, pNew);
+    if (code != DMB_ERRCODE_OK)
+    {
+        CleanScore(pList, newScore);
+        CleanValue(pList, pValue);
+    }
+
+    return code;
+}
+
+//unlinks up to lMax nodes after pUpdateArr[0] that are not above endScore (NULL for any score)
+//and frees them in the same pass, every level is spliced once
+static dmbLONG removeRange(dmbSkipList *pList, dmbSkipListNode **pUpdateArr, void *endScore, dmbLONG lMax, dmbSkipListRemoveOpt *pOpt)
+{
+    dmbSkipListNode *cursorArr[CB_SKIPLIST_MAX_LEVEL];
+    dmbUINT spanArr[CB_SKIPLIST_MAX_LEVEL];
+    dmbSkipListNode *pNode, *pNext;
+    dmbINT index, iLevel;
+    dmbLONG lCount = 0;
+
+    if (pList->len == 0)
+        return 0;
+
+    //the first node of every level that is not removed yet, and the distance to it
+    for (index=0; index<pList->level; ++index)
+    {
+        cursorArr[index] = pUpdateArr[index]->entry[index].next;
+        spanArr[index] = pUpdateArr[index]->entry[index].step;
+    }
+
+    pNode = cursorArr[0];
+    while (pNode != NULL && lCount < lMax && (endScore == NULL || CompareScore(pList, endScore, DMB_SL_GETSCORE(pNode)) >= 0))
     {
-        pNext = pNode->entry[0].next;
         if (pOpt != NULL)
             pOpt->fnBeforeRemove(pNode, pOpt->data);
-        removeNode(pList, pNode, updateArr);
-        pList->meta->CleanScore(DMB_SL_GETSCORE(pNode));
-        pList->meta->CleanValue(DMB_SL_GETVALUE(pNode));
-        dmbFree(pNode);
+
+        //a node of level n is the cursor of the n lowest levels
+        for (iLevel=0; iLevel<pList->level && cursorArr[iLevel] == pNode; ++iLevel)
+        {
+            spanArr[iLevel] += pNode->entry[iLevel].step;
+            cursorArr[iLevel] = pNode->entry[iLevel].next;
+        }
+
+        pNext = pNode->entry[0].next;
+        CleanScore(pList, DMB_SL_GETSCORE(pNode));
+        CleanValue(pList, DMB_SL_GETVALUE(pNode));
+        dmbNodePoolFree(&pList->pool, iLevel, pNode);
         ++lCount;
         pNode = pNext;
     }
 
+    if (lCount == 0)
+        return 0;
+
+    for (index=0; index<pList->level; ++index)
+    {
+        pUpdateArr[index]->entry[index].next = cursorArr[index];
+        pUpdateArr[index]->entry[index].step = spanArr[index] - (dmbUINT)lCount;
+    }
+
+    if (pNode != NULL)
+        pNode->prev = (pUpdateArr[0] == (&pList->header)) ? NULL : pUpdateArr[0];
+
+    while (pList->level > 1 && pList->header.entry[pList->level-1].next == NULL)
+        pList->level--;
+
+    pList->len -= lCount;
+    //the list is empty, give the pages back
+    if (pList->len == 0)
+        dmbNodePoolReset(&pList->pool);
+
+    return lCount;
+}
+
+dmbCode dmbSkipListRemoveByScore(dmbSkipList *pList, void *lStartScore, void *lEndScore, dmbLONG *pCount, dmbSkipListRemoveOpt *pOpt)
+{
+    dmbSkipListNode *pNode = NULL;
+    dmbSkipListNode *updateArr[CB_SKIPLIST_MAX_LEVEL];
+    dmbINT iLevel = pList->level;
+    dmbLONG lCount;
+
+    pNode = &pList->header;
+    while (iLevel--)
+    {
+        while ((pNode->entry[iLevel].next != NULL) &&
+               (CompareScore(pList, lStartScore, DMB_SL_GETSCORE(pNode->entry[iLevel].next)) > 0))
+        {
+            pNode = pNode->entry[iLevel].next;
+        }
+        updateArr[iLevel] = pNode;
+    }
+
+    lCount = removeRange(pList, updateArr, lEndScore, pList->len, pOpt);
     if (pCount != NULL) *pCount = lCount;
 
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbSkipListRemoveByRank(dmbSkipList *pList, dmbLONG startRank, dmbLONG endRank, dmbLONG *pCount, dmbSkipListRemoveOpt *pOpt)
+{
+    dmbSkipListNode *pNode = NULL;
+    dmbSkipListNode *updateArr[CB_SKIPLIST_MAX_LEVEL];
+    dmbINT iLevel = pList->level;
+    dmbUINT cur = 0;
+    dmbLONG lCount = 0;
+    startRank = startRank < 0 ? pList->len + startRank : startRank;
+    endRank = endRank < 0 ? pList->len + endRank : endRank;
+
+    if (startRank < 0)
+        startRank = 0;
+    if (endRank >= pList->len)
+        endRank = pList->len - 1;
+
+    if (startRank <= endRank)
+    {
+        //the last node of every level before startRank
+        pNode = &pList->header;
+        while (iLevel--)
+        {
+            while ((pNode->entry[iLevel].next != NULL) && (cur + pNode->entry[iLevel].step <= (dmbUINT)startRank))
+            {
+                cur += pNode->entry[iLevel].step;
+                pNode = pNode->entry[iLevel].next;
+            }
+            updateArr[iLevel] = pNode;
+        }
+
+        lCount = removeRange(pList, updateArr, NULL, endRank - startRank + 1, pOpt);
+    }
+
+    if (pCount != NULL) *pCount = lCount;
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbSkipListLoad(dmbSkipList *pList, void **ppScores, void **ppValues, dmbLONG lCount, dmbLONG *pLoaded)
+{
+    dmbSkipListNode *pNode = NULL, *pPrev = NULL;
+    dmbSkipListNode *lastArr[CB_SKIPLIST_MAX_LEVEL];
+    dmbUINT rankArr[CB_SKIPLIST_MAX_LEVEL];
+    void *score, *pValue;
+    dmbINT index, iLevel;
+    dmbLONG i;
+    dmbCode code = DMB_ERRCODE_OK;
+
+    if (pList->len != 0)
+        return DMB_ERRCODE_WRONG_ARGUMENT_VALUE;
+
+    for (index=0; index<CB_SKIPLIST_MAX_LEVEL; ++index)
+    {
+        lastArr[index] = &pList->header;
+        rankArr[index] = 0;
+    }
+
+    for (i=0; i<lCount; ++i)
+    {
+        score = ppScores[i];
+        pValue = ppValues[i];
+        if (pValue == NULL)
+        {
+            code = DMB_ERRCODE_NULL_POINTER;
+            break;
+        }
+
+        code = pList->meta->InitScore(&score);
+        if (code != DMB_ERRCODE_OK)
+            break;
+
+        code = pList->meta->InitValue(&pValue);
+        if (code != DMB_ERRCODE_OK)
+        {
+            CleanScore(pList, score);
+            break;
+        }
+
+        //node n gets a level for every factor 4 of n, the shape random levels with P = 1/4 approach
+        iLevel = __builtin_ctzll((dmbUINT64)(i + 1)) / 2 + 1;
+        if (iLevel > CB_SKIPLIST_MAX_LEVEL)
+            iLevel = CB_SKIPLIST_MAX_LEVEL;
+
+        code = CreateNode(pList, &pNode, iLevel);
+        if (code != DMB_ERRCODE_OK)
+        {
+            CleanScore(pList, score);
+            CleanValue(pList, pValue);
+            break;
+        }
+
+        DMB_SL_SETSCORE(pNode, score);
+        DMB_SL_SETVALUE(pNode, pValue);
+        pNode->prev = pPrev;
+        pPrev = pNode;
+
+        //append to every level of the node
+        for (index=0; index<iLevel; ++index)
+        {
+            lastArr[index]->entry[index].next = pNode;
+            lastArr[index]->entry[index].step = (dmbUINT)(i + 1) - rankArr[index];
+            lastArr[index] = pNode;
+            rankArr[index] = (dmbUINT)(i + 1);
+        }
+
+        if (iLevel > pList->level)
+            pList->level = iLevel;
+    }
+
+    //the nodes loaded before a failure stay in the list
+    pList->len = i;
+    for (index=0; index<pList->level; ++index)
+    {
+        lastArr[index]->entry[index].next = NULL;
+        lastArr[index]->entry[index].step = (dmbUINT)i - rankArr[index];
+    }
+
+    if (pLoaded != NULL) *pLoaded = i;
+
     return code;
 }
 
 void dmbSkipListRemoveAll(dmbSkipList *pList)
 {
-    dmbSkipListNode *pNode = &pList->header, *pNext;
+    dmbSkipListNode *pNode = &pList->header;
     pNode = pNode->entry[0].next;
-    while (pNode != NULL)
+    //only walk the nodes when there is something to clean
+    while (pNode != NULL && (pList->meta->CleanScore != NULL || pList->meta->CleanValue != NULL))
     {
-        pNext = pNode->entry[0].next;
-        pList->meta->CleanScore(DMB_SL_GETSCORE(pNode));
-        pList->meta->CleanValue(DMB_SL_GETVALUE(pNode));
-        dmbFree(pNode);
-        pNode = pNext;
+        CleanScore(pList, DMB_SL_GETSCORE(pNode));
+        CleanValue(pList, DMB_SL_GETVALUE(pNode));
+        pNode = pNode->entry[0].next;
     }
+    //the nodes go away with their pages
+    dmbNodePoolReset(&pList->pool);
     dmbMemSet(((dmbBYTE*)pList) + sizeof(dmbSkipList), 0, (sizeof(dmbSkipListEntry) * CB_SKIPLIST_MAX_LEVEL));
+    pList->level = 0;
     pList->len = 0;
 }
 
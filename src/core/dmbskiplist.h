@@ -19,12 +19,14 @@
 #define DMBSKIPLIST_H
 
 #include "dmbdict.h"
+#include "dmbnodepool.h"
 
 #define DMB_SL_SETSCORE(NODE, SCORE) ((NODE)->data.v.val = (SCORE))
 #define DMB_SL_SETVALUE(NODE, VALUE) ((NODE)->data.k.val = (VALUE))
 #define DMB_SL_GETSCORE(NODE) ((NODE)->data.v.val)
 #define DMB_SL_GETVALUE(NODE) ((NODE)->data.k.val)
 
+//CleanScore and CleanValue can be NULL if scores or values own nothing
 typedef struct dmbSkipListMeta {
     dmbCode (*InitScore) (void**pScorePtr);
     dmbBOOL (*CleanScore) (void*pScore);
@@ -51,6 +53,8 @@ typedef struct {
     volatile dmbINT level;
     volatile dmbLONG len;
     dmbSkipListMeta *meta;
+    //nodes are cut from per level pages of the list
+    dmbNodePool pool;
     dmbSkipListNode header;
 } dmbSkipList;
 
@@ -65,7 +69,29 @@ dmbLONG dmbSkipListSize(dmbSkipList *pList);
 void dmbSkipListRemoveAll(dmbSkipList *pList);
 dmbBOOL dmbSkipListRemoveOne(dmbSkipList *pList, void *score, void *pValue);
 dmbCode dmbSkipListInsert(dmbSkipList *pList, void *score, void *pValue, dmbSkipListNode **pNew);
+
+/**
+ * @brief dmbSkipListUpdateScore 修改已存在元素的分数，位置不变时原地修改，否则将value移到新节点，
+ *        value不会被CleanValue/InitValue，旧节点被释放，*pNew返回元素当前所在节点
+ * @return 元素不存在返回DMB_ERRCODE_ZSETMEMBER_NOT_EXIST
+ */
+dmbCode dmbSkipListUpdateScore(dmbSkipList *pList, void *curScore, void *pValue, void *newScore, dmbSkipListNode **pNew);
+
+/**
+ * @brief dmbSkipListRemoveByScore 删除分数区间[startScore, endScore]，一次遍历摘除并释放整个区间
+ */
 dmbCode dmbSkipListRemoveByScore(dmbSkipList *pList, void *startScore, void *endScore, dmbLONG *pCount, dmbSkipListRemoveOpt *pOpt);
+
+/**
+ * @brief dmbSkipListRemoveByRank 删除排名区间[startRank, endRank]，从0开始，负数表示从末尾倒数
+ */
+dmbCode dmbSkipListRemoveByRank(dmbSkipList *pList, dmbLONG startRank, dmbLONG endRank, dmbLONG *pCount, dmbSkipListRemoveOpt *pOpt);
+
+/**
+ * @brief dmbSkipListLoad 将按(score, value)严格升序排列的数组以O(n)建成完全平衡的跳表，list必须为空，
+ *        元素与dmbSkipListInsert一样经过InitScore/InitValue，失败时已加载的*pLoaded个元素保留在list中
+ */
+dmbCode dmbSkipListLoad(dmbSkipList *pList, void **ppScores, void **ppValues, dmbLONG lCount, dmbLONG *pLoaded);
 dmbCode dmbSkipListGetRangByScore(dmbSkipList *pList, void *startScore, void *endScore, void *pData, dmbBOOL reverse);
 dmbUINT dmbSkipListGetRank(dmbSkipList *pList, void *score, void *value);
 dmbLONG dmbSkipListGetRangeCount(dmbSkipList *pList, void *startScore, void *endScore);
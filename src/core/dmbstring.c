@@ -284,7 +284,8 @@ static void Long2RevStr(dmbLONG value, dmbCHAR *pcBuf, dmbINT *count)
 
 dmbCode dmbLong2Str(dmbLONG value, dmbCHAR *pcBuf, dmbUINT *uSize)
 {
-    dmbCHAR buf[256] = {0};
+    //20 digits and a sign at most, the reversed digits are not terminated
+    dmbCHAR buf[32];
     dmbINT cur = 0, pos, count;
 
     Long2RevStr(value, buf, &count);
@@ -0,0 +1,634 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbzbtree.h"
+#include "dmballoc.h"
+
+//every node but the root keeps at least DMB_ZBT_MIN entries
+#define DMB_ZBT_MIN (DMB_ZBT_FANOUT / 2)
+//far more than 2^32 entries need
+#define DMB_ZBT_MAX_HEIGHT 32
+
+#define ZBT_LEAF(NODE) ((dmbZBTreeLeaf*)(NODE))
+#define ZBT_INNER(NODE) ((dmbZBTreeInner*)(NODE))
+
+//nodes allocated before an insert changes anything, one per split it can cause
+typedef struct zbtInsertCtx {
+    dmbINT depth;
+    dmbINT fullTail;
+    dmbINT spareCount;
+    dmbZBTreeNode *spare[DMB_ZBT_MAX_HEIGHT + 1];
+} zbtInsertCtx;
+
+//memcmp order, on a common prefix the shorter member comes first
+static inline __attribute__((always_inline)) dmbINT compareMember(const dmbString *pMember, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbINT ret = dmbMemCmp(pMember->data, pcMember, pMember->len < uLen ? pMember->len : uLen);
+    if (ret != 0)
+        return ret;
+    return pMember->len == uLen ? 0 : (pMember->len < uLen ? -1 : 1);
+}
+
+//<0 if key i of the node is ordered before (score, member)
+static inline __attribute__((always_inline)) dmbINT compareKey(dmbZBTreeNode *pNode, dmbINT i, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    if (pNode->scores[i] != score)
+        return pNode->scores[i] < score ? -1 : 1;
+    return compareMember(pNode->members[i], pcMember, uLen);
+}
+
+//last child whose first key is not after (score, member), 0 if there is none
+static inline dmbINT childIndex(dmbZBTreeNode *pNode, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbINT i = 1;
+
+    while (i < pNode->num && compareKey(pNode, i, score, pcMember, uLen) <= 0)
+        ++i;
+    return i - 1;
+}
+
+//first entry of the leaf that is not before (score, member)
+static inline dmbINT leafLowerBound(dmbZBTreeNode *pNode, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbINT i = 0;
+
+    while (i < pNode->num && compareKey(pNode, i, score, pcMember, uLen) < 0)
+        ++i;
+    return i;
+}
+
+static inline void setKey(dmbZBTreeNode *pNode, dmbINT i, dmbZBTreeNode *pChild)
+{
+    pNode->scores[i] = pChild->scores[0];
+    pNode->members[i] = pChild->members[0];
+}
+
+static inline void moveKeys(dmbZBTreeNode *pDest, dmbINT iDest, dmbZBTreeNode *pSrc, dmbINT iSrc, dmbINT iCount)
+{
+    dmbMemMove(pDest->scores + iDest, pSrc->scores + iSrc, sizeof(double) * iCount);
+    dmbMemMove(pDest->members + iDest, pSrc->members + iSrc, sizeof(dmbString*) * iCount);
+}
+
+//moves keys, counts and children of inner nodes, only keys of leaves
+static inline void moveEntries(dmbZBTreeNode *pDest, dmbINT iDest, dmbZBTreeNode *pSrc, dmbINT iSrc, dmbINT iCount)
+{
+    moveKeys(pDest, iDest, pSrc, iSrc, iCount);
+    if (!pSrc->leaf)
+    {
+        dmbMemMove(ZBT_INNER(pDest)->counts + iDest, ZBT_INNER(pSrc)->counts + iSrc, sizeof(dmbUINT32) * iCount);
+        dmbMemMove(ZBT_INNER(pDest)->children + iDest, ZBT_INNER(pSrc)->children + iSrc, sizeof(dmbZBTreeNode*) * iCount);
+    }
+}
+
+static dmbZBTreeNode* createNode(dmbBOOL bLeaf)
+{
+    dmbZBTreeNode *pNode = (dmbZBTreeNode*)dmbMalloc(bLeaf ? sizeof(dmbZBTreeLeaf) : sizeof(dmbZBTreeInner));
+
+    if (pNode == NULL)
+        return NULL;
+
+    pNode->leaf = bLeaf;
+    pNode->num = 0;
+    if (bLeaf)
+    {
+        ZBT_LEAF(pNode)->prev = NULL;
+        ZBT_LEAF(pNode)->next = NULL;
+    }
+    return pNode;
+}
+
+static dmbLONG nodeCount(dmbZBTreeNode *pNode)
+{
+    dmbLONG lCount = 0;
+    dmbINT i;
+
+    if (pNode->leaf)
+        return pNode->num;
+
+    for (i=0; i<pNode->num; ++i)
+        lCount += ZBT_INNER(pNode)->counts[i];
+    return lCount;
+}
+
+static void destroyNode(dmbZBTreeNode *pNode)
+{
+    dmbINT i;
+
+    for (i=0; i<pNode->num; ++i)
+    {
+        if (pNode->leaf)
+            dmbStringDestroy(pNode->members[i]);
+        else
+            destroyNode(ZBT_INNER(pNode)->children[i]);
+    }
+    dmbFree(pNode);
+}
+
+dmbZBTree* dmbZBTreeCreate()
+{
+    dmbZBTree *pTree = (dmbZBTree*)dmbMalloc(sizeof(dmbZBTree));
+
+    if (pTree == NULL)
+        return NULL;
+
+    pTree->root = createNode(TRUE);
+    if (pTree->root == NULL)
+    {
+        dmbFree(pTree);
+        return NULL;
+    }
+
+    pTree->head = ZBT_LEAF(pTree->root);
+    pTree->tail = ZBT_LEAF(pTree->root);
+    pTree->len = 0;
+    return pTree;
+}
+
+void dmbZBTreeDestroy(dmbZBTree *pTree)
+{
+    destroyNode(pTree->root);
+    dmbFree(pTree);
+}
+
+dmbLONG dmbZBTreeSize(dmbZBTree *pTree)
+{
+    return pTree->len;
+}
+
+//the full nodes at the bottom of the path split, and the root above them when the whole path is full
+static dmbCode reserveSplits(zbtInsertCtx *pCtx)
+{
+    dmbINT i, iNeed = pCtx->fullTail + (pCtx->fullTail == pCtx->depth ? 1 : 0);
+
+    for (i=0; i<iNeed; ++i)
+    {
+        //the first split is the leaf
+        pCtx->spare[i] = createNode(i == 0);
+        if (pCtx->spare[i] == NULL)
+        {
+            while (i-- > 0)
+                dmbFree(pCtx->spare[i]);
+            return DMB_ERRCODE_ALLOC_FAILED;
+        }
+    }
+    pCtx->spareCount = 0;
+    return DMB_ERRCODE_OK;
+}
+
+//moves the upper half of the full node into pRight, then puts the entry at iPos into one of the two
+static void splitNode(dmbZBTreeNode *pNode, dmbZBTreeNode *pRight, dmbINT iPos)
+{
+    dmbINT iKeep = (DMB_ZBT_FANOUT + 1) / 2;
+
+    //the new entry goes left when it is in the first half, keep the larger half there
+    if (iPos < iKeep)
+        --iKeep;
+
+    moveEntries(pRight, 0, pNode, iKeep, pNode->num - iKeep);
+    pRight->num = pNode->num - iKeep;
+    pNode->num = iKeep;
+}
+
+static dmbCode insertInto(dmbZBTree *pTree, dmbZBTreeNode *pNode, double score, dmbString *pMember, zbtInsertCtx *pCtx, dmbZBTreeNode **pSplit)
+{
+    dmbZBTreeNode *pChild, *pChildSplit, *pTarget;
+    dmbZBTreeLeaf *pLeaf, *pRightLeaf;
+    dmbINT i, iPos;
+    dmbCode code;
+
+    *pSplit = NULL;
+    pCtx->depth++;
+    pCtx->fullTail = pNode->num == DMB_ZBT_FANOUT ? pCtx->fullTail + 1 : 0;
+
+    if (pNode->leaf)
+    {
+        code = reserveSplits(pCtx);
+        if (code != DMB_ERRCODE_OK)
+            return code;
+
+        iPos = leafLowerBound(pNode, score, pMember->data, pMember->len);
+        pTarget = pNode;
+        if (pNode->num == DMB_ZBT_FANOUT)
+        {
+            *pSplit = pCtx->spare[pCtx->spareCount++];
+            splitNode(pNode, *pSplit, iPos);
+
+            pLeaf = ZBT_LEAF(pNode);
+            pRightLeaf = ZBT_LEAF(*pSplit);
+            pRightLeaf->prev = pLeaf;
+            pRightLeaf->next = pLeaf->next;
+            if (pLeaf->next != NULL)
+                pLeaf->next->prev = pRightLeaf;
+            else
+                pTree->tail = pRightLeaf;
+            pLeaf->next = pRightLeaf;
+
+            if (iPos > pNode->num)
+            {
+                iPos -= pNode->num;
+                pTarget = *pSplit;
+            }
+        }
+
+        moveKeys(pTarget, iPos + 1, pTarget, iPos, pTarget->num - iPos);
+        pTarget->scores[iPos] = score;
+        pTarget->members[iPos] = pMember;
+        pTarget->num++;
+        return DMB_ERRCODE_OK;
+    }
+
+    i = childIndex(pNode, score, pMember->data, pMember->len);
+    pChild = ZBT_INNER(pNode)->children[i];
+    code = insertInto(pTree, pChild, score, pMember, pCtx, &pChildSplit);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    ZBT_INNER(pNode)->counts[i]++;
+    setKey(pNode, i, pChild);
+    if (pChildSplit == NULL)
+        return DMB_ERRCODE_OK;
+
+    ZBT_INNER(pNode)->counts[i] = (dmbUINT32)nodeCount(pChild);
+    iPos = i + 1;
+    pTarget = pNode;
+    if (pNode->num == DMB_ZBT_FANOUT)
+    {
+        *pSplit = pCtx->spare[pCtx->spareCount++];
+        splitNode(pNode, *pSplit, iPos);
+        if (iPos > pNode->num)
+        {
+            iPos -= pNode->num;
+            pTarget = *pSplit;
+        }
+    }
+
+    moveEntries(pTarget, iPos + 1, pTarget, iPos, pTarget->num - iPos);
+    setKey(pTarget, iPos, pChildSplit);
+    ZBT_INNER(pTarget)->counts[iPos] = (dmbUINT32)nodeCount(pChildSplit);
+    ZBT_INNER(pTarget)->children[iPos] = pChildSplit;
+    pTarget->num++;
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbZBTreeInsert(dmbZBTree *pTree, double score, dmbString *pMember)
+{
+    zbtInsertCtx ctx;
+    dmbZBTreeNode *pSplit, *pRoot;
+    dmbCode code;
+
+    if (pMember == NULL)
+        return DMB_ERRCODE_NULL_POINTER;
+
+    ctx.depth = 0;
+    ctx.fullTail = 0;
+    code = insertInto(pTree, pTree->root, score, pMember, &ctx, &pSplit);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    if (pSplit != NULL)
+    {
+        pRoot = ctx.spare[ctx.spareCount++];
+        setKey(pRoot, 0, pTree->root);
+        setKey(pRoot, 1, pSplit);
+        ZBT_INNER(pRoot)->children[0] = pTree->root;
+        ZBT_INNER(pRoot)->children[1] = pSplit;
+        ZBT_INNER(pRoot)->counts[0] = (dmbUINT32)nodeCount(pTree->root);
+        ZBT_INNER(pRoot)->counts[1] = (dmbUINT32)nodeCount(pSplit);
+        pRoot->num = 2;
+        pTree->root = pRoot;
+    }
+
+    pTree->len++;
+    return DMB_ERRCODE_OK;
+}
+
+//child i of the inner node is under DMB_ZBT_MIN, merge it with a sibling or borrow one entry
+static void rebalance(dmbZBTree *pTree, dmbZBTreeNode *pNode, dmbINT i)
+{
+    dmbZBTreeInner *pInner = ZBT_INNER(pNode);
+    dmbINT l = i > 0 ? i - 1 : i, r = l + 1;
+    dmbZBTreeNode *pLeft = pInner->children[l], *pRight = pInner->children[r];
+    dmbUINT32 uMoved;
+
+    if (pLeft->num + pRight->num <= DMB_ZBT_FANOUT)
+    {
+        moveEntries(pLeft, pLeft->num, pRight, 0, pRight->num);
+        pLeft->num += pRight->num;
+        if (pLeft->leaf)
+        {
+            ZBT_LEAF(pLeft)->next = ZBT_LEAF(pRight)->next;
+            if (ZBT_LEAF(pRight)->next != NULL)
+                ZBT_LEAF(pRight)->next->prev = ZBT_LEAF(pLeft);
+            else
+                pTree->tail = ZBT_LEAF(pLeft);
+        }
+        dmbFree(pRight);
+
+        pInner->counts[l] += pInner->counts[r];
+        moveEntries(pNode, r, pNode, r + 1, pNode->num - r - 1);
+        pNode->num--;
+        return;
+    }
+
+    if (l == i)
+    {
+        //first entry of the right sibling to the end of the left
+        uMoved = pRight->leaf ? 1 : ZBT_INNER(pRight)->counts[0];
+        moveEntries(pLeft, pLeft->num, pRight, 0, 1);
+        moveEntries(pRight, 0, pRight, 1, pRight->num - 1);
+        pLeft->num++;
+        pRight->num--;
+    }
+    else
+    {
+        //last entry of the left sibling to the front of the right
+        uMoved = pLeft->leaf ? 1 : ZBT_INNER(pLeft)->counts[pLeft->num - 1];
+        moveEntries(pRight, 1, pRight, 0, pRight->num);
+        moveEntries(pRight, 0, pLeft, pLeft->num - 1, 1);
+        pLeft->num--;
+        pRight->num++;
+    }
+
+    pInner->counts[l] += l == i ? uMoved : -uMoved;
+    pInner->counts[r] += l == i ? -uMoved : uMoved;
+    setKey(pNode, r, pRight);
+}
+
+//takes (score, member) out of the subtree, returns its member string or NULL if it is missing
+static dmbString* removeFrom(dmbZBTree *pTree, dmbZBTreeNode *pNode, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbZBTreeNode *pChild;
+    dmbString *pMember;
+    dmbINT i;
+
+    if (pNode->leaf)
+    {
+        i = leafLowerBound(pNode, score, pcMember, uLen);
+        if (i == pNode->num || compareKey(pNode, i, score, pcMember, uLen) != 0)
+            return NULL;
+
+        pMember = pNode->members[i];
+        moveKeys(pNode, i, pNode, i + 1, pNode->num - i - 1);
+        pNode->num--;
+        return pMember;
+    }
+
+    i = childIndex(pNode, score, pcMember, uLen);
+    pChild = ZBT_INNER(pNode)->children[i];
+    pMember = removeFrom(pTree, pChild, score, pcMember, uLen);
+    if (pMember == NULL)
+        return NULL;
+
+    ZBT_INNER(pNode)->counts[i]--;
+    if (pChild->num > 0)
+        setKey(pNode, i, pChild);
+    if (pChild->num < DMB_ZBT_MIN && pNode->num > 1)
+        rebalance(pTree, pNode, i);
+
+    return pMember;
+}
+
+static dmbString* takeMember(dmbZBTree *pTree, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbString *pMember = removeFrom(pTree, pTree->root, score, pcMember, uLen);
+    dmbZBTreeNode *pRoot;
+
+    if (pMember == NULL)
+        return NULL;
+
+    //an inner root with a single child is dropped
+    while (!pTree->root->leaf && pTree->root->num == 1)
+    {
+        pRoot = pTree->root;
+        pTree->root = ZBT_INNER(pRoot)->children[0];
+        dmbFree(pRoot);
+    }
+
+    pTree->len--;
+    return pMember;
+}
+
+dmbBOOL dmbZBTreeRemove(dmbZBTree *pTree, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbString *pMember = takeMember(pTree, score, pcMember, uLen);
+
+    if (pMember == NULL)
+        return FALSE;
+
+    dmbStringDestroy(pMember);
+    return TRUE;
+}
+
+//returns the member string of (score, member), NULL if it is missing
+static dmbString* findMember(dmbZBTree *pTree, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbZBTreeNode *pNode = pTree->root;
+    dmbINT i;
+
+    while (!pNode->leaf)
+        pNode = ZBT_INNER(pNode)->children[childIndex(pNode, score, pcMember, uLen)];
+
+    i = leafLowerBound(pNode, score, pcMember, uLen);
+    if (i == pNode->num || compareKey(pNode, i, score, pcMember, uLen) != 0)
+        return NULL;
+
+    return pNode->members[i];
+}
+
+dmbCode dmbZBTreeUpdateScore(dmbZBTree *pTree, double curScore, const dmbCHAR *pcMember, dmbUINT uLen, double newScore)
+{
+    dmbString *pMember = findMember(pTree, curScore, pcMember, uLen);
+    dmbCode code;
+
+    if (pMember == NULL)
+        return DMB_ERRCODE_ZSETMEMBER_NOT_EXIST;
+
+    if (curScore == newScore)
+        return DMB_ERRCODE_OK;
+
+    //the new key goes in first, a failed insert leaves the tree untouched;
+    //the removal below never allocates
+    code = dmbZBTreeInsert(pTree, newScore, pMember);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    takeMember(pTree, curScore, pMember->data, pMember->len);
+    return DMB_ERRCODE_OK;
+}
+
+dmbUINT dmbZBTreeGetRank(dmbZBTree *pTree, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbZBTreeNode *pNode = pTree->root;
+    dmbUINT rank = 0;
+    dmbINT i, k;
+
+    while (!pNode->leaf)
+    {
+        i = childIndex(pNode, score, pcMember, uLen);
+        for (k=0; k<i; ++k)
+            rank += ZBT_INNER(pNode)->counts[k];
+        pNode = ZBT_INNER(pNode)->children[i];
+    }
+
+    i = leafLowerBound(pNode, score, pcMember, uLen);
+    if (i == pNode->num || compareKey(pNode, i, score, pcMember, uLen) != 0)
+        return 0;
+
+    return rank + i + 1;
+}
+
+//entries with a score below score, or not above it when bInclusive
+static dmbLONG countBelow(dmbZBTree *pTree, double score, dmbBOOL bInclusive)
+{
+    dmbZBTreeNode *pNode = pTree->root;
+    dmbLONG lCount = 0;
+    dmbINT i;
+
+    while (!pNode->leaf)
+    {
+        for (i=1; i<pNode->num && (bInclusive ? pNode->scores[i] <= score : pNode->scores[i] < score); ++i)
+            lCount += ZBT_INNER(pNode)->counts[i-1];
+        pNode = ZBT_INNER(pNode)->children[i-1];
+    }
+
+    for (i=0; i<pNode->num && (bInclusive ? pNode->scores[i] <= score : pNode->scores[i] < score); ++i);
+    return lCount + i;
+}
+
+dmbLONG dmbZBTreeGetRangeCount(dmbZBTree *pTree, double min, double max)
+{
+    dmbLONG lCount;
+
+    if (min > max)
+        return 0;
+
+    lCount = countBelow(pTree, max, TRUE) - countBelow(pTree, min, FALSE);
+    return lCount > 0 ? lCount : 0;
+}
+
+//leaf and index of the entry at 0-based rank
+static dmbZBTreeLeaf* getByRank(dmbZBTree *pTree, dmbLONG lRank, dmbINT *pIndex)
+{
+    dmbZBTreeNode *pNode = pTree->root;
+    dmbINT i;
+
+    while (!pNode->leaf)
+    {
+        for (i=0; i<pNode->num - 1 && lRank >= ZBT_INNER(pNode)->counts[i]; ++i)
+            lRank -= ZBT_INNER(pNode)->counts[i];
+        pNode = ZBT_INNER(pNode)->children[i];
+    }
+
+    *pIndex = (dmbINT)lRank;
+    return ZBT_LEAF(pNode);
+}
+
+static inline dmbCode onScan(dmbZBTreeNode *pNode, dmbINT i, dmbZBTreeScanFunc fn, void *pData)
+{
+    dmbString *pMember = pNode->members[i];
+    return fn(pData, pNode->scores[i], pMember->data, pMember->len);
+}
+
+dmbCode dmbZBTreeGetRangeByScore(dmbZBTree *pTree, double min, double max, dmbBOOL reverse, dmbZBTreeScanFunc fn, void *pData)
+{
+    dmbZBTreeNode *pNode = pTree->root;
+    dmbZBTreeLeaf *pLeaf;
+    dmbINT i;
+    dmbCode code;
+
+    if (reverse)
+    {
+        //last entry not above max
+        while (!pNode->leaf)
+        {
+            for (i=1; i<pNode->num && pNode->scores[i] <= max; ++i);
+            pNode = ZBT_INNER(pNode)->children[i-1];
+        }
+        for (i=pNode->num - 1; i>=0 && pNode->scores[i] > max; --i);
+
+        for (pLeaf = ZBT_LEAF(pNode); pLeaf != NULL; pLeaf = pLeaf->prev, i = pLeaf != NULL ? pLeaf->node.num - 1 : 0)
+        {
+            for (; i>=0; --i)
+            {
+                if (pLeaf->node.scores[i] < min)
+                    return DMB_ERRCODE_OK;
+
+                code = onScan(&pLeaf->node, i, fn, pData);
+                if (code != DMB_ERRCODE_OK)
+                    return code == DMB_ERRCODE_SKIPLIST_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+            }
+        }
+        return DMB_ERRCODE_OK;
+    }
+
+    //first entry not below min
+    while (!pNode->leaf)
+    {
+        for (i=1; i<pNode->num && pNode->scores[i] < min; ++i);
+        pNode = ZBT_INNER(pNode)->children[i-1];
+    }
+    for (i=0; i<pNode->num && pNode->scores[i] < min; ++i);
+
+    for (pLeaf = ZBT_LEAF(pNode); pLeaf != NULL; pLeaf = pLeaf->next, i = 0)
+    {
+        for (; i<pLeaf->node.num; ++i)
+        {
+            if (pLeaf->node.scores[i] > max)
+                return DMB_ERRCODE_OK;
+
+            code = onScan(&pLeaf->node, i, fn, pData);
+            if (code != DMB_ERRCODE_OK)
+                return code == DMB_ERRCODE_SKIPLIST_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+        }
+    }
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbZBTreeScanByRank(dmbZBTree *pTree, dmbLONG startRank, dmbLONG endRank, dmbBOOL reverse, dmbZBTreeScanFunc fn, void *pData)
+{
+    dmbZBTreeLeaf *pLeaf;
+    dmbLONG lCount;
+    dmbINT i;
+    dmbCode code;
+
+    startRank = startRank < 0 ? pTree->len + startRank : startRank;
+    endRank = endRank < 0 ? pTree->len + endRank : endRank;
+
+    if (startRank >= pTree->len || startRank < 0)
+        return DMB_ERRCODE_OK;
+
+    if (endRank >= pTree->len || endRank < 0)
+        endRank = pTree->len - 1;
+
+    lCount = endRank - startRank + 1;
+    pLeaf = getByRank(pTree, reverse ? endRank : startRank, &i);
+    while (pLeaf != NULL && lCount > 0)
+    {
+        for (; i>=0 && i<pLeaf->node.num && lCount > 0; i += reverse ? -1 : 1, --lCount)
+        {
+            code = onScan(&pLeaf->node, i, fn, pData);
+            if (code != DMB_ERRCODE_OK)
+                return code == DMB_ERRCODE_SKIPLIST_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+        }
+
+        pLeaf = reverse ? pLeaf->prev : pLeaf->next;
+        if (pLeaf != NULL)
+            i = reverse ? pLeaf->node.num - 1 : 0;
+    }
+
+    return DMB_ERRCODE_OK;
+}
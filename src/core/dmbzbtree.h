@@ -0,0 +1,104 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBZBTREE_H
+#define DMBZBTREE_H
+
+#include "dmbstring.h"
+
+/*
+ * Order statistic B+-tree for sorted sets, ordered by (score, member) like
+ * dmbZSkipList and offering the same operations. Leaves keep up to
+ * DMB_ZBT_FANOUT scores packed in one array and the member strings in a
+ * second one, and are linked for sequential range scans. Inner nodes keep
+ * the first key of every child and the number of entries under it, so
+ * rank, count and rank lookups cost one root to leaf descent.
+ * The tree owns the member strings, entries move between nodes on splits
+ * and merges, so nothing may keep pointers into the nodes.
+ */
+
+#define DMB_ZBT_FANOUT 16
+
+typedef struct dmbZBTreeNode {
+    dmbUINT16 leaf;
+    dmbUINT16 num;
+    //keys of the entries (leaf) or the first key under every child (inner)
+    double scores[DMB_ZBT_FANOUT];
+    dmbString *members[DMB_ZBT_FANOUT];
+} dmbZBTreeNode;
+
+typedef struct dmbZBTreeLeaf {
+    dmbZBTreeNode node;
+    struct dmbZBTreeLeaf *prev;
+    struct dmbZBTreeLeaf *next;
+} dmbZBTreeLeaf;
+
+typedef struct dmbZBTreeInner {
+    dmbZBTreeNode node;
+    //entries under every child
+    dmbUINT32 counts[DMB_ZBT_FANOUT];
+    dmbZBTreeNode *children[DMB_ZBT_FANOUT];
+} dmbZBTreeInner;
+
+typedef struct dmbZBTree {
+    dmbZBTreeNode *root;
+    dmbZBTreeLeaf *head;
+    dmbZBTreeLeaf *tail;
+    dmbLONG len;
+} dmbZBTree;
+
+//pcMember is only valid during the call, return DMB_ERRCODE_SKIPLIST_SCAN_BREAK to stop
+typedef dmbCode (*dmbZBTreeScanFunc)(void *pData, double score, const dmbCHAR *pcMember, dmbUINT uLen);
+
+dmbZBTree* dmbZBTreeCreate();
+void dmbZBTreeDestroy(dmbZBTree *pTree);
+dmbLONG dmbZBTreeSize(dmbZBTree *pTree);
+
+/**
+ * @brief dmbZBTreeInsert 插入成员，成功后pMember归树所有，调用者需保证成员不存在
+ */
+dmbCode dmbZBTreeInsert(dmbZBTree *pTree, double score, dmbString *pMember);
+
+/**
+ * @brief dmbZBTreeRemove 删除成员并释放成员字符串
+ */
+dmbBOOL dmbZBTreeRemove(dmbZBTree *pTree, double score, const dmbCHAR *pcMember, dmbUINT uLen);
+
+/**
+ * @brief dmbZBTreeUpdateScore 修改成员分数，成员字符串对象保持不变，失败时成员保留原分数
+ * @return 成员不存在返回DMB_ERRCODE_ZSETMEMBER_NOT_EXIST
+ */
+dmbCode dmbZBTreeUpdateScore(dmbZBTree *pTree, double curScore, const dmbCHAR *pcMember, dmbUINT uLen, double newScore);
+
+/**
+ * @brief dmbZBTreeGetRank 成员排名，从1开始，不存在返回0
+ */
+dmbUINT dmbZBTreeGetRank(dmbZBTree *pTree, double score, const dmbCHAR *pcMember, dmbUINT uLen);
+
+dmbLONG dmbZBTreeGetRangeCount(dmbZBTree *pTree, double min, double max);
+
+/**
+ * @brief dmbZBTreeGetRangeByScore 遍历分数区间[min, max]
+ */
+dmbCode dmbZBTreeGetRangeByScore(dmbZBTree *pTree, double min, double max, dmbBOOL reverse, dmbZBTreeScanFunc fn, void *pData);
+
+/**
+ * @brief dmbZBTreeScanByRank 遍历排名区间[startRank, endRank]，从0开始，负数表示从末尾倒数，reverse时从endRank往前
+ */
+dmbCode dmbZBTreeScanByRank(dmbZBTree *pTree, dmbLONG startRank, dmbLONG endRank, dmbBOOL reverse, dmbZBTreeScanFunc fn, void *pData);
+
+#endif // DMBZBTREE_H
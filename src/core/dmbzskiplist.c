@@ -0,0 +1,408 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbzskiplist.h"
+#include "dmballoc.h"
+#include "dmbrandom.h"
+
+//levels of the header, dmbRandomLevel uses P = 1/4
+#define DMB_ZSL_MAX_LEVEL 32
+
+//memcmp order, on a common prefix the shorter member comes first
+static inline __attribute__((always_inline)) dmbINT compareMember(const dmbString *pMember, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbINT ret = dmbMemCmp(pMember->data, pcMember, pMember->len < uLen ? pMember->len : uLen);
+    if (ret != 0)
+        return ret;
+    return pMember->len == uLen ? 0 : (pMember->len < uLen ? -1 : 1);
+}
+
+//<0 if the node is ordered before (score, member), 0 if it is that member
+static inline __attribute__((always_inline)) dmbINT compareNode(dmbZSkipListNode *pNode, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    if (DMB_ZSL_GETSCORE(pNode) != score)
+        return DMB_ZSL_GETSCORE(pNode) < score ? -1 : 1;
+    return compareMember(DMB_ZSL_GETMEMBER(pNode), pcMember, uLen);
+}
+
+static dmbCode CreateNode(dmbZSkipList *pList, dmbZSkipListNode **pNode, dmbINT iLevel)
+{
+    *pNode = (dmbZSkipListNode*)dmbNodePoolAlloc(&pList->pool, iLevel);
+    if (*pNode == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    dmbMemSet(*pNode, 0, sizeof(dmbZSkipListNode));
+    return DMB_ERRCODE_OK;
+}
+
+dmbZSkipList* dmbZSkipListCreate()
+{
+    dmbZSkipList *pList = (dmbZSkipList*)dmbMalloc(sizeof(dmbZSkipList) + (sizeof(dmbZSkipListEntry) * DMB_ZSL_MAX_LEVEL));
+
+    if (pList == NULL)
+        return NULL;
+
+    dmbMemSet(pList, 0, sizeof(dmbZSkipList) + (sizeof(dmbZSkipListEntry) * DMB_ZSL_MAX_LEVEL));
+    dmbNodePoolInit(&pList->pool, sizeof(dmbZSkipListNode), sizeof(dmbZSkipListEntry));
+
+    return pList;
+}
+
+void dmbZSkipListDestroy(dmbZSkipList *pList)
+{
+    dmbZSkipListNode *pNode = pList->header.entry[0].next, *pNext;
+
+    while (pNode != NULL)
+    {
+        pNext = pNode->entry[0].next;
+        dmbStringDestroy(DMB_ZSL_GETMEMBER(pNode));
+        pNode = pNext;
+    }
+    //the nodes go away with their pages
+    dmbNodePoolReset(&pList->pool);
+    dmbFree(pList);
+}
+
+dmbLONG dmbZSkipListSize(dmbZSkipList *pList)
+{
+    return pList->len;
+}
+
+//links an iLevel node holding (score, pMember) into the list, cannot fail
+static void linkNode(dmbZSkipList *pList, dmbZSkipListNode *pNewNode, dmbINT iLevel, double score, dmbString *pMember)
+{
+    dmbZSkipListNode *pNode;
+    dmbZSkipListNode *updateArr[DMB_ZSL_MAX_LEVEL];
+    dmbUINT rankArr[DMB_ZSL_MAX_LEVEL];
+    dmbINT index = pList->level;
+
+    pNode = &pList->header;
+    while (index--)
+    {
+        rankArr[index] = index + 1 == pList->level ? 0 : rankArr[index+1];
+        while (pNode->entry[index].next != NULL &&
+               compareNode(pNode->entry[index].next, score, pMember->data, pMember->len) < 0)
+        {
+            rankArr[index] += pNode->entry[index].step;
+            pNode = pNode->entry[index].next;
+        }
+        updateArr[index] = pNode;
+    }
+
+    if (iLevel > pList->level)
+    {
+        for (index = pList->level; index < iLevel; ++index)
+        {
+            rankArr[index] = 0;
+            updateArr[index] = &pList->header;
+            updateArr[index]->entry[index].step = pList->len;
+        }
+        pList->level = iLevel;
+    }
+
+    DMB_ZSL_GETSCORE(pNewNode) = score;
+    pNewNode->data.k.val = pMember;
+
+    for (index=0; index<iLevel; ++index)
+    {
+        pNewNode->entry[index].next = updateArr[index]->entry[index].next;
+        updateArr[index]->entry[index].next = pNewNode;
+        pNewNode->entry[index].step = updateArr[index]->entry[index].step - (rankArr[0] - rankArr[index]);
+        updateArr[index]->entry[index].step = rankArr[0] - rankArr[index] + 1;
+    }
+
+    for (index=iLevel; index<pList->level; ++index)
+    {
+        updateArr[index]->entry[index].step++;
+    }
+
+    pNewNode->prev = (updateArr[0] == (&pList->header)) ? NULL : updateArr[0];
+    if (pNewNode->entry[0].next != NULL)
+        pNewNode->entry[0].next->prev = pNewNode;
+
+    pList->len++;
+}
+
+static dmbCode insertNode(dmbZSkipList *pList, double score, dmbString *pMember, dmbZSkipListNode **pNew)
+{
+    dmbZSkipListNode *pNewNode;
+    dmbINT iLevel = dmbRandomLevel(DMB_ZSL_MAX_LEVEL);
+    dmbCode code;
+
+    code = CreateNode(pList, &pNewNode, iLevel);
+    if (code != DMB_ERRCODE_OK)
+        return code;
+
+    linkNode(pList, pNewNode, iLevel, score, pMember);
+    if (pNew != NULL)
+        *pNew = pNewNode;
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbZSkipListInsert(dmbZSkipList *pList, double score, dmbString *pMember, dmbZSkipListNode **pNew)
+{
+    if (pMember == NULL)
+        return DMB_ERRCODE_NULL_POINTER;
+
+    return insertNode(pList, score, pMember, pNew);
+}
+
+//fills the last node before (score, member) on every level, returns the node after it on level 0
+static dmbZSkipListNode* findUpdate(dmbZSkipList *pList, double score, const dmbCHAR *pcMember, dmbUINT uLen, dmbZSkipListNode **pUpdateArr)
+{
+    dmbZSkipListNode *pNode = &pList->header;
+    dmbINT iLevel = pList->level;
+
+    while (iLevel--)
+    {
+        while (pNode->entry[iLevel].next != NULL &&
+               compareNode(pNode->entry[iLevel].next, score, pcMember, uLen) < 0)
+        {
+            pNode = pNode->entry[iLevel].next;
+        }
+        pUpdateArr[iLevel] = pNode;
+    }
+
+    return pNode->entry[0].next;
+}
+
+//returns the level of the node
+static dmbINT removeNode(dmbZSkipList *pList, dmbZSkipListNode *pNode, dmbZSkipListNode **pUpdateArr)
+{
+    dmbINT index, iLevel = 0;
+
+    for (index=0; index<pList->level; ++index)
+    {
+        if (pUpdateArr[index]->entry[index].next == pNode)
+        {
+            ++iLevel;
+            pUpdateArr[index]->entry[index].step += pNode->entry[index].step - 1;
+            pUpdateArr[index]->entry[index].next = pNode->entry[index].next;
+        }
+        else
+        {
+            pUpdateArr[index]->entry[index].step--;
+        }
+    }
+
+    if (pNode->entry[0].next != NULL)
+        pNode->entry[0].next->prev = pNode->prev;
+
+    while (pList->level > 1 && pList->header.entry[pList->level-1].next == NULL)
+        pList->level--;
+
+    pList->len--;
+    return iLevel;
+}
+
+dmbBOOL dmbZSkipListRemove(dmbZSkipList *pList, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbZSkipListNode *updateArr[DMB_ZSL_MAX_LEVEL];
+    dmbZSkipListNode *pNode = findUpdate(pList, score, pcMember, uLen, updateArr);
+    dmbINT iLevel;
+
+    if (pNode == NULL || compareNode(pNode, score, pcMember, uLen) != 0)
+        return FALSE;
+
+    iLevel = removeNode(pList, pNode, updateArr);
+    dmbStringDestroy(DMB_ZSL_GETMEMBER(pNode));
+    dmbNodePoolFree(&pList->pool, iLevel, pNode);
+    //the list is empty, give the pages back
+    if (pList->len == 0)
+        dmbNodePoolReset(&pList->pool);
+    return TRUE;
+}
+
+dmbCode dmbZSkipListUpdateScore(dmbZSkipList *pList, double curScore, const dmbCHAR *pcMember, dmbUINT uLen, double newScore, dmbZSkipListNode **pNew)
+{
+    dmbZSkipListNode *updateArr[DMB_ZSL_MAX_LEVEL];
+    dmbZSkipListNode *pNode = findUpdate(pList, curScore, pcMember, uLen, updateArr), *pNext;
+    dmbString *pMember;
+    dmbINT iLevel;
+
+    if (pNode == NULL || compareNode(pNode, curScore, pcMember, uLen) != 0)
+        return DMB_ERRCODE_ZSETMEMBER_NOT_EXIST;
+
+    //still between its neighbours, only the score changes
+    pNext = pNode->entry[0].next;
+    if ((pNode->prev == NULL || compareNode(pNode->prev, newScore, pcMember, uLen) < 0) &&
+            (pNext == NULL || compareNode(pNext, newScore, pcMember, uLen) > 0))
+    {
+        DMB_ZSL_GETSCORE(pNode) = newScore;
+        if (pNew != NULL)
+            *pNew = pNode;
+        return DMB_ERRCODE_OK;
+    }
+
+    //relink the same node at its old level, nothing is allocated so the
+    //update cannot lose the member; pcMember may point into the member string
+    pMember = DMB_ZSL_GETMEMBER(pNode);
+    iLevel = removeNode(pList, pNode, updateArr);
+    linkNode(pList, pNode, iLevel, newScore, pMember);
+    if (pNew != NULL)
+        *pNew = pNode;
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbUINT dmbZSkipListGetRank(dmbZSkipList *pList, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    dmbZSkipListNode *pNode = &pList->header;
+    dmbINT iLevel = pList->level;
+    dmbUINT rank = 0;
+
+    while (iLevel--)
+    {
+        while (pNode->entry[iLevel].next != NULL &&
+               compareNode(pNode->entry[iLevel].next, score, pcMember, uLen) <= 0)
+        {
+            rank += pNode->entry[iLevel].step;
+            pNode = pNode->entry[iLevel].next;
+        }
+
+        if (pNode != &pList->header && compareNode(pNode, score, pcMember, uLen) == 0)
+            return rank;
+    }
+    return 0;
+}
+
+static dmbZSkipListNode* getFirstByScore(dmbZSkipList *pList, double min)
+{
+    dmbZSkipListNode *pNode = &pList->header;
+    dmbINT iLevel = pList->level;
+
+    while (iLevel--)
+    {
+        while (pNode->entry[iLevel].next != NULL && DMB_ZSL_GETSCORE(pNode->entry[iLevel].next) < min)
+            pNode = pNode->entry[iLevel].next;
+    }
+
+    return pNode->entry[0].next;
+}
+
+static dmbZSkipListNode* getLastByScore(dmbZSkipList *pList, double max)
+{
+    dmbZSkipListNode *pNode = &pList->header;
+    dmbINT iLevel = pList->level;
+
+    while (iLevel--)
+    {
+        while (pNode->entry[iLevel].next != NULL && DMB_ZSL_GETSCORE(pNode->entry[iLevel].next) <= max)
+            pNode = pNode->entry[iLevel].next;
+    }
+
+    return pNode == &pList->header ? NULL : pNode;
+}
+
+//node at 1-based rank
+static dmbZSkipListNode* getByRank(dmbZSkipList *pList, dmbUINT rank)
+{
+    dmbZSkipListNode *pNode = &pList->header;
+    dmbINT iLevel = pList->level;
+    dmbUINT cur = 0;
+
+    while (iLevel--)
+    {
+        while (pNode->entry[iLevel].next != NULL && cur + pNode->entry[iLevel].step <= rank)
+        {
+            cur += pNode->entry[iLevel].step;
+            pNode = pNode->entry[iLevel].next;
+        }
+
+        if (cur == rank)
+            return pNode;
+    }
+
+    return NULL;
+}
+
+static inline dmbCode onScan(dmbZSkipListNode *pNode, dmbZSkipListScanFunc fn, void *pData)
+{
+    dmbString *pMember = DMB_ZSL_GETMEMBER(pNode);
+    return fn(pData, DMB_ZSL_GETSCORE(pNode), pMember->data, pMember->len);
+}
+
+dmbLONG dmbZSkipListGetRangeCount(dmbZSkipList *pList, double min, double max)
+{
+    dmbZSkipListNode *pNode = getFirstByScore(pList, min);
+    dmbLONG lCount = 0;
+
+    while (pNode != NULL && DMB_ZSL_GETSCORE(pNode) <= max)
+    {
+        ++lCount;
+        pNode = pNode->entry[0].next;
+    }
+
+    return lCount;
+}
+
+dmbCode dmbZSkipListGetRangeByScore(dmbZSkipList *pList, double min, double max, dmbBOOL reverse, dmbZSkipListScanFunc fn, void *pData)
+{
+    dmbZSkipListNode *pNode;
+    dmbCode code;
+
+    if (reverse)
+    {
+        for (pNode = getLastByScore(pList, max); pNode != NULL && DMB_ZSL_GETSCORE(pNode) >= min; pNode = pNode->prev)
+        {
+            code = onScan(pNode, fn, pData);
+            if (code != DMB_ERRCODE_OK)
+                return code == DMB_ERRCODE_SKIPLIST_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+        }
+    }
+    else
+    {
+        for (pNode = getFirstByScore(pList, min); pNode != NULL && DMB_ZSL_GETSCORE(pNode) <= max; pNode = pNode->entry[0].next)
+        {
+            code = onScan(pNode, fn, pData);
+            if (code != DMB_ERRCODE_OK)
+                return code == DMB_ERRCODE_SKIPLIST_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+        }
+    }
+
+    return DMB_ERRCODE_OK;
+}
+
+dmbCode dmbZSkipListScanByRank(dmbZSkipList *pList, dmbLONG startRank, dmbLONG endRank, dmbBOOL reverse, dmbZSkipListScanFunc fn, void *pData)
+{
+    dmbZSkipListNode *pNode;
+    dmbLONG lCount;
+    dmbCode code;
+
+    startRank = startRank < 0 ? pList->len + startRank : startRank;
+    endRank = endRank < 0 ? pList->len + endRank : endRank;
+
+    if (startRank >= pList->len || startRank < 0)
+        return DMB_ERRCODE_OK;
+
+    if (endRank >= pList->len || endRank < 0)
+        endRank = pList->len - 1;
+
+    lCount = endRank - startRank + 1;
+    pNode = getByRank(pList, (dmbUINT)(reverse ? endRank : startRank) + 1);
+    while (pNode != NULL && lCount-- > 0)
+    {
+        code = onScan(pNode, fn, pData);
+        if (code != DMB_ERRCODE_OK)
+            return code == DMB_ERRCODE_SKIPLIST_SCAN_BREAK ? DMB_ERRCODE_OK : code;
+
+        pNode = reverse ? pNode->prev : pNode->entry[0].next;
+    }
+
+    return DMB_ERRCODE_OK;
+}
@@ -0,0 +1,95 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBZSKIPLIST_H
+#define DMBZSKIPLIST_H
+
+#include "dmbdict.h"
+#include "dmbstring.h"
+#include "dmbnodepool.h"
+
+/*
+ * Skiplist specialized for sorted sets: the double score is kept inline in
+ * the node (data.v.d) and compared directly, ties are broken by a memcmp of
+ * the member (data.k.val, a dmbString owned by the node). No meta callbacks
+ * are involved. data can be linked into a dict keyed by the member.
+ * Nodes come from a dmbNodePool owned by the list.
+ */
+
+#define DMB_ZSL_GETSCORE(NODE) ((NODE)->data.v.d)
+#define DMB_ZSL_GETMEMBER(NODE) ((dmbString*)(NODE)->data.k.val)
+
+struct dmbZSkipListNode;
+typedef struct dmbZSkipListEntry {
+    dmbUINT step;
+    struct dmbZSkipListNode *next;
+} dmbZSkipListEntry;
+
+typedef struct dmbZSkipListNode {
+    dmbDictEntry data;
+    struct dmbZSkipListNode *prev;
+    struct dmbZSkipListEntry entry[];
+} dmbZSkipListNode;
+
+typedef struct {
+    dmbINT level;
+    dmbLONG len;
+    dmbNodePool pool;
+    dmbZSkipListNode header;
+} dmbZSkipList;
+
+//pcMember is only valid during the call, return DMB_ERRCODE_SKIPLIST_SCAN_BREAK to stop
+typedef dmbCode (*dmbZSkipListScanFunc)(void *pData, double score, const dmbCHAR *pcMember, dmbUINT uLen);
+
+dmbZSkipList* dmbZSkipListCreate();
+void dmbZSkipListDestroy(dmbZSkipList *pList);
+dmbLONG dmbZSkipListSize(dmbZSkipList *pList);
+
+/**
+ * @brief dmbZSkipListInsert 插入成员，成功后pMember归节点所有，调用者需保证成员不存在
+ */
+dmbCode dmbZSkipListInsert(dmbZSkipList *pList, double score, dmbString *pMember, dmbZSkipListNode **pNew);
+
+/**
+ * @brief dmbZSkipListRemove 删除成员并释放节点与成员
+ */
+dmbBOOL dmbZSkipListRemove(dmbZSkipList *pList, double score, const dmbCHAR *pcMember, dmbUINT uLen);
+
+/**
+ * @brief dmbZSkipListUpdateScore 修改成员分数，位置变化时同一节点重新链入，不分配内存，*pNew返回该节点
+ * @return 成员不存在返回DMB_ERRCODE_ZSETMEMBER_NOT_EXIST
+ */
+dmbCode dmbZSkipListUpdateScore(dmbZSkipList *pList, double curScore, const dmbCHAR *pcMember, dmbUINT uLen, double newScore, dmbZSkipListNode **pNew);
+
+/**
+ * @brief dmbZSkipListGetRank 成员排名，从1开始，不存在返回0
+ */
+dmbUINT dmbZSkipListGetRank(dmbZSkipList *pList, double score, const dmbCHAR *pcMember, dmbUINT uLen);
+
+dmbLONG dmbZSkipListGetRangeCount(dmbZSkipList *pList, double min, double max);
+
+/**
+ * @brief dmbZSkipListGetRangeByScore 遍历分数区间[min, max]
+ */
+dmbCode dmbZSkipListGetRangeByScore(dmbZSkipList *pList, double min, double max, dmbBOOL reverse, dmbZSkipListScanFunc fn, void *pData);
+
+/**
+ * @brief dmbZSkipListScanByRank 遍历排名区间[startRank, endRank]，从0开始，负数表示从末尾倒数，reverse时从endRank往前
+ */
+dmbCode dmbZSkipListScanByRank(dmbZSkipList *pList, dmbLONG startRank, dmbLONG endRank, dmbBOOL reverse, dmbZSkipListScanFunc fn, void *pData);
+
+#endif // DMBZSKIPLIST_H
@@ -118,6 +118,8 @@ typedef dmbINT16 dmbCode;
 #define DMB_ERRCODE_ALLOC_FAILED 501
 //创建线程失败
 #define DMB_ERRCODE_THREAD_ERROR 502
+//目标线程的邮箱已满，需要处理自己的邮箱后重试
+#define DMB_ERRCODE_MAILBOX_FULL 503
 //打开文件失败
 #define DMB_ERRCODE_FILE_OPEN_FAIL 521
 //文件读取失败
@@ -167,6 +169,12 @@ typedef dmbINT16 dmbCode;
 //binentry设置string类型的长度失败
 #define DMB_ERRCODE_BINENTRY_SET_STRLEN_FAILED 3116
 
+//压缩的binlist数据损坏，无法解压
+#define DMB_ERRCODE_BINLIST_CORRUPT 3117
+
+//binlist已压缩，但分配器不支持解压
+#define DMB_ERRCODE_BINLIST_NO_CODEC 3118
+
 //binlist的元素是字串
 #define DMB_ERRCODE_BINENTRY_IS_STR 3151
 
@@ -180,10 +188,18 @@ typedef dmbINT16 dmbCode;
 #define DMB_ERRCODE_BINENTRY_IS_INT64 3154
 
 //########3201-3300 string相关错误码######
+//整数字串自增溢出
+#define DMB_ERRCODE_STRING_INCR_OVERFLOW 3201
 
 //########3301-3400 list相关错误码######
+//链表遍历退出
+#define DMB_ERRCODE_LIST_SCAN_BREAK 3301
 
 //########3401-3500 map相关错误码#######
+//map遍历退出
+#define DMB_ERRCODE_MAP_SCAN_BREAK 3401
+//map字段不存在
+#define DMB_ERRCODE_MAPFIELD_NOT_EXIST 3402
 
 //########3501-3600 zset相关错误码#######
 //条表遍历退出
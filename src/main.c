@@ -19,6 +19,9 @@
 #include "utils/dmbsysutil.h"
 #include "base/dmbsettings.h"
 #include "base/dmbserver.h"
+#include "base/dmbobject.h"
+#include "core/dmbhash.h"
+#include "core/dmbrandom.h"
 #include <unistd.h>
 #include "utils/dmblog.h"
 
@@ -27,6 +30,14 @@
 #include "tests/dmbdllist_test.h"
 #include "tests/dmbutils_test.h"
 #include "tests/dmbnetwork_test.h"
+#include "tests/dmbdict_test.h"
+#include "tests/dmbhash_test.h"
+#include "tests/dmbconcurrentdict_test.h"
+#include "tests/dmbpartition_test.h"
+#include "tests/dmbzset_test.h"
+#include "tests/dmbmap_test.h"
+#include "tests/dmbseglist_test.h"
+#include "tests/dmbobject_test.h"
 
 static volatile dmbBOOL g_app_run = TRUE;
 
@@ -46,14 +57,30 @@ int main(int argc, char** argv)
     DMB_UNUSED(argv);
 
     dmbSystemInit();
+    //before any dict is created
+    dmbHashInitSeed();
+    dmbRandomInitSeed();
+    dmbObjectInitShared();
 
     dmbLoadSettings(NULL);
     dmbSetrLimit(g_settings.open_files);
 //    dmbbinlist_test();
 //    dmbbinlist_merge_test();
+//    dmbbinlist_index_test();
+//    dmbbinlist_edit_test();
+//    dmbbinlist_find_test();
+//    dmbbinlist_compress_test();
 //    dmbstring_test();
 //    dmbdllist_test();
 //    dmbutils_test();
+//    dmbdict_test();
+//    dmbhash_test();
+//    dmbconcurrentdict_test();
+//    dmbpartition_test();
+//    dmbzset_test();
+//    dmbmap_test();
+//    dmbseglist_test();
+//    dmbobject_test();
     dmbnetwork_test();
 
     sync();
@@ -0,0 +1,171 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbpartition.h"
+#include "core/dmballoc.h"
+#include "utils/dmbioutil.h"
+
+dmbPartition* dmbPartitionCreateSet(dmbUINT uCount, dmbDictMeta *pMeta, dmbUINT uSize, dmbUINT uMailboxSize)
+{
+    dmbPartition *pSet = (dmbPartition*)dmbMalloc(sizeof(dmbPartition) * uCount);
+    dmbPartition *pPart;
+    dmbUINT i, j;
+
+    if (pSet == NULL)
+        return NULL;
+
+    dmbMemSet(pSet, 0, sizeof(dmbPartition) * uCount);
+    for (i = 0; i < uCount; ++i)
+    {
+        pPart = &pSet[i];
+        pPart->index = i;
+        pPart->count = uCount;
+        pPart->peers = pSet;
+        pPart->notifyFd = DMB_INVALID_FD;
+        dmbListInit(&pPart->replyList);
+    }
+
+    for (i = 0; i < uCount; ++i)
+    {
+        pPart = &pSet[i];
+        pPart->dict = dmbDictCreate(pMeta, uSize);
+        pPart->inbox = (dmbMailbox*)dmbMalloc(sizeof(dmbMailbox) * uCount);
+        if (pPart->dict == NULL || pPart->inbox == NULL)
+            goto failed;
+
+        dmbMemSet(pPart->inbox, 0, sizeof(dmbMailbox) * uCount);
+        for (j = 0; j < uCount; ++j)
+        {
+            //a partition never mails itself
+            if (j != i && dmbMailboxInit(&pPart->inbox[j], uMailboxSize) != DMB_ERRCODE_OK)
+                goto failed;
+        }
+    }
+
+    return pSet;
+
+failed:
+    dmbPartitionDestroySet(pSet);
+    return NULL;
+}
+
+void dmbPartitionDestroySet(dmbPartition *pSet)
+{
+    dmbUINT i, j, count = pSet->count;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (pSet[i].dict != NULL)
+            dmbDictDestroy(pSet[i].dict);
+
+        if (pSet[i].inbox != NULL)
+        {
+            for (j = 0; j < count; ++j)
+                dmbMailboxPurge(&pSet[i].inbox[j]);
+            dmbFree(pSet[i].inbox);
+        }
+    }
+
+    dmbFree(pSet);
+}
+
+static inline void wakeUp(dmbPartition *pPart)
+{
+    //an invalid socket in the accept pipe tells the work thread to check its inbox
+    dmbSOCKET mark = DMB_INVALID_FD;
+
+    if (pPart->notifyFd != DMB_INVALID_FD)
+        dmbSafeWrite(pPart->notifyFd, (dmbBYTE*)&mark, sizeof(dmbSOCKET));
+}
+
+static inline dmbBOOL mail(dmbPartition *pFrom, dmbPartition *pTo, dmbPartitionMsg *pMsg)
+{
+    dmbBOOL wake = FALSE;
+
+    if (!dmbMailboxPush(&pTo->inbox[pFrom->index], pMsg, &wake))
+        return FALSE;
+
+    if (wake)
+        wakeUp(pTo);
+
+    return TRUE;
+}
+
+dmbCode dmbPartitionSubmit(dmbPartition *pSelf, dmbUINT64 hash, dmbPartitionMsg *pMsg)
+{
+    dmbPartition *pOwner = dmbPartitionOwner(pSelf, hash);
+
+    if (pOwner == pSelf)
+    {
+        pSelf->localOps++;
+        pMsg->code = pMsg->exec(pSelf->dict, pMsg);
+        pMsg->done(pMsg);
+        return DMB_ERRCODE_OK;
+    }
+
+    pMsg->from = pSelf->index;
+    pMsg->isReply = FALSE;
+    if (!mail(pSelf, pOwner, pMsg))
+        return DMB_ERRCODE_MAILBOX_FULL;
+
+    pSelf->forwardedOps++;
+    return DMB_ERRCODE_OK;
+}
+
+dmbUINT dmbPartitionProcessMail(dmbPartition *pSelf)
+{
+    dmbPartitionMsg *pMsg;
+    dmbNode *pNode;
+    dmbUINT i, uCount = 0;
+
+    //replies that did not fit last time go first, so they keep their order
+    while (!dmbListIsEmpty(&pSelf->replyList))
+    {
+        pNode = dmbListPopFront(&pSelf->replyList);
+        pMsg = DMB_ENTRY(pNode, dmbPartitionMsg, replyNode);
+        if (!mail(pSelf, &pSelf->peers[pMsg->from], pMsg))
+        {
+            dmbListPushFront(&pSelf->replyList, pNode);
+            break;
+        }
+    }
+
+    for (i = 0; i < pSelf->count; ++i)
+    {
+        if (i == pSelf->index)
+            continue;
+
+        while ((pMsg = (dmbPartitionMsg*)dmbMailboxPop(&pSelf->inbox[i])) != NULL)
+        {
+            uCount++;
+
+            if (pMsg->isReply)
+            {
+                pMsg->done(pMsg);
+                continue;
+            }
+
+            pSelf->servedOps++;
+            pMsg->code = pMsg->exec(pSelf->dict, pMsg);
+            pMsg->isReply = TRUE;
+            if (!dmbListIsEmpty(&pSelf->replyList) || !mail(pSelf, &pSelf->peers[pMsg->from], pMsg))
+                dmbListPushBack(&pSelf->replyList, &pMsg->replyNode);
+        }
+    }
+
+    return uCount;
+}
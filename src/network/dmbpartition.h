@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBPARTITION_H
+#define DMBPARTITION_H
+
+#include "dmbdefines.h"
+#include "dmbnetwork.h"
+#include "core/dmbdict.h"
+#include "core/dmblist.h"
+#include "thread/dmbmailbox.h"
+
+/*
+ * Shared nothing keyspace: every work thread owns one partition and is the
+ * only thread that touches its dict. A key belongs to the partition chosen by
+ * the high bits of its hash. An operation on a key owned by another thread
+ * is forwarded as a dmbPartitionMsg through the owner's inbox, executed there,
+ * and the same message travels back through the sender's inbox as the reply.
+ *
+ * inbox[i] of a partition is only written by partition i, so every ring is
+ * single producer / single consumer and the hot path takes no lock.
+ */
+
+struct dmbPartitionMsg;
+
+typedef dmbCode (*dmbPartitionExecFunc)(dmbDict *pDict, struct dmbPartitionMsg *pMsg);
+typedef void (*dmbPartitionDoneFunc)(struct dmbPartitionMsg *pMsg);
+
+typedef struct dmbPartitionMsg {
+    //runs on the owner thread with its dict
+    dmbPartitionExecFunc exec;
+    //runs on the sender thread once exec is done
+    dmbPartitionDoneFunc done;
+    dmbUINT from;
+    dmbBOOL isReply;
+    dmbCode code;
+    void *data;
+    //queued here while the sender's inbox is full
+    dmbNode replyNode;
+} dmbPartitionMsg;
+
+typedef struct dmbPartition {
+    dmbDict *dict;
+    dmbUINT index;
+    dmbUINT count;
+    struct dmbPartition *peers;
+    dmbMailbox *inbox;
+    dmbList replyList;
+    //write end of the owner thread's pipe, DMB_INVALID_FD when the owner polls
+    dmbPIPE notifyFd;
+    dmbUINT64 localOps;
+    dmbUINT64 forwardedOps;
+    dmbUINT64 servedOps;
+} dmbPartition;
+
+#define dmbPartitionOwner(PART, HASH) (&(PART)->peers[(dmbUINT)((HASH) >> 32) % (PART)->count])
+
+/**
+ * @brief dmbPartitionCreateSet 创建uCount个分区，每个分区一个字典和uCount个SPSC邮箱
+ * @param uSize 每个分区字典的初始大小
+ * @param uMailboxSize 每个邮箱的容量
+ * @return 分区数组，失败返回NULL
+ */
+dmbPartition* dmbPartitionCreateSet(dmbUINT uCount, dmbDictMeta *pMeta, dmbUINT uSize, dmbUINT uMailboxSize);
+
+void dmbPartitionDestroySet(dmbPartition *pSet);
+
+/**
+ * @brief dmbPartitionSubmit 在hash所属的分区上执行消息，本分区直接执行并回调done，否则转发给所属线程
+ * @return 目标邮箱已满返回DMB_ERRCODE_MAILBOX_FULL，调用者处理自己的邮箱后重试
+ */
+dmbCode dmbPartitionSubmit(dmbPartition *pSelf, dmbUINT64 hash, dmbPartitionMsg *pMsg);
+
+/**
+ * @brief dmbPartitionProcessMail 执行转发来的请求并发回应答，处理收到的应答，由分区所属线程在事件循环中调用
+ * @return 处理的消息个数
+ */
+dmbUINT dmbPartitionProcessMail(dmbPartition *pSelf);
+
+#endif // DMBPARTITION_H
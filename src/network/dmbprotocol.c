@@ -20,7 +20,9 @@
 #include "base/dmbsettings.h"
 #include "utils/dmblog.h"
 #include "core/dmballoc.h"
+#include "utils/dmbsysutil.h"
 #include <arpa/inet.h>
+#include <stddef.h>
 
 static dmbCode readData(dmbNetworkContext *pCtx, dmbConnect *pConn);
 static dmbCode processData(dmbConnect *pConn);
@@ -49,18 +51,18 @@ static dmbCode parsePkgHeader(dmbBYTE *pBuf, dmbRequest **pDestRequest)
     return DMB_ERRCODE_OK;
 }
 
-static inline void setResponse(dmbResponse *pResp, dmbCode code, dmbUINT length)
+//the header follows whatever is already pending in the write buffer, so it may start at any address
+static inline void setResponse(dmbBYTE *pResp, dmbCode code, dmbUINT length)
 {
-    pResp->magicNum = htons(DMB_MAGIC_NUMBER);
-    pResp->version = htons(DMB_VERSION);
-    pResp->status = htons(code);
-    pResp->length = htonl(length);
+    dmbInt16ToByte(pResp + offsetof(dmbResponse, magicNum), htons(DMB_MAGIC_NUMBER));
+    dmbInt16ToByte(pResp + offsetof(dmbResponse, version), htons(DMB_VERSION));
+    dmbInt16ToByte(pResp + offsetof(dmbResponse, status), htons(code));
+    dmbInt32ToByte(pResp + offsetof(dmbResponse, length), htonl(length));
 }
 
 void dmbMakeErrorResponse(dmbConnect *pConn, dmbCode code)
 {
-    dmbResponse *pResp = (dmbResponse*) pConn->writeBuf;
-    setResponse(pResp, code, 0);
+    setResponse(pConn->writeBuf, code, 0);
     pConn->needClose = needDisconnect(code);
     pConn->writeIndex = 0;
     pConn->writeLength += dmbResponseHeaderSize;
@@ -68,24 +70,55 @@ void dmbMakeErrorResponse(dmbConnect *pConn, dmbCode code)
 
 void dmbMakeResponseWithData(dmbConnect *pConn, dmbCode code, dmbBYTE *pData, dmbUINT uSize)
 {
-    dmbResponse *pResp;
     if (dmbResponseHeaderSize + uSize > g_settings.net_write_bufsize)
     {
         pConn->writeIndex = 0;
-        pResp = (dmbResponse*) pConn->writeBuf;
-        setResponse(pResp, DMB_ERRCODE_OUT_OF_WRITEBUF, 0);
+        setResponse(pConn->writeBuf, DMB_ERRCODE_OUT_OF_WRITEBUF, 0);
         pConn->writeLength += dmbResponseHeaderSize;
         pConn->needClose = TRUE;
         return ;
     }
 
-    pResp = (dmbResponse*) pConn->writeBuf + pConn->writeIndex;
-    setResponse(pResp, code, uSize);
+    setResponse(pConn->writeBuf + pConn->writeIndex, code, uSize);
     pConn->needClose = needDisconnect(code);
     pConn->writeLength += dmbResponseHeaderSize + uSize;
     dmbMemCopy(pConn->writeBuf+pConn->writeIndex+dmbResponseHeaderSize, pData, uSize);
 }
 
+dmbBinlist* dmbBeginBinlistResponse(dmbConnect *pConn, dmbFixmemAllocator *pAllocator)
+{
+    //after the bytes still waiting to be sent
+    dmbUINT uPos = pConn->writeIndex + pConn->writeLength + dmbResponseHeaderSize;
+
+    if (uPos >= pConn->writeBufSize)
+        return NULL;
+
+    dmbInitFixmemAllocator(pAllocator, pConn->writeBuf + uPos, pConn->writeBufSize - uPos);
+    return dmbBinlistCreate(&pAllocator->allocator);
+}
+
+void dmbEndBinlistResponse(dmbConnect *pConn, dmbBinlist *pList, dmbCode code)
+{
+    dmbUINT uPos = pConn->writeIndex + pConn->writeLength, uSize;
+
+    if (pList == NULL || code == DMB_ERRCODE_BINLIST_NO_ENOUGH_SPACE)
+        code = DMB_ERRCODE_OUT_OF_WRITEBUF;
+
+    if (uPos + dmbResponseHeaderSize > pConn->writeBufSize)
+    {
+        pConn->writeIndex = 0;
+        setResponse(pConn->writeBuf, DMB_ERRCODE_OUT_OF_WRITEBUF, 0);
+        pConn->writeLength = dmbResponseHeaderSize;
+        pConn->needClose = TRUE;
+        return ;
+    }
+
+    uSize = code == DMB_ERRCODE_OK ? dmbBinlistRawSize(pList) : 0;
+    setResponse(pConn->writeBuf + uPos, code, uSize);
+    pConn->needClose = needDisconnect(code);
+    pConn->writeLength += dmbResponseHeaderSize + uSize;
+}
+
 void dmbProcessEvent(dmbNetworkContext *pCtx, dmbConnect *pConn)
 {
     dmbCode readCode, dataCode, writeCode;
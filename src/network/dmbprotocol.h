@@ -19,6 +19,7 @@
 #define DMBPROTOCOL_H
 
 #include "dmbnetwork.h"
+#include "core/dmbbinlist.h"
 
 #define DMB_MAGIC_NUMBER 0x1222
 
@@ -56,4 +57,16 @@ enum {
 
 void dmbProcessEvent(dmbNetworkContext *pCtx, dmbConnect *pConn);
 
+/**
+ * @brief dmbBeginBinlistResponse 在写缓存中待发送的数据之后预留响应头，返回紧跟其后的空binlist，
+ *        之后用pAllocator向它追加元素，数据直接写在写缓存中，空间不足时返回NULL
+ */
+dmbBinlist* dmbBeginBinlistResponse(dmbConnect *pConn, dmbFixmemAllocator *pAllocator);
+
+/**
+ * @brief dmbEndBinlistResponse 写入响应头提交数据，pList为NULL或code不为OK时只返回错误码，
+ *        追加时写缓存不足（DMB_ERRCODE_BINLIST_NO_ENOUGH_SPACE）返回DMB_ERRCODE_OUT_OF_WRITEBUF
+ */
+void dmbEndBinlistResponse(dmbConnect *pConn, dmbBinlist *pList, dmbCode code);
+
 #endif // DMBPROTOCOL_H
@@ -22,10 +22,13 @@
 #include "thread/dmbatomic.h"
 #include <sys/socket.h>
 #include "dmbprotocol.h"
+#include "core/dmbdictmetas.h"
 
 #define DEFAULT_SELECT_TIMEOUT 5 //second
 #define DEFAULT_SELECT_EPOLL_TIMEOUT 5000 //millisecond
 #define DEFAULT_EPOLL_EVENTNUM 10240
+#define DEFAULT_PARTITION_SIZE 1024
+#define DEFAULT_MAILBOX_SIZE 4096
 
 void * acceptThreadImpl (dmbThreadData data);
 void * workThreadImpl (dmbThreadData data);
@@ -55,6 +58,13 @@ dmbCode dmbInitServerContext(dmbServerContext *pCtx)
         return DMB_ERRCODE_ALLOC_FAILED;
     }
 
+    pCtx->partitions = dmbPartitionCreateSet(g_settings.thread_size, &dmbDictMetaStr, DEFAULT_PARTITION_SIZE, DEFAULT_MAILBOX_SIZE);
+    if (pCtx->partitions == NULL)
+    {
+        DMB_SAFE_FREE(pCtx->workThreadArr);
+        return DMB_ERRCODE_ALLOC_FAILED;
+    }
+
     for (i=0; i<g_settings.thread_size; ++i)
     {
         pCtx->workThreadArr[i].pipeArr[0] = DMB_INVALID_FD;
@@ -63,6 +73,7 @@ dmbCode dmbInitServerContext(dmbServerContext *pCtx)
         dmbMemSet(pCtx->workThreadArr[i].cliSoDataArr, 0, DMB_CLISO_ARR_SIZE);
         pCtx->workThreadArr[i].cliSoDataIndex = 0;
         pCtx->workThreadArr[i].connCount = 0;
+        pCtx->workThreadArr[i].partition = &pCtx->partitions[i];
     }
 
     return code;
@@ -72,6 +83,12 @@ void dmbPurgeServerContext(dmbServerContext *pCtx)
 {
     pCtx->acceptSocket = DMB_INVALID_FD;
 
+    if (pCtx->partitions != NULL)
+    {
+        dmbPartitionDestroySet(pCtx->partitions);
+        pCtx->partitions = NULL;
+    }
+
     DMB_SAFE_FREE(pCtx->workThreadArr);
 }
 
@@ -123,6 +140,9 @@ dmbCode dmbInitWorkThreads(dmbServerContext *pCtx)
         if (pipe(pCtx->workThreadArr[i].pipeArr) != 0)
             return DMB_ERRCODE_NETWORK_ERROR;
 
+        //other threads wake this one up through the same pipe when they forward requests
+        pCtx->workThreadArr[i].partition->notifyFd = pCtx->workThreadArr[i].pipeArr[1];
+
         code = dmbNetworkAddEvent(&pCtx->workThreadArr[i].ctx, pCtx->workThreadArr[i].pipeArr[0], DMB_NW_READ, NULL);
         if (code != DMB_ERRCODE_OK)
             return code;
@@ -248,6 +268,10 @@ static dmbCode processNewConnect(dmbWorkThreadData *pData)
     {
         for (i = 0; i<iCount; pSocket++, i++)
         {
+            //wake up mark from dmbPartition, the inbox is checked every loop
+            if (*pSocket == DMB_INVALID_FD)
+                continue;
+
             if (dmbNetworkProcessNewConnect(&pData->ctx, *pSocket, g_settings.net_rw_timeout) == DMB_ERRCODE_OK)
             {
                 //Dont care about this.
@@ -312,6 +336,8 @@ void * workThreadImpl (dmbThreadData data)
             dmbProcessEvent(pCtx, pConn);
         }
 
+        dmbPartitionProcessMail(pThreadData->partition);
+
         processRoundRobin(pCtx);
 
         dmbNetworkCloseTimeoutConnect(pCtx);
@@ -21,6 +21,7 @@
 #include "dmbdefines.h"
 #include "dmbnetwork.h"
 #include "thread/dmbthread.h"
+#include "dmbpartition.h"
 
 #define DMB_CLISO_ARR_SIZE 131072
 
@@ -32,10 +33,13 @@ typedef struct dmbWorkThreadData {
     dmbBYTE cliSoDataArr[DMB_CLISO_ARR_SIZE]; //accept socket data
     dmbINT cliSoDataIndex;
     volatile dmbINT64 connCount;
+    //keyspace partition owned by this thread
+    dmbPartition *partition;
 } dmbWorkThreadData;
 
 typedef struct dmbServerContext {
     dmbWorkThreadData *workThreadArr;
+    dmbPartition *partitions;
     dmbSOCKET acceptSocket;
     dmbThread acceptThread;
 } dmbServerContext;
@@ -19,6 +19,26 @@
 #include "core/dmbbinlist.h"
 #include "utils/dmblog.h"
 #include "core/dmballoc.h"
+#include "core/dmblzf.h"
+#include "utils/dmbtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//entries of the index test, above the old 65535 entry limit
+#define INDEX_TEST_ENTRIES 200000
+#define INDEX_BENCH_LOOKUPS 200000
+//lookups of the unindexed walk, it is O(n) per lookup
+#define INDEX_BENCH_WALKS 2000
+//random edits of the edit test, checked against a plain array
+#define EDIT_TEST_OPS 20000
+#define EDIT_TEST_MAX_ENTRIES 512
+#define EDIT_BENCH_OPS 200000
+//lists of the find test and lookups per benchmark round
+#define FIND_TEST_LISTS 200
+#define FIND_BENCH_LOOKUPS 200000
+//binlists of about this size are compressed by the compress benchmark
+#define COMPRESS_SEGMENT_SIZE 8192
+#define COMPRESS_BENCH_SEGMENTS 2000
 
 //#define TEST_DEFAULT_ALLCATOR
 
@@ -214,3 +234,604 @@ static void  printEntrys(const char *pcTag, dmbBinlist *pList)
         pEntry = dmbBinlistNext(pEntry);
     }
 }
+
+//entry i holds i, every third one as a string, buf keeps the string
+static void itemIndexed(dmbBinItem *pItem, dmbCHAR *buf, dmbUINT i)
+{
+    dmbUINT len;
+
+    if (i % 3 == 0)
+    {
+        len = snprintf(buf, 16, "%u", i);
+        DMB_BINITEM_STR(pItem, (dmbBYTE*)buf, len);
+    }
+    else
+    {
+        DMB_BINITEM_I32(pItem, i);
+    }
+}
+
+static dmbCode pushIndexed(dmbBinlist **pList, dmbUINT i)
+{
+    dmbBinItem item;
+    dmbCHAR buf[16];
+
+    itemIndexed(&item, buf, i);
+    return dmbBinlistPushBack(DMB_DEFAULT_BINALLOCATOR, pList, &item, FALSE);
+}
+
+static dmbBOOL checkIndexed(dmbBinEntry *pEntry, dmbUINT i)
+{
+    dmbBinVar var;
+    dmbCHAR buf[16];
+    dmbUINT len;
+
+    if (pEntry == NULL)
+        return FALSE;
+
+    dmbBinEntryGet(pEntry, &var);
+    if (i % 3 != 0)
+        return !DMB_BINENTRY_IS_STR(pEntry) && var.i32 == (dmbINT32)i;
+
+    len = snprintf(buf, sizeof(buf), "%u", i);
+    return DMB_BINENTRY_IS_STR(pEntry) && var.len == len && dmbMemCmp(var.data, buf, len) == 0;
+}
+
+static void benchIndex(dmbBinlist *pList, dmbUINT uStep)
+{
+    dmbBinlistIndex index;
+    dmbUINT i, uLen = dmbBinlistLen(pList), uBad = 0;
+    dmbLONG lCost;
+
+    dmbBinlistIndexInit(&index, uStep);
+    dmbBinlistIndexUpdate(&index, pList, 0);
+
+    srandom(uStep);
+    lCost = dmbLocalCurrentMillis();
+    for (i=0; i<(uStep == 0 ? INDEX_BENCH_WALKS : INDEX_BENCH_LOOKUPS); ++i)
+        uBad += dmbBinlistIndexGet(&index, pList, (dmbUINT)random() % uLen) == NULL;
+    lCost = dmbLocalCurrentMillis() - lCost;
+
+    DMB_LOGD("binlist %6u entries, step %2u: %9.1f ns/lookup, index %6u bytes, bad %u\n", uLen, uStep,
+             lCost * 1000000.0 / (uStep == 0 ? INDEX_BENCH_WALKS : INDEX_BENCH_LOOKUPS), index.num * (dmbUINT)sizeof(dmbUINT), uBad);
+
+    dmbBinlistIndexClear(&index);
+}
+
+void dmbbinlist_index_test()
+{
+    static const dmbUINT steps[] = {0, 8, 16, 64};
+    dmbBinlist *pList = dmbBinlistCreate(DMB_DEFAULT_BINALLOCATOR);
+    dmbBinlistIndex index;
+    dmbUINT i, k, uLen, uBad = 0;
+
+    for (i=0; i<INDEX_TEST_ENTRIES; ++i)
+        uBad += pushIndexed(&pList, i) != DMB_ERRCODE_OK;
+    uBad += dmbBinlistLen(pList) != INDEX_TEST_ENTRIES;
+
+    dmbBinlistIndexInit(&index, 16);
+    uBad += dmbBinlistIndexUpdate(&index, pList, 0) != DMB_ERRCODE_OK;
+    for (i=0; i<INDEX_TEST_ENTRIES; i+=7)
+        uBad += !checkIndexed(dmbBinlistIndexGet(&index, pList, i), i);
+    uBad += !checkIndexed(dmbBinlistGet(pList, INDEX_TEST_ENTRIES - 1), INDEX_TEST_ENTRIES - 1);
+    uBad += dmbBinlistIndexGet(&index, pList, INDEX_TEST_ENTRIES) != NULL;
+
+    //appends are indexed from the old length on
+    for (i=INDEX_TEST_ENTRIES; i<INDEX_TEST_ENTRIES+1000; ++i)
+        uBad += pushIndexed(&pList, i) != DMB_ERRCODE_OK;
+    uBad += dmbBinlistIndexUpdate(&index, pList, INDEX_TEST_ENTRIES) != DMB_ERRCODE_OK;
+    for (i=INDEX_TEST_ENTRIES-100; i<INDEX_TEST_ENTRIES+1000; ++i)
+        uBad += !checkIndexed(dmbBinlistIndexGet(&index, pList, i), i);
+    uBad += index.num != (INDEX_TEST_ENTRIES + 1000 + 15) / 16;
+
+    DMB_LOGD("binlist index: %u entries, bad %u\n", dmbBinlistLen(pList), uBad);
+    dmbBinlistIndexClear(&index);
+    dmbBinlistDestroy(DMB_DEFAULT_BINALLOCATOR, pList);
+
+    for (uLen = 1000; uLen <= INDEX_TEST_ENTRIES * 5; uLen *= 10)
+    {
+        pList = dmbBinlistCreate(DMB_DEFAULT_BINALLOCATOR);
+        for (i=0; i<uLen; ++i)
+            pushIndexed(&pList, i);
+
+        for (k=0; k<sizeof(steps)/sizeof(steps[0]); ++k)
+            benchIndex(pList, steps[k]);
+
+        dmbBinlistDestroy(DMB_DEFAULT_BINALLOCATOR, pList);
+    }
+}
+
+//compares the whole list, its length and its last entry with the model
+static dmbUINT checkEdited(dmbBinlist *pList, dmbUINT *pModel, dmbUINT uLen)
+{
+    dmbBinEntry *pEntry = dmbBinlistFirst(pList);
+    dmbUINT i, uBad = 0;
+
+    for (i=0; i<uLen; ++i, pEntry = dmbBinlistNext(pEntry))
+    {
+        if (!checkIndexed(pEntry, pModel[i]))
+            return 1;
+    }
+
+    //Next returns NULL after the last entry
+    uBad += dmbBinlistLen(pList) != uLen;
+    uBad += uLen > 0 ? pEntry != NULL : pEntry[0] != DMB_BINLIST_ENDCODE;
+    if (uLen > 0)
+        uBad += !checkIndexed(dmbBinlistLast(pList), pModel[uLen - 1]);
+    else
+        uBad += dmbBinlistLast(pList) != dmbBinlistFirst(pList);
+
+    return uBad;
+}
+
+static dmbUINT editOnce(dmbBinlist **pList, dmbUINT *pModel, dmbUINT *pLen, dmbUINT uValue)
+{
+    dmbBinItem items[4];
+    dmbCHAR bufs[4][16];
+    dmbUINT uPos = (dmbUINT)random() % (*pLen + 1), uCount = (dmbUINT)random() % 4 + 1, i, uBad = 0;
+    dmbBinEntry *pEntry = uPos < *pLen ? dmbBinlistGet(*pList, uPos) : NULL;
+
+    switch (random() % 3)
+    {
+    case 0:
+        if (*pLen + uCount > EDIT_TEST_MAX_ENTRIES)
+            break;
+        for (i=0; i<uCount; ++i)
+            itemIndexed(&items[i], bufs[i], uValue + i);
+        uBad += dmbBinlistInsertAt(DMB_DEFAULT_BINALLOCATOR, pList, pEntry, items, uCount) != DMB_ERRCODE_OK;
+        dmbMemMove(pModel + uPos + uCount, pModel + uPos, sizeof(dmbUINT) * (*pLen - uPos));
+        for (i=0; i<uCount; ++i)
+            pModel[uPos + i] = uValue + i;
+        *pLen += uCount;
+        break;
+    case 1:
+        if (pEntry == NULL)
+            break;
+        //the range may run past the end
+        uBad += dmbBinlistDeleteRange(DMB_DEFAULT_BINALLOCATOR, pList, pEntry, uCount) != DMB_ERRCODE_OK;
+        if (uCount > *pLen - uPos)
+            uCount = *pLen - uPos;
+        dmbMemMove(pModel + uPos, pModel + uPos + uCount, sizeof(dmbUINT) * (*pLen - uPos - uCount));
+        *pLen -= uCount;
+        break;
+    default:
+        if (pEntry == NULL)
+            break;
+        itemIndexed(&items[0], bufs[0], uValue);
+        uBad += dmbBinlistReplace(DMB_DEFAULT_BINALLOCATOR, pList, pEntry, &items[0]) != DMB_ERRCODE_OK;
+        pModel[uPos] = uValue;
+        break;
+    }
+
+    return uBad;
+}
+
+static void benchEdit(dmbUINT uLen)
+{
+    dmbBinlist *pList = dmbBinlistCreate(DMB_DEFAULT_BINALLOCATOR);
+    dmbBinItem items[2];
+    dmbCHAR buf[16];
+    dmbUINT i, uBad = 0;
+    dmbLONG lCost;
+
+    for (i=0; i<uLen; ++i)
+        pushIndexed(&pList, i);
+
+    //a zset style move: insert a pair somewhere, drop one elsewhere
+    srandom(uLen);
+    lCost = dmbLocalCurrentMillis();
+    for (i=0; i<EDIT_BENCH_OPS; ++i)
+    {
+        itemIndexed(&items[0], buf, i * 3);
+        DMB_BINITEM_I32(&items[1], 1);
+        uBad += dmbBinlistInsertAt(DMB_DEFAULT_BINALLOCATOR, &pList, dmbBinlistGet(pList, (dmbUINT)random() % uLen), items, 2) != DMB_ERRCODE_OK;
+        uBad += dmbBinlistDeleteRange(DMB_DEFAULT_BINALLOCATOR, &pList, dmbBinlistGet(pList, (dmbUINT)random() % uLen), 2) != DMB_ERRCODE_OK;
+    }
+    lCost = dmbLocalCurrentMillis() - lCost;
+
+    DMB_LOGD("binlist %5u entries: %7.1f ns/move, bad %u\n", uLen, lCost * 1000000.0 / EDIT_BENCH_OPS, uBad + (dmbBinlistLen(pList) != uLen));
+    dmbBinlistDestroy(DMB_DEFAULT_BINALLOCATOR, pList);
+}
+
+void dmbbinlist_edit_test()
+{
+    dmbBinlist *pList = dmbBinlistCreate(DMB_DEFAULT_BINALLOCATOR);
+    dmbUINT *pModel = (dmbUINT*)dmbMalloc(sizeof(dmbUINT) * EDIT_TEST_MAX_ENTRIES);
+    dmbUINT i, uLen = 0, uBad = 0;
+
+    srandom(17);
+    for (i=0; i<EDIT_TEST_OPS; ++i)
+    {
+        //values grow so strings and ints of every size get mixed
+        uBad += editOnce(&pList, pModel, &uLen, i * 37);
+        uBad += checkEdited(pList, pModel, uLen);
+
+        //the last offset must be right for appends after the edits
+        if (i % 100 == 0 && uLen < EDIT_TEST_MAX_ENTRIES)
+        {
+            uBad += pushIndexed(&pList, i) != DMB_ERRCODE_OK;
+            pModel[uLen++] = i;
+            uBad += checkEdited(pList, pModel, uLen);
+        }
+    }
+
+    //drop everything from the head, then refill
+    uBad += uLen > 0 && dmbBinlistDeleteRange(DMB_DEFAULT_BINALLOCATOR, &pList, dmbBinlistFirst(pList), uLen + 10) != DMB_ERRCODE_OK;
+    uBad += checkEdited(pList, pModel, 0);
+    for (uLen=0; uLen<3; ++uLen)
+    {
+        uBad += pushIndexed(&pList, uLen) != DMB_ERRCODE_OK;
+        pModel[uLen] = uLen;
+    }
+    uBad += checkEdited(pList, pModel, uLen);
+
+    DMB_LOGD("binlist edit: %u ops, bad %u\n", EDIT_TEST_OPS, uBad);
+    dmbFree(pModel);
+    dmbBinlistDestroy(DMB_DEFAULT_BINALLOCATOR, pList);
+
+    for (i=16; i<=4096; i*=4)
+        benchEdit(i);
+}
+
+//the decode loop dmbBinlistFind replaces
+static dmbBinEntry* scalarFind(dmbBinlist *pList, const dmbBYTE *pData, dmbUINT uLen, dmbUINT uSkip)
+{
+    dmbBinEntry *pEntry = dmbBinlistLen(pList) == 0 ? NULL : dmbBinlistFirst(pList);
+    dmbBinVar var;
+    dmbUINT i;
+
+    while (pEntry != NULL)
+    {
+        dmbBinEntryGet(pEntry, &var);
+        if (DMB_BINENTRY_IS_STR(pEntry) && var.len == uLen && dmbMemCmp(var.data, pData, uLen) == 0)
+            return pEntry;
+
+        for (i=0; i<=uSkip && pEntry != NULL; ++i)
+            pEntry = dmbBinlistNext(pEntry);
+    }
+
+    return NULL;
+}
+
+static dmbBinEntry* scalarFindInt(dmbBinlist *pList, dmbINT64 value, dmbUINT uSkip)
+{
+    dmbBinEntry *pEntry = dmbBinlistLen(pList) == 0 ? NULL : dmbBinlistFirst(pList);
+    dmbBinVar var;
+    dmbUINT i;
+
+    while (pEntry != NULL)
+    {
+        dmbBinEntryGet(pEntry, &var);
+        switch (DMB_BINCODE(pEntry)) {
+        case DMB_BINCODE_I16:
+            if (var.i16 == value)
+                return pEntry;
+            break;
+        case DMB_BINCODE_I32:
+            if (var.i32 == value)
+                return pEntry;
+            break;
+        case DMB_BINCODE_I64:
+            if (var.i64 == value)
+                return pEntry;
+            break;
+        }
+
+        for (i=0; i<=uSkip && pEntry != NULL; ++i)
+            pEntry = dmbBinlistNext(pEntry);
+    }
+
+    return NULL;
+}
+
+//strings of 1 to 80 bytes sharing a prefix, so most candidates differ late
+static dmbUINT findKey(dmbCHAR *buf, dmbUINT i)
+{
+    dmbUINT uLen = i % 80 + 1, k;
+
+    for (k=0; k<uLen; ++k)
+        buf[k] = 'a' + (k + 1 == uLen ? i % 26 : k % 7);
+    return uLen;
+}
+
+static dmbINT64 findValue(dmbUINT i)
+{
+    switch (i % 3) {
+    case 0:
+        return (dmbINT16)(i * 7) - 100;
+    case 1:
+        return -(dmbINT64)i * 40000;
+    default:
+        return (dmbINT64)i << 33;
+    }
+}
+
+static dmbUINT checkFind(dmbBinlist *pList, dmbUINT uSeed)
+{
+    dmbCHAR buf[128];
+    dmbUINT i, uLen, uSkip, uBad = 0;
+
+    for (i=0; i<200; ++i)
+    {
+        uSkip = i % 2;
+        uLen = findKey(buf, uSeed + i % 100);
+        uBad += dmbBinlistFind(pList, NULL, (dmbBYTE*)buf, uLen, uSkip) != scalarFind(pList, (dmbBYTE*)buf, uLen, uSkip);
+        uBad += dmbBinlistFindInt(pList, NULL, findValue(uSeed + i % 100), uSkip) != scalarFindInt(pList, findValue(uSeed + i % 100), uSkip);
+    }
+
+    return uBad;
+}
+
+static void benchFind(dmbUINT uLen)
+{
+    dmbBinlist *pMap = dmbBinlistCreate(DMB_DEFAULT_BINALLOCATOR), *pInts = dmbBinlistCreate(DMB_DEFAULT_BINALLOCATOR);
+    dmbBinItem item;
+    dmbCHAR buf[32];
+    dmbUINT i, k, len, uFound[4] = {0, 0, 0, 0};
+    dmbLONG lCost[4];
+    dmbINT64 value;
+
+    //field and value pairs like a small map, and plain integers
+    for (i=0; i<uLen; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), i % 2 == 0 ? "field:%u" : "value:%u", i / 2);
+        dmbBinItemStr(&item, (dmbBYTE*)buf, len);
+        dmbBinlistPushBack(DMB_DEFAULT_BINALLOCATOR, &pMap, &item, FALSE);
+        DMB_BINITEM_I64(&item, (dmbINT64)i * 1000);
+        dmbBinlistPushBack(DMB_DEFAULT_BINALLOCATOR, &pInts, &item, FALSE);
+    }
+
+    for (k=0; k<4; ++k)
+    {
+        //half of the lookups miss
+        srandom(uLen);
+        lCost[k] = dmbLocalCurrentMillis();
+        for (i=0; i<FIND_BENCH_LOOKUPS; ++i)
+        {
+            if (k < 2)
+            {
+                len = snprintf(buf, sizeof(buf), "field:%u", (dmbUINT)random() % uLen);
+                uFound[k] += (k == 0 ? scalarFind(pMap, (dmbBYTE*)buf, len, 1) : dmbBinlistFind(pMap, NULL, (dmbBYTE*)buf, len, 1)) != NULL;
+            }
+            else
+            {
+                value = (dmbINT64)((dmbUINT)random() % (uLen * 2)) * 1000;
+                uFound[k] += (k == 2 ? scalarFindInt(pInts, value, 0) : dmbBinlistFindInt(pInts, NULL, value, 0)) != NULL;
+            }
+        }
+        lCost[k] = dmbLocalCurrentMillis() - lCost[k];
+    }
+
+    DMB_LOGD("binlist find %3u entries: str %6.1f -> %6.1f ns, int %6.1f -> %6.1f ns, found %u/%u %u/%u\n", uLen,
+             lCost[0] * 1000000.0 / FIND_BENCH_LOOKUPS, lCost[1] * 1000000.0 / FIND_BENCH_LOOKUPS,
+             lCost[2] * 1000000.0 / FIND_BENCH_LOOKUPS, lCost[3] * 1000000.0 / FIND_BENCH_LOOKUPS,
+             uFound[0], uFound[1], uFound[2], uFound[3]);
+
+    dmbBinlistDestroy(DMB_DEFAULT_BINALLOCATOR, pMap);
+    dmbBinlistDestroy(DMB_DEFAULT_BINALLOCATOR, pInts);
+}
+
+void dmbbinlist_find_test()
+{
+    dmbBinlist *pList;
+    dmbBinItem item;
+    dmbCHAR buf[128];
+    dmbUINT i, k, uLen, uBad = 0;
+    dmbINT64 value;
+
+    //mixed lists, the keys near the end also check loads close to the end code
+    srandom(7);
+    for (i=0; i<FIND_TEST_LISTS; ++i)
+    {
+        pList = dmbBinlistCreate(DMB_DEFAULT_BINALLOCATOR);
+        for (k=0; k<(dmbUINT)random() % 64; ++k)
+        {
+            if (random() % 2 == 0)
+            {
+                uLen = findKey(buf, i + (dmbUINT)random() % 100);
+                dmbBinItemStr(&item, (dmbBYTE*)buf, uLen);
+            }
+            else
+            {
+                //the same value may be stored wider than it needs
+                value = findValue(i + (dmbUINT)random() % 100);
+                if (value == (dmbINT16)value && random() % 2 == 0)
+                    DMB_BINITEM_I16(&item, (dmbINT16)value);
+                else if (value == (dmbINT32)value && random() % 2 == 0)
+                    DMB_BINITEM_I32(&item, (dmbINT32)value);
+                else
+                    DMB_BINITEM_I64(&item, value);
+            }
+            uBad += dmbBinlistPushBack(DMB_DEFAULT_BINALLOCATOR, &pList, &item, FALSE) != DMB_ERRCODE_OK;
+        }
+
+        uBad += checkFind(pList, i);
+        dmbBinlistDestroy(DMB_DEFAULT_BINALLOCATOR, pList);
+    }
+
+    DMB_LOGD("binlist find: %u lists, bad %u\n", FIND_TEST_LISTS, uBad);
+
+    for (uLen=16; uLen<=512; uLen*=2)
+        benchFind(uLen);
+}
+
+//fills buf with data of the given kind: 0 zeros, 1 random, 2 text, 3 short period
+static void fillCodecData(dmbBYTE *buf, dmbUINT uLen, dmbUINT uKind)
+{
+    dmbUINT i, n;
+
+    for (i=0; i<uLen; i+=n)
+    {
+        switch (uKind) {
+        case 0:
+            n = 1;
+            buf[i] = 0;
+            break;
+        case 1:
+            n = 1;
+            buf[i] = (dmbBYTE)random();
+            break;
+        case 2:
+        {
+            dmbCHAR line[64];
+            n = snprintf(line, sizeof(line), "user:%u status=%s;", (dmbUINT)random() % 5000, random() % 4 ? "ok" : "failed");
+            if (n > uLen - i)
+                n = uLen - i;
+            dmbMemCopy(buf + i, line, n);
+            break;
+        }
+        default:
+            n = 1;
+            buf[i] = (dmbBYTE)(i % (uLen % 40 + 1));
+            break;
+        }
+    }
+}
+
+static dmbUINT checkCodec()
+{
+    static const dmbUINT lens[] = {1, 2, 3, 4, 31, 32, 33, 100, 8191, 8192, 8193, 70000};
+    dmbBYTE *pIn = (dmbBYTE*)dmbMalloc(70000), *pOut = (dmbBYTE*)dmbMalloc(80000), *pBack = (dmbBYTE*)dmbMalloc(70000);
+    dmbUINT i, k, n, uPacked, uBad = 0;
+
+    for (i=0; i<sizeof(lens)/sizeof(lens[0]); ++i)
+    {
+        for (k=0; k<4; ++k)
+        {
+            fillCodecData(pIn, lens[i], k);
+            //literal runs add a byte per 32, so this is always enough
+            uPacked = dmbLzfCompress(pIn, lens[i], pOut, lens[i] + lens[i] / 16 + 2);
+            uBad += uPacked == 0;
+            uBad += dmbLzfDecompress(pOut, uPacked, pBack, lens[i]) != lens[i] || dmbMemCmp(pIn, pBack, lens[i]) != 0;
+            //no room for the whole output
+            uBad += uPacked > 1 && dmbLzfDecompress(pOut, uPacked, pBack, lens[i] - 1) != 0;
+
+            //random data does not fit in less than its size
+            if (k == 1 && lens[i] > 100)
+                uBad += dmbLzfCompress(pIn, lens[i], pOut, lens[i] - 1) != 0;
+
+            //damaged streams may decode to garbage but never out of bounds
+            for (n=0; n<20 && uPacked > 0; ++n)
+            {
+                pOut[(dmbUINT)random() % uPacked] ^= (dmbBYTE)(random() | 1);
+                dmbLzfDecompress(pOut, uPacked - (dmbUINT)random() % (uPacked < 4 ? 1 : 4), pBack, lens[i]);
+            }
+        }
+    }
+
+    dmbFree(pIn);
+    dmbFree(pOut);
+    dmbFree(pBack);
+
+    return uBad;
+}
+
+static dmbCode pushText(dmbBinAllocator *pAllocator, dmbBinlist **pList, dmbUINT i)
+{
+    dmbBinItem item;
+    dmbCHAR buf[64];
+    dmbUINT len;
+
+    if (i % 4 == 3)
+    {
+        DMB_BINITEM_I64(&item, (dmbINT64)i * 1000);
+    }
+    else
+    {
+        len = snprintf(buf, sizeof(buf), "event:%u user:%u status=%s", i, i % 977, i % 5 ? "ok" : "retry");
+        DMB_BINITEM_STR(&item, (dmbBYTE*)buf, len);
+    }
+    return dmbBinlistPushBack(pAllocator, pList, &item, FALSE);
+}
+
+static void benchCompress()
+{
+    dmbLzfAllocator lzf;
+    dmbBinAllocator *pAllocator = dmbInitLzfAllocator(&lzf, 1024);
+    dmbBinlist **ppLists = (dmbBinlist**)dmbMalloc(sizeof(dmbBinlist*) * COMPRESS_BENCH_SEGMENTS);
+    dmbUINT i, k = 0, uBad = 0;
+    dmbUINT64 uRaw, uPacked;
+    double ratio;
+    dmbLONG lCompress;
+
+    for (i=0; i<COMPRESS_BENCH_SEGMENTS; ++i)
+    {
+        ppLists[i] = dmbBinlistCreate(pAllocator);
+        while (dmbBinlistRawSize(ppLists[i]) < COMPRESS_SEGMENT_SIZE)
+            uBad += pushText(pAllocator, &ppLists[i], k++) != DMB_ERRCODE_OK;
+    }
+
+    lCompress = dmbMonotonicNanos();
+    for (i=0; i<COMPRESS_BENCH_SEGMENTS; ++i)
+        uBad += dmbBinlistCompress(pAllocator, &ppLists[i]) != DMB_ERRCODE_OK;
+    lCompress = dmbMonotonicNanos() - lCompress;
+
+    uRaw = lzf.stats.rawBytes;
+    uPacked = lzf.stats.packedBytes;
+    ratio = dmbBinCompressRatio(&lzf.stats);
+    for (i=0; i<COMPRESS_BENCH_SEGMENTS; ++i)
+    {
+        uBad += dmbBinlistDecompress(pAllocator, &ppLists[i]) != DMB_ERRCODE_OK;
+        dmbBinlistDestroy(pAllocator, ppLists[i]);
+    }
+
+    DMB_LOGD("binlist lzf %u x %u bytes: %llu -> %llu bytes (%.2fx), compress %.1f us, decode %.1f us, %llu rejected, bad %u\n",
+             COMPRESS_BENCH_SEGMENTS, COMPRESS_SEGMENT_SIZE, (unsigned long long)uRaw, (unsigned long long)uPacked, ratio,
+             lCompress / 1000.0 / COMPRESS_BENCH_SEGMENTS, dmbBinDecodeNanos(&lzf.stats) / 1000.0,
+             (unsigned long long)lzf.stats.rejected, uBad);
+    dmbFree(ppLists);
+}
+
+void dmbbinlist_compress_test()
+{
+    dmbLzfAllocator lzf;
+    dmbBinAllocator *pAllocator = dmbInitLzfAllocator(&lzf, 256);
+    dmbBinlist *pList, *pSmall, *pRandom;
+    dmbBinItem item;
+    dmbBYTE buf[48], *pCopy;
+    dmbUINT i, uRaw, uBad = 0;
+
+    srandom(5);
+    uBad += checkCodec();
+
+    pList = dmbBinlistCreate(pAllocator);
+    pSmall = dmbBinlistCreate(pAllocator);
+    pRandom = dmbBinlistCreate(pAllocator);
+    for (i=0; i<3000; ++i)
+    {
+        uBad += pushText(pAllocator, &pList, i) != DMB_ERRCODE_OK;
+        fillCodecData(buf, sizeof(buf), 1);
+        uBad += dmbBinItemStr(&item, buf, sizeof(buf)) != DMB_ERRCODE_OK;
+        uBad += dmbBinlistPushBack(pAllocator, &pRandom, &item, FALSE) != DMB_ERRCODE_OK;
+    }
+    uBad += pushIndexed(&pSmall, 1) != DMB_ERRCODE_OK;
+
+    //below the threshold and incompressible lists stay as they are
+    uRaw = dmbBinlistRawSize(pList);
+    pCopy = (dmbBYTE*)dmbMalloc(uRaw);
+    dmbMemCopy(pCopy, pList, uRaw);
+    uBad += dmbBinlistCompress(pAllocator, &pList) != DMB_ERRCODE_OK || !dmbBinlistIsCompressed(pList);
+    uBad += dmbBinlistCompress(pAllocator, &pSmall) != DMB_ERRCODE_OK || dmbBinlistIsCompressed(pSmall);
+    uBad += dmbBinlistCompress(pAllocator, &pRandom) != DMB_ERRCODE_OK || dmbBinlistIsCompressed(pRandom);
+    uBad += lzf.stats.segments != 1 || lzf.stats.rejected != 1;
+    uBad += dmbBinlistLen(pList) != 3000 || dmbBinlistRawSize(pList) != uRaw;
+
+    uBad += dmbBinlistDecompress(DMB_DEFAULT_BINALLOCATOR, &pList) != DMB_ERRCODE_BINLIST_NO_CODEC;
+    uBad += dmbBinlistDecompress(pAllocator, &pList) != DMB_ERRCODE_OK || dmbBinlistIsCompressed(pList);
+    uBad += dmbBinlistRawSize(pList) != uRaw || lzf.stats.segments != 0 || lzf.stats.decodes != 1;
+    uBad += dmbMemCmp(pList, pCopy, uRaw) != 0;
+    dmbFree(pCopy);
+    //the last entry offset survives the round trip
+    uBad += pushIndexed(&pList, 3000) != DMB_ERRCODE_OK || !checkIndexed(dmbBinlistLast(pList), 3000);
+
+    //destroying a compressed list drops it from the stats
+    uBad += dmbBinlistCompress(pAllocator, &pList) != DMB_ERRCODE_OK || lzf.stats.segments != 1;
+    dmbBinlistDestroy(pAllocator, pList);
+    uBad += lzf.stats.segments != 0 || lzf.stats.rawBytes != 0 || lzf.stats.packedBytes != 0;
+    dmbBinlistDestroy(pAllocator, pSmall);
+    dmbBinlistDestroy(pAllocator, pRandom);
+
+    DMB_LOGD("binlist compress: bad %u\n", uBad);
+
+    benchCompress();
+}
@@ -22,4 +22,12 @@ void dmbbinlist_test();
 
 void dmbbinlist_merge_test();
 
+void dmbbinlist_index_test();
+
+void dmbbinlist_edit_test();
+
+void dmbbinlist_find_test();
+
+void dmbbinlist_compress_test();
+
 #endif // DMBBINLIST_TEST_H
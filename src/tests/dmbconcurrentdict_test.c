@@ -0,0 +1,167 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbconcurrentdict_test.h"
+#include "core/dmbconcurrentdict.h"
+#include "core/dmbdictmetas.h"
+#include "core/dmbstring.h"
+#include "core/dmballoc.h"
+#include "utils/dmbtime.h"
+#include "utils/dmblog.h"
+
+#ifndef CONCURRENT_KEY_COUNT
+#define CONCURRENT_KEY_COUNT 1000000
+#endif
+//total operations of one run, split over the threads
+#ifndef CONCURRENT_OPS
+#define CONCURRENT_OPS 4000000
+#endif
+#define MAX_THREADS 64
+
+typedef struct BenchShared {
+    dmbConcurrentDict *dict;
+    dmbString **keys;
+    dmbDictEntry *entrys;
+    dmbUINT keyCount;
+    //percent of writes, every write is a pop followed by a put back
+    dmbUINT writePercent;
+} BenchShared;
+
+typedef struct BenchWorker {
+    dmbThread thread;
+    BenchShared *shared;
+    dmbUINT64 seed;
+    dmbUINT ops;
+    dmbUINT found;
+    dmbUINT wrong;
+} BenchWorker;
+
+static void onRead(void *pPrivdata, dmbDictEntry *pEntry)
+{
+    *(dmbDictEntry**)pPrivdata = pEntry;
+}
+
+static void* benchWorker(dmbThreadData data)
+{
+    BenchWorker *pWorker = (BenchWorker*)dmbThreadGetParam(data);
+    BenchShared *pShared = pWorker->shared;
+    dmbDictEntry *pEntry, *pOld;
+    const dmbCHAR *keyData; dmbUINT len;
+    dmbUINT i, k;
+    dmbUINT64 x = pWorker->seed;
+
+    for (i = 0; i < pWorker->ops; ++i)
+    {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        k = (dmbUINT)(x % pShared->keyCount);
+        dmbStringGetData(pShared->keys[k], &keyData, &len);
+
+        if ((dmbUINT)((x >> 40) % 100) < pShared->writePercent)
+        {
+            //only the thread that popped the entry puts it back, so no entry is linked twice
+            pEntry = dmbConcurrentDictPopByData(pShared->dict, keyData, len);
+            if (pEntry != NULL)
+            {
+                pWorker->wrong += pEntry != &pShared->entrys[k];
+                pOld = dmbConcurrentDictPut(pShared->dict, pEntry);
+                pWorker->wrong += pOld != NULL;
+            }
+        }
+        else
+        {
+            pEntry = NULL;
+            if (dmbConcurrentDictRead(pShared->dict, keyData, len, onRead, &pEntry))
+            {
+                pWorker->found++;
+                pWorker->wrong += pEntry != &pShared->entrys[k];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void runBench(BenchShared *pShared, dmbUINT uThreads)
+{
+    BenchWorker workers[MAX_THREADS];
+    dmbUINT i, uWrong = 0, uFound = 0;
+    dmbLONG lCost;
+
+    for (i = 0; i < uThreads; ++i)
+    {
+        workers[i].shared = pShared;
+        workers[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+        workers[i].ops = CONCURRENT_OPS / uThreads;
+        workers[i].found = 0;
+        workers[i].wrong = 0;
+        dmbThreadInit(&workers[i].thread, benchWorker, NULL, &workers[i]);
+    }
+
+    lCost = dmbLocalCurrentMillis();
+    for (i = 0; i < uThreads; ++i)
+        dmbThreadStart(&workers[i].thread);
+    for (i = 0; i < uThreads; ++i)
+        dmbThreadJoin(&workers[i].thread);
+    lCost = dmbLocalCurrentMillis() - lCost;
+
+    for (i = 0; i < uThreads; ++i)
+    {
+        uWrong += workers[i].wrong;
+        uFound += workers[i].found;
+    }
+
+    DMB_LOGD("write %2u%%, %2u threads: %6.2f Mops/s, found %u, wrong %u\n", pShared->writePercent, uThreads,
+             lCost == 0 ? 0.0 : (double)workers[0].ops * uThreads / lCost / 1000.0, uFound, uWrong);
+}
+
+void dmbconcurrentdict_test()
+{
+    static const dmbUINT writePercents[] = {0, 10, 50};
+    BenchShared shared;
+    dmbCHAR buf[64];
+    dmbUINT i, t, w;
+
+    shared.keyCount = CONCURRENT_KEY_COUNT;
+    shared.dict = dmbConcurrentDictCreate(&dmbDictMetaStr, 0, CONCURRENT_KEY_COUNT);
+    shared.keys = (dmbString**)dmbMalloc(sizeof(dmbString*) * CONCURRENT_KEY_COUNT);
+    shared.entrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * CONCURRENT_KEY_COUNT);
+
+    for (i = 0; i < CONCURRENT_KEY_COUNT; ++i)
+    {
+        shared.keys[i] = dmbStringCreateWithFormat(sizeof(buf), "key:%u:%08x", i, i * 2654435761U);
+        shared.entrys[i].k.val = shared.keys[i];
+        shared.entrys[i].v.l = i;
+        dmbConcurrentDictPut(shared.dict, &shared.entrys[i]);
+    }
+    while (dmbConcurrentDictRehashMilliseconds(shared.dict, 100) > 0);
+
+    for (w = 0; w < sizeof(writePercents) / sizeof(writePercents[0]); ++w)
+    {
+        shared.writePercent = writePercents[w];
+        for (t = 1; t <= MAX_THREADS; t *= 2)
+            runBench(&shared, t);
+    }
+
+    //every popped entry was put back
+    DMB_LOGD("size after bench %u, expect %u\n", dmbConcurrentDictSize(shared.dict), CONCURRENT_KEY_COUNT);
+
+    dmbConcurrentDictDestroy(shared.dict);
+    for (i = 0; i < CONCURRENT_KEY_COUNT; ++i)
+        dmbStringDestroy(shared.keys[i]);
+    dmbFree(shared.keys);
+    dmbFree(shared.entrys);
+}
@@ -0,0 +1,444 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbdict_test.h"
+#include "core/dmbdict.h"
+#include "core/dmbflatdict.h"
+#include "core/dmbdictmetas.h"
+#include "core/dmballoc.h"
+#include "utils/dmbtime.h"
+#include "utils/dmblog.h"
+
+#define TEST_KEY_COUNT 1000000
+//the batch benchmark wants a working set well beyond the last level cache,
+//about 110 bytes a key, so it still fits the default max_mem_size of 512M
+#ifndef BATCH_KEY_COUNT
+#define BATCH_KEY_COUNT 3000000
+#endif
+#define BATCH_SIZE 32
+#define SCAN_SEEDS 20
+#ifndef BENCH_KEY_COUNT
+#define BENCH_KEY_COUNT 1000000
+#endif
+
+static void printStats(const char *pcTag, dmbDict *pDict)
+{
+    dmbDictStats stats;
+    dmbDictGetStats(pDict, &stats);
+    DMB_LOGD("%s: count %u, size %u, load factor %u%%, rehashing %d (%u/%u), expand %llu, shrink %llu, rehashed entries %llu\n",
+             pcTag, stats.count, stats.size, stats.loadFactor, stats.rehashing, stats.rehashDone, stats.rehashTotal,
+             stats.expandTimes, stats.shrinkTimes, stats.rehashedEntries);
+}
+
+static void testRehash()
+{
+    dmbDict *pDict = dmbDictCreate(&dmbDictMetaStr, 4);
+    dmbDictEntry *pEntrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * TEST_KEY_COUNT);
+    dmbCHAR buf[32];
+    dmbUINT i, uMiss = 0, uSize;
+    dmbLONG lBegin, lCost, lMaxPut = 0;
+
+    for (i=0; i<TEST_KEY_COUNT; ++i)
+    {
+        uSize = sizeof(buf);
+        dmbLong2Str(i, buf, &uSize);
+        pEntrys[i].k.val = dmbStringCreateWithBuffer(buf, uSize);
+        pEntrys[i].v.l = i;
+
+        lBegin = dmbLocalCurrentMillis();
+        dmbDictPut(pDict, &pEntrys[i]);
+        lCost = dmbLocalCurrentMillis() - lBegin;
+        if (lCost > lMaxPut)
+            lMaxPut = lCost;
+    }
+    printStats("after put", pDict);
+    DMB_LOGD("max put cost %ld ms\n", lMaxPut);
+
+    for (i=0; i<TEST_KEY_COUNT; ++i)
+    {
+        uSize = sizeof(buf);
+        dmbLong2Str(i, buf, &uSize);
+        if (dmbDictGetByData(pDict, buf, uSize) != &pEntrys[i])
+            ++uMiss;
+    }
+    DMB_LOGD("get miss %u\n", uMiss);
+
+    for (i=0; i<TEST_KEY_COUNT - 100; ++i)
+    {
+        uSize = sizeof(buf);
+        dmbLong2Str(i, buf, &uSize);
+        if (dmbDictPopByData(pDict, buf, uSize) != &pEntrys[i])
+            ++uMiss;
+    }
+    printStats("after pop", pDict);
+
+    DMB_LOGD("background rehash moved %u buckets\n", dmbDictRehashMilliseconds(pDict, 1));
+    printStats("after background rehash", pDict);
+    DMB_LOGD("pop miss %u\n", uMiss);
+
+    dmbDictDestroy(pDict);
+    for (i=0; i<TEST_KEY_COUNT; ++i)
+        dmbStringDestroy((dmbString*)pEntrys[i].k.val);
+    dmbFree(pEntrys);
+}
+
+static dmbString** createKeys(dmbUINT uCount, dmbUINT uOffset)
+{
+    dmbString **pKeys = (dmbString**)dmbMalloc(sizeof(dmbString*) * uCount);
+    dmbCHAR buf[64];
+    dmbUINT i;
+
+    if (pKeys == NULL)
+        return NULL;
+
+    for (i=0; i<uCount; ++i)
+    {
+        pKeys[i] = dmbStringCreateWithFormat(sizeof(buf), "key:%u:%08x", i + uOffset, (i + uOffset) * 2654435761U);
+        if (pKeys[i] == NULL)
+        {
+            while (i > 0)
+                dmbStringDestroy(pKeys[--i]);
+            dmbFree(pKeys);
+            return NULL;
+        }
+    }
+    return pKeys;
+}
+
+static void destroyKeys(dmbString **pKeys, dmbUINT uCount)
+{
+    dmbUINT i;
+
+    if (pKeys == NULL)
+        return;
+
+    for (i=0; i<uCount; ++i)
+        dmbStringDestroy(pKeys[i]);
+    dmbFree(pKeys);
+}
+
+static void testFlatDict()
+{
+    dmbFlatDict *pDict = dmbFlatDictCreate(&dmbDictMetaStr, 0);
+    dmbString **pKeys = createKeys(TEST_KEY_COUNT, 0);
+    dmbFlatDictEntry *pEntry, popped;
+    dmbFlatDictIter iter;
+    dmbBOOL existed;
+    dmbUINT i, uMiss = 0, uIter = 0;
+    const dmbCHAR *data; dmbUINT len;
+
+    for (i=0; i<TEST_KEY_COUNT; ++i)
+    {
+        pEntry = dmbFlatDictPut(pDict, pKeys[i], &existed);
+        if (pEntry == NULL || existed)
+            ++uMiss;
+        else
+            pEntry->v.l = i;
+    }
+
+    for (i=0; i<TEST_KEY_COUNT; i+=2)
+    {
+        dmbStringGetData(pKeys[i], &data, &len);
+        if (!dmbFlatDictPopByData(pDict, data, len, &popped) || popped.v.l != (dmbLONG)i)
+            ++uMiss;
+    }
+
+    for (i=0; i<TEST_KEY_COUNT; ++i)
+    {
+        pEntry = dmbFlatDictGet(pDict, pKeys[i]);
+        if ((i & 1) ? (pEntry == NULL || pEntry->v.l != (dmbLONG)i) : pEntry != NULL)
+            ++uMiss;
+    }
+
+    dmbFlatDictInitIter(pDict, &iter);
+    while (dmbFlatDictNext(&iter) != NULL)
+        ++uIter;
+
+    DMB_LOGD("flat dict: count %u, capacity %u, deleted %u, iter %u, miss %u\n",
+             dmbFlatDictSize(pDict), pDict->capacity, pDict->deleted, uIter, uMiss);
+
+    dmbFlatDictDestroy(pDict);
+    destroyKeys(pKeys, TEST_KEY_COUNT);
+}
+
+static void testGetMany()
+{
+    dmbDict *pDict = dmbDictCreate(&dmbDictMetaStr, 0);
+    dmbString **pKeys = createKeys(TEST_KEY_COUNT, 0);
+    dmbDictEntry *pEntrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * TEST_KEY_COUNT);
+    const void *keyData[BATCH_SIZE];
+    dmbSIZE keySizes[BATCH_SIZE];
+    dmbDictEntry *results[BATCH_SIZE];
+    dmbString *pMissKey = dmbStringCreateWithBuffer("missing", 7);
+    const dmbCHAR *data; dmbUINT len;
+    dmbUINT i, j, k, uFound, uMiss = 0, uRehashing = 0;
+
+    //grow while looking up so batches run against both tables
+    for (i=0; i+BATCH_SIZE<=TEST_KEY_COUNT; i+=BATCH_SIZE)
+    {
+        for (j=0; j<BATCH_SIZE; ++j)
+        {
+            pEntrys[i + j].k.val = pKeys[i + j];
+            dmbDictPut(pDict, &pEntrys[i + j]);
+        }
+
+        uRehashing += dmbDictIsRehashing(pDict);
+
+        //every 4th key is missing, the others are spread over what is inserted
+        for (j=0; j<BATCH_SIZE; ++j)
+        {
+            k = (dmbUINT)(((dmbUINT64)(i + j) * 2654435761U) % (i + BATCH_SIZE));
+            dmbStringGetData(j % 4 == 3 ? pMissKey : pKeys[k], &data, &len);
+            keyData[j] = data;
+            keySizes[j] = len;
+        }
+
+        uFound = dmbDictGetManyByData(pDict, keyData, keySizes, BATCH_SIZE, results);
+        uMiss += uFound != BATCH_SIZE / 4 * 3;
+        for (j=0; j<BATCH_SIZE; ++j)
+        {
+            k = (dmbUINT)(((dmbUINT64)(i + j) * 2654435761U) % (i + BATCH_SIZE));
+            uMiss += results[j] != (j % 4 == 3 ? NULL : &pEntrys[k]);
+        }
+    }
+
+    DMB_LOGD("get many: miss %u, rehashing batches %u\n", uMiss, uRehashing);
+
+    dmbStringDestroy(pMissKey);
+    dmbDictDestroy(pDict);
+    dmbFree(pEntrys);
+    destroyKeys(pKeys, TEST_KEY_COUNT);
+}
+
+typedef struct ScanState {
+    dmbUINT *pSeen;
+    dmbUINT uVisited;
+} ScanState;
+
+static void onScan(void *pPrivdata, dmbDictEntry *pEntry)
+{
+    ScanState *pState = (ScanState*)pPrivdata;
+
+    pState->uVisited++;
+    if (pEntry->v.l >= 0)
+        pState->pSeen[pEntry->v.l]++;
+}
+
+//the bucket layout, and with it where a resize catches the cursor, depends on the hash seed
+static dmbUINT testScan(dmbUINT64 seed)
+{
+    const dmbUINT uStable = TEST_KEY_COUNT / 10, uExtra = TEST_KEY_COUNT / 2;
+    dmbDict *pDict = dmbDictCreate(&dmbDictMetaStr, 0);
+    dmbString **pKeys = createKeys(uStable + uExtra, 0);
+    dmbDictEntry *pEntrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * (uStable + uExtra));
+    ScanState state;
+    dmbUINT64 cursor = 0;
+    dmbUINT i, uCalls = 0, uPut = 0, uPop = 0, uLost = 0, uDup = 0, uResizeCalls = 0;
+
+    dmbHashSetSeed(seed);
+    state.pSeen = (dmbUINT*)dmbMalloc(sizeof(dmbUINT) * uStable);
+    dmbMemSet(state.pSeen, 0, sizeof(dmbUINT) * uStable);
+    state.uVisited = 0;
+
+    for (i=0; i<uStable + uExtra; ++i)
+    {
+        pEntrys[i].k.val = pKeys[i];
+        pEntrys[i].v.l = i < uStable ? (dmbLONG)i : -1;
+    }
+    for (i=0; i<uStable; ++i)
+        dmbDictPut(pDict, &pEntrys[i]);
+
+    //grow with the extra keys during the first part of the scan, then shrink back
+    do
+    {
+        cursor = dmbDictScan(pDict, cursor, onScan, &state);
+        uCalls++;
+
+        for (i=0; i<16; ++i)
+        {
+            if (uPut < uExtra)
+                dmbDictPut(pDict, &pEntrys[uStable + uPut++]);
+            else if (uPop < uExtra)
+                dmbDictPop(pDict, pKeys[uStable + uPop++]);
+        }
+        uResizeCalls += dmbDictIsRehashing(pDict);
+    } while (cursor != 0);
+
+    for (i=0; i<uStable; ++i)
+    {
+        uLost += state.pSeen[i] == 0;
+        uDup += state.pSeen[i] > 1;
+    }
+
+    DMB_LOGD("scan seed %llu: %u calls (%u while rehashing), visited %u, stable %u, lost %u, duplicated %u, expand %llu, shrink %llu\n",
+             (unsigned long long)seed, uCalls, uResizeCalls, state.uVisited, uStable, uLost, uDup,
+             pDict->expandTimes, pDict->shrinkTimes);
+    //a duplicate is allowed when a shrink merges buckets, a lost key never
+    if (uLost != 0)
+        DMB_LOGE("scan seed %llu FAILED: %u keys present for the whole scan were never returned\n",
+                 (unsigned long long)seed, uLost);
+
+    dmbDictDestroy(pDict);
+    dmbFree(pEntrys);
+    dmbFree(state.pSeen);
+    destroyKeys(pKeys, uStable + uExtra);
+
+    return uLost;
+}
+
+static void benchDict(dmbUINT uCount)
+{
+    dmbString **pKeys = createKeys(uCount, 0), **pMissKeys = createKeys(uCount, uCount);
+    dmbDictEntry *pEntrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * uCount);
+    dmbDict *pDict = dmbDictCreate(&dmbDictMetaStr, 0);
+    dmbFlatDict *pFlatDict = dmbFlatDictCreate(&dmbDictMetaStr, 0);
+    dmbUINT i, uFound = 0;
+    dmbLONG lPut, lHit, lMiss;
+
+    lPut = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+    {
+        pEntrys[i].k.val = pKeys[i];
+        dmbDictPut(pDict, &pEntrys[i]);
+    }
+    lPut = dmbLocalCurrentMillis() - lPut;
+
+    lHit = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+        uFound += dmbDictGet(pDict, pKeys[i]) != NULL;
+    lHit = dmbLocalCurrentMillis() - lHit;
+
+    lMiss = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+        uFound += dmbDictGet(pDict, pMissKeys[i]) != NULL;
+    lMiss = dmbLocalCurrentMillis() - lMiss;
+
+    DMB_LOGD("chained dict %u keys: put %ld ms, hit %ld ms, miss %ld ms, found %u\n", uCount, lPut, lHit, lMiss, uFound);
+
+    uFound = 0;
+    lPut = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+        dmbFlatDictPut(pFlatDict, pKeys[i], NULL);
+    lPut = dmbLocalCurrentMillis() - lPut;
+
+    lHit = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+        uFound += dmbFlatDictGet(pFlatDict, pKeys[i]) != NULL;
+    lHit = dmbLocalCurrentMillis() - lHit;
+
+    lMiss = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+        uFound += dmbFlatDictGet(pFlatDict, pMissKeys[i]) != NULL;
+    lMiss = dmbLocalCurrentMillis() - lMiss;
+
+    DMB_LOGD("flat dict    %u keys: put %ld ms, hit %ld ms, miss %ld ms, found %u\n", uCount, lPut, lHit, lMiss, uFound);
+
+    dmbDictDestroy(pDict);
+    dmbFlatDictDestroy(pFlatDict);
+    dmbFree(pEntrys);
+    destroyKeys(pKeys, uCount);
+    destroyKeys(pMissKeys, uCount);
+}
+
+static void benchGetMany(dmbUINT uCount)
+{
+    dmbString **pKeys = createKeys(uCount, 0);
+    dmbDictEntry *pEntrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * uCount);
+    dmbUINT *pOrder = (dmbUINT*)dmbMalloc(sizeof(dmbUINT) * uCount);
+    dmbDict *pDict = dmbDictCreate(&dmbDictMetaStr, uCount);
+    const void *keyData[BATCH_SIZE];
+    dmbSIZE keySizes[BATCH_SIZE];
+    dmbDictEntry *results[BATCH_SIZE];
+    const dmbCHAR *data; dmbUINT len;
+    dmbUINT i, j, uSingle = 0, uMany = 0;
+    dmbUINT64 seed = 88172645463325252ULL;
+    dmbLONG lSingle, lMany;
+
+    if (pKeys == NULL || pEntrys == NULL || pOrder == NULL || pDict == NULL)
+    {
+        DMB_LOGE("%u keys don't fit max_mem_size (%zu bytes in use), skip the batch benchmark\n",
+                 uCount, dmbGetUsedMemSize());
+        if (pDict != NULL)
+            dmbDictDestroy(pDict);
+        dmbFree(pEntrys);
+        dmbFree(pOrder);
+        destroyKeys(pKeys, uCount);
+        return;
+    }
+
+    for (i=0; i<uCount; ++i)
+    {
+        pEntrys[i].k.val = pKeys[i];
+        dmbDictPut(pDict, &pEntrys[i]);
+        pOrder[i] = i;
+    }
+
+    //random access, like real keyspace traffic
+    for (i=uCount-1; i>0; --i)
+    {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        j = (dmbUINT)(seed % (i + 1));
+        len = pOrder[i]; pOrder[i] = pOrder[j]; pOrder[j] = len;
+    }
+
+    lSingle = dmbLocalCurrentMillis();
+    for (i=0; i+BATCH_SIZE<=uCount; i+=BATCH_SIZE)
+    {
+        for (j=0; j<BATCH_SIZE; ++j)
+        {
+            dmbStringGetData(pKeys[pOrder[i + j]], &data, &len);
+            uSingle += dmbDictGetByData(pDict, data, len) != NULL;
+        }
+    }
+    lSingle = dmbLocalCurrentMillis() - lSingle;
+
+    lMany = dmbLocalCurrentMillis();
+    for (i=0; i+BATCH_SIZE<=uCount; i+=BATCH_SIZE)
+    {
+        for (j=0; j<BATCH_SIZE; ++j)
+        {
+            dmbStringGetData(pKeys[pOrder[i + j]], &data, &len);
+            keyData[j] = data;
+            keySizes[j] = len;
+        }
+        uMany += dmbDictGetManyByData(pDict, keyData, keySizes, BATCH_SIZE, results);
+    }
+    lMany = dmbLocalCurrentMillis() - lMany;
+
+    DMB_LOGD("%u keys, batch %u: single %.1f ns/key, many %.1f ns/key, found %u/%u\n",
+             uCount, BATCH_SIZE, lSingle * 1000000.0 / uCount, lMany * 1000000.0 / uCount, uSingle, uMany);
+
+    dmbDictDestroy(pDict);
+    dmbFree(pEntrys);
+    dmbFree(pOrder);
+    destroyKeys(pKeys, uCount);
+}
+
+void dmbdict_test()
+{
+    dmbUINT i, uFailed;
+
+    testRehash();
+    testFlatDict();
+    testGetMany();
+    for (i=1, uFailed=0; i<=SCAN_SEEDS; ++i)
+        uFailed += testScan(i) != 0;
+    if (uFailed != 0)
+        DMB_LOGE("scan lost keys with %u of %u hash seeds\n", uFailed, SCAN_SEEDS);
+    benchDict(BENCH_KEY_COUNT);
+    benchGetMany(BATCH_KEY_COUNT);
+}
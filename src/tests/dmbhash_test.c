@@ -0,0 +1,183 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbhash_test.h"
+#include "core/dmbhash.h"
+#include "core/dmbdict.h"
+#include "core/dmbdictmetas.h"
+#include "core/dmballoc.h"
+#include "utils/dmbtime.h"
+#include "utils/dmblog.h"
+#include <stdlib.h>
+
+#define HASH_BENCH_BYTES (256 * 1024 * 1024)
+#define LOOKUP_KEY_COUNT 200000
+#define LOOKUP_ROUNDS 5
+
+static const dmbUINT KEY_LENS[] = {4, 8, 16, 32, 64, 128, 1024};
+//lookup keys need room for the decimal index to stay unique
+static const dmbUINT LOOKUP_KEY_LENS[] = {8, 16, 32, 64, 128, 1024};
+
+//the byte at a time hash used before dmbHash, kept here for comparison
+static dmbUINT64 djbHash(const void *pKey, dmbSIZE len)
+{
+    dmbUINT hash = 5381;
+    dmbSIZE i;
+    dmbCHAR *key = (dmbCHAR*)pKey;
+
+    for (i = 0; i < len; i++)
+    {
+        hash += (hash << 5) + key[i];
+    }
+    return hash;
+}
+
+static dmbUINT64 djbStringHash(const void *pKey)
+{
+    const dmbCHAR *data; dmbUINT len;
+    dmbStringGetData((const dmbString*)pKey, &data, &len);
+    return djbHash(data, len);
+}
+
+static dmbDictMeta g_djb_meta = {
+    djbStringHash,
+    dmbStringKeyCompare,
+    dmbStringDumpKey,
+    djbHash,
+    dmbStringDumpKeyCompare
+};
+
+static void fillKey(dmbCHAR *pcBuf, dmbUINT uLen, dmbUINT uIndex)
+{
+    dmbUINT i;
+    for (i=0; i<uLen; ++i)
+        pcBuf[i] = 'a' + (i % 26);
+    //put the distinct part at the end, the worst case for prefix heavy keys
+    for (i=0; i<uLen && uIndex != 0; ++i, uIndex /= 10)
+        pcBuf[uLen - 1 - i] = '0' + uIndex % 10;
+}
+
+static void benchThroughput(dmbUINT uLen)
+{
+    dmbCHAR buf[1024];
+    dmbUINT64 sum = 0, i, count = HASH_BENCH_BYTES / uLen;
+    dmbLONG lOld, lNew;
+
+    fillKey(buf, uLen, 12345);
+
+    lOld = dmbLocalCurrentMillis();
+    for (i=0; i<count; ++i)
+    {
+        buf[0] = (dmbCHAR)i;
+        sum += djbHash(buf, uLen);
+    }
+    lOld = dmbLocalCurrentMillis() - lOld;
+
+    lNew = dmbLocalCurrentMillis();
+    for (i=0; i<count; ++i)
+    {
+        buf[0] = (dmbCHAR)i;
+        sum += dmbHash(buf, uLen);
+    }
+    lNew = dmbLocalCurrentMillis() - lNew;
+
+    DMB_LOGD("hash %4u bytes: djb %6.0f MB/s, dmbHash %6.0f MB/s (%llx)\n", uLen,
+             lOld == 0 ? 0.0 : HASH_BENCH_BYTES / 1048.576 / lOld,
+             lNew == 0 ? 0.0 : HASH_BENCH_BYTES / 1048.576 / lNew, sum & 0xF);
+}
+
+static dmbLONG lookup(dmbDictMeta *pMeta, dmbString **pKeys, dmbUINT *pOrder, dmbUINT uCount)
+{
+    dmbDict *pDict = dmbDictCreate(pMeta, uCount);
+    dmbDictEntry *pEntrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * uCount);
+    const dmbCHAR *data; dmbUINT len;
+    dmbUINT i, j, r, uMiss = 0;
+    dmbLONG lCost;
+
+    for (i=0; i<uCount; ++i)
+    {
+        pEntrys[i].k.val = pKeys[i];
+        dmbDictPut(pDict, &pEntrys[i]);
+    }
+
+    lCost = dmbLocalCurrentMillis();
+    for (r=0; r<LOOKUP_ROUNDS; ++r)
+    {
+        for (i=0; i<uCount; ++i)
+        {
+            j = pOrder[i];
+            dmbStringGetData(pKeys[j], &data, &len);
+            uMiss += dmbDictGetByData(pDict, data, len) != &pEntrys[j];
+        }
+    }
+    lCost = dmbLocalCurrentMillis() - lCost;
+
+    if (uMiss != 0)
+        DMB_LOGE("lookup miss %u\n", uMiss);
+
+    dmbDictDestroy(pDict);
+    dmbFree(pEntrys);
+
+    return lCost;
+}
+
+static void benchLookup(dmbUINT uLen)
+{
+    dmbString **pKeys = (dmbString**)dmbMalloc(sizeof(dmbString*) * LOOKUP_KEY_COUNT);
+    dmbUINT *pOrder = (dmbUINT*)dmbMalloc(sizeof(dmbUINT) * LOOKUP_KEY_COUNT);
+    dmbCHAR buf[1024];
+    dmbUINT i, j, t;
+    dmbLONG lOld, lNew;
+    const double ops = (double)LOOKUP_KEY_COUNT * LOOKUP_ROUNDS / 1000000.0;
+
+    for (i=0; i<LOOKUP_KEY_COUNT; ++i)
+    {
+        fillKey(buf, uLen, i);
+        pKeys[i] = dmbStringCreateWithBuffer(buf, uLen);
+        pOrder[i] = i;
+    }
+
+    //random order, otherwise djb puts sequential keys in adjacent buckets
+    //and the lookup loop gets a cache locality that real traffic never has
+    srandom(1);
+    for (i=LOOKUP_KEY_COUNT-1; i>0; --i)
+    {
+        j = random() % (i + 1);
+        t = pOrder[i]; pOrder[i] = pOrder[j]; pOrder[j] = t;
+    }
+
+    lOld = lookup(&g_djb_meta, pKeys, pOrder, LOOKUP_KEY_COUNT);
+    lNew = lookup(&dmbDictMetaStr, pKeys, pOrder, LOOKUP_KEY_COUNT);
+
+    DMB_LOGD("lookup %4u bytes: djb %5.0f ns/op, dmbHash %5.0f ns/op\n", uLen, lOld / ops, lNew / ops);
+
+    for (i=0; i<LOOKUP_KEY_COUNT; ++i)
+        dmbStringDestroy(pKeys[i]);
+    dmbFree(pKeys);
+    dmbFree(pOrder);
+}
+
+void dmbhash_test()
+{
+    dmbUINT i;
+
+    for (i=0; i<sizeof(KEY_LENS)/sizeof(KEY_LENS[0]); ++i)
+        benchThroughput(KEY_LENS[i]);
+
+    for (i=0; i<sizeof(LOOKUP_KEY_LENS)/sizeof(LOOKUP_KEY_LENS[0]); ++i)
+        benchLookup(LOOKUP_KEY_LENS[i]);
+}
@@ -0,0 +1,187 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbmap_test.h"
+#include "base/dmbmap.h"
+#include "base/dmbobject.h"
+#include "base/dmbsettings.h"
+#include "core/dmballoc.h"
+#include "utils/dmblog.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_OP_COUNT 100000
+#define TEST_VALUE_MAX 24
+//keys of the memory comparison
+#define MEM_KEY_COUNT 2000
+
+typedef struct RefField {
+    dmbCHAR name[16];
+    dmbUINT len;
+    dmbCHAR value[TEST_VALUE_MAX];
+    dmbUINT valueLen;
+    dmbBOOL exist;
+} RefField;
+
+typedef struct ScanData {
+    RefField *refs;
+    dmbUINT count;
+    dmbUINT bad;
+} ScanData;
+
+static dmbCode checkScan(void *pData, const dmbCHAR *pcField, dmbUINT uFieldLen, const dmbCHAR *pcValue, dmbUINT uValueLen)
+{
+    ScanData *pScan = (ScanData*)pData;
+    RefField *pRef;
+    dmbCHAR buf[16];
+    dmbUINT k;
+
+    //the fields are "f<index>" and not terminated
+    dmbMemCopy(buf, pcField, uFieldLen < sizeof(buf) ? uFieldLen : sizeof(buf) - 1);
+    buf[uFieldLen < sizeof(buf) ? uFieldLen : sizeof(buf) - 1] = '\0';
+    k = (dmbUINT)strtoul(buf + 1, NULL, 10);
+    pRef = &pScan->refs[k];
+    if (!pRef->exist || pRef->len != uFieldLen || pRef->valueLen != uValueLen || dmbMemCmp(pRef->value, pcValue, uValueLen) != 0)
+        pScan->bad++;
+    pScan->count++;
+
+    return DMB_ERRCODE_OK;
+}
+
+//uFields decides if the map stays in the binlist encoding, empty values force the dict
+static void testMap(dmbUINT uFields, dmbBOOL bEmptyValue)
+{
+    dmbObject *pObj = dmbCreateMapObject();
+    dmbMap *pMap = (dmbMap*)pObj->ptr;
+    RefField *pRefs = (RefField*)dmbMalloc(sizeof(RefField) * uFields);
+    ScanData scan;
+    const dmbCHAR *pcValue;
+    dmbUINT uValueLen;
+    dmbBOOL added;
+    dmbUINT i, j, k, uCount = 0, uBad = 0;
+
+    srandom(5);
+    for (i=0; i<uFields; ++i)
+    {
+        pRefs[i].len = snprintf(pRefs[i].name, sizeof(pRefs[i].name), "f%u", i);
+        pRefs[i].exist = FALSE;
+    }
+
+    for (i=0; i<TEST_OP_COUNT; ++i)
+    {
+        k = random() % uFields;
+        if (random() % 4 == 0)
+        {
+            uBad += dmbMapRemove(pMap, pRefs[k].name, pRefs[k].len) != pRefs[k].exist;
+            pRefs[k].exist = FALSE;
+        }
+        else
+        {
+            pRefs[k].valueLen = random() % (TEST_VALUE_MAX - 1) + (bEmptyValue ? 0 : 1);
+            for (j=0; j<pRefs[k].valueLen; ++j)
+                pRefs[k].value[j] = 'a' + random() % 26;
+
+            dmbMapSet(pMap, pRefs[k].name, pRefs[k].len, pRefs[k].value, pRefs[k].valueLen, &added);
+            uBad += added == pRefs[k].exist;
+            pRefs[k].exist = TRUE;
+        }
+    }
+
+    for (i=0; i<uFields; ++i)
+    {
+        if (!pRefs[i].exist)
+        {
+            uBad += dmbMapGet(pMap, pRefs[i].name, pRefs[i].len, &pcValue, &uValueLen) != DMB_ERRCODE_MAPFIELD_NOT_EXIST;
+            continue;
+        }
+
+        ++uCount;
+        if (dmbMapGet(pMap, pRefs[i].name, pRefs[i].len, &pcValue, &uValueLen) != DMB_ERRCODE_OK
+                || uValueLen != pRefs[i].valueLen || dmbMemCmp(pcValue, pRefs[i].value, uValueLen) != 0)
+            ++uBad;
+    }
+    uBad += dmbMapSize(pMap) != uCount;
+
+    scan.refs = pRefs;
+    scan.count = 0;
+    scan.bad = 0;
+    dmbMapScan(pMap, checkScan, &scan);
+    uBad += scan.bad + (scan.count != uCount);
+
+    DMB_LOGD("map: %u fields, encode %s, bad %u\n", uCount,
+             dmbObjectEncoding(pObj) == DMB_OBJ_ENCODE_BINLIST ? "binlist" : "dict", uBad);
+
+    dmbObjectRelease(pObj);
+    dmbFree(pRefs);
+}
+
+//bytes per key with uFields fields in each encoding
+static void memMap(dmbUINT uFields)
+{
+    dmbMap **ppMaps = (dmbMap**)dmbMalloc(sizeof(dmbMap*) * MEM_KEY_COUNT);
+    dmbUINT uEntries = g_settings.map_max_binlist_entries;
+    dmbCHAR field[32], value[32];
+    dmbUINT i, k, uFieldLen, uValueLen, pass;
+    size_t used[2];
+
+    for (pass=0; pass<2; ++pass)
+    {
+        //the second pass converts every map on its first set
+        g_settings.map_max_binlist_entries = pass == 0 ? uFields : 0;
+        used[pass] = dmbGetUsedMemSize();
+        for (i=0; i<MEM_KEY_COUNT; ++i)
+        {
+            ppMaps[i] = dmbMapCreate();
+            for (k=0; k<uFields; ++k)
+            {
+                uFieldLen = snprintf(field, sizeof(field), "field:%u", k);
+                uValueLen = snprintf(value, sizeof(value), "%u", i * k);
+                dmbMapSet(ppMaps[i], field, uFieldLen, value, uValueLen, NULL);
+            }
+        }
+        used[pass] = dmbGetUsedMemSize() - used[pass];
+
+        for (i=0; i<MEM_KEY_COUNT; ++i)
+            dmbMapDestroy(ppMaps[i]);
+    }
+    g_settings.map_max_binlist_entries = uEntries;
+
+    DMB_LOGD("map %3u fields: binlist %6zu bytes/key, dict %6zu bytes/key, saved %6zu bytes/key (%.1fx)\n",
+             uFields, used[0] / MEM_KEY_COUNT, used[1] / MEM_KEY_COUNT, (used[1] - used[0]) / MEM_KEY_COUNT,
+             (double)used[1] / used[0]);
+
+    dmbFree(ppMaps);
+}
+
+void dmbmap_test()
+{
+    dmbUINT uCount;
+    dmbUINT uEntries = g_settings.map_max_binlist_entries, uValue = g_settings.map_max_binlist_value;
+
+    g_settings.map_max_binlist_entries = 128;
+    g_settings.map_max_binlist_value = 64;
+
+    testMap(100, FALSE);
+    testMap(100, TRUE);
+    testMap(5000, FALSE);
+
+    for (uCount = 8; uCount <= 128; uCount *= 2)
+        memMap(uCount);
+
+    g_settings.map_max_binlist_entries = uEntries;
+    g_settings.map_max_binlist_value = uValue;
+}
@@ -0,0 +1,464 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbobject_test.h"
+#include "base/dmbobject.h"
+#include "base/dmbdllist.h"
+#include "base/dmbzset.h"
+#include "core/dmbstring.h"
+#include "core/dmbdict.h"
+#include "core/dmbdictmetas.h"
+#include "core/dmballoc.h"
+#include "utils/dmblog.h"
+#include "utils/dmbtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define BENCH_KEYS 1000000
+#define BENCH_GETS 2000000
+#define BENCH_COUNTERS 100000
+#define BENCH_INCRS 2000000
+#define BENCH_LIST_VALUES 1000
+#define BENCH_LIST_RANGES 20000
+#define BENCH_ZSET_MEMBERS 1000
+#define BENCH_ZSET_OPS 2000000
+#define REF_THREADS 4
+#define REF_ROUNDS 1000000
+
+//the layout dmbCreateStringObject used for every length before EMBSTR
+static dmbObject* createRawStringObject(dmbCHAR *pcStr, dmbUINT uLen)
+{
+    dmbObject *o = (dmbObject*)dmbMalloc(sizeof(dmbObject));
+    o->ptr = dmbStringCreateWithBuffer(pcStr, uLen);
+    o->type = DMB_OBJ_TYPE_STRING;
+    o->encode = DMB_OBJ_ENCODE_STRING;
+    o->published = FALSE;
+    o->ref = 1;
+    return o;
+}
+
+static void testStringEncoding()
+{
+    dmbCHAR value[DMB_OBJ_EMBSTR_MAX * 4];
+    dmbObject *pObj, *pRaw;
+    dmbString *pStr;
+    dmbUINT i, uLen, uBad = 0, uEmbedded = 0;
+
+    for (i=0; i<sizeof(value); ++i)
+        value[i] = 'a' + i % 26;
+
+    for (uLen=0; uLen<sizeof(value); ++uLen)
+    {
+        pObj = dmbCreateStringObject(value, uLen);
+        pRaw = createRawStringObject(value, uLen);
+        pStr = (dmbString*)pObj->ptr;
+
+        uBad += pObj->type != DMB_OBJ_TYPE_STRING;
+        uBad += dmbObjectEncoding(pObj) != (uLen <= DMB_OBJ_EMBSTR_MAX ? DMB_OBJ_ENCODE_EMBSTR : DMB_OBJ_ENCODE_STRING);
+        uBad += dmbStringLength(pStr) != uLen || dmbMemCmp(dmbStringGet(pStr), value, uLen) != 0;
+        //the dict metas only see the dmbString behind ptr
+        uBad += dmbDictMetaStrObj.hashFunc(pObj) != dmbDictMetaStrObj.hashFunc(pRaw);
+        uBad += dmbDictMetaStrObj.keyCompare(pObj, pRaw) != 0;
+        uEmbedded += dmbObjectEncoding(pObj) == DMB_OBJ_ENCODE_EMBSTR;
+
+        dmbObjectRetain(pObj);
+        uBad += dmbObjectRelease(pObj);
+        uBad += !dmbObjectRelease(pObj);
+        dmbObjectRelease(pRaw);
+    }
+
+    DMB_LOGD("string objects: %u of %u embedded, bad %u\n", uEmbedded, (dmbUINT)sizeof(value), uBad);
+}
+
+static dmbUINT checkValue(dmbObject *pObj, const dmbCHAR *pcValue, dmbUINT uLen)
+{
+    dmbCHAR buf[DMB_OBJ_INT_STR_SIZE];
+    const dmbCHAR *pcData;
+    dmbUINT uDataLen;
+
+    dmbStringObjectGetData(pObj, buf, &pcData, &uDataLen);
+    return pObj->type != DMB_OBJ_TYPE_STRING || uDataLen != uLen || dmbMemCmp(pcData, pcValue, uLen) != 0;
+}
+
+static void testIntEncoding()
+{
+    //value, INT encoded, shared
+    static const struct { const dmbCHAR *value; dmbBOOL isInt; dmbBOOL isShared; } cases[] = {
+        {"0", TRUE, TRUE}, {"9999", TRUE, TRUE}, {"10000", TRUE, FALSE}, {"-1", TRUE, FALSE},
+        {"9223372036854775807", TRUE, FALSE}, {"-9223372036854775807", TRUE, FALSE},
+        {"-9223372036854775808", FALSE, FALSE}, {"9223372036854775808", FALSE, FALSE},
+        {"007", FALSE, FALSE}, {"+5", FALSE, FALSE}, {" 5", FALSE, FALSE}, {"5 ", FALSE, FALSE},
+        {"-0", FALSE, FALSE}, {"12a", FALSE, FALSE}, {"", FALSE, FALSE}, {"counter", FALSE, FALSE}
+    };
+    dmbCHAR value[DMB_OBJ_INT_STR_SIZE];
+    dmbObject *pObj, *pOther;
+    dmbUINT i, uLen, uBad = 0;
+    dmbLONG lModel;
+
+    for (i=0; i<sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        uLen = strlen(cases[i].value);
+        pObj = dmbCreateStringValueObject((dmbCHAR*)cases[i].value, uLen);
+        uBad += (pObj->encode == DMB_OBJ_ENCODE_INT) != cases[i].isInt;
+        uBad += dmbObjectIsShared(pObj) != cases[i].isShared;
+        uBad += checkValue(pObj, cases[i].value, uLen);
+        //a shared object survives any number of releases
+        dmbObjectRetain(pObj);
+        uBad += dmbObjectRelease(pObj);
+        if (dmbObjectIsShared(pObj))
+            uBad += dmbObjectRelease(pObj) || pObj->ref != DMB_OBJ_REF_SHARED;
+        else
+            uBad += !dmbObjectRelease(pObj);
+    }
+
+    //string and INT encoded counters against a plain number
+    pObj = dmbCreateStringObject("9990", 4);
+    lModel = 9990;
+    srandom(11);
+    for (i=0; i<100000; ++i)
+    {
+        dmbLONG lDelta = i < 20 ? 1 : random() % 40001 - 20000;
+
+        //sometimes another reference keeps the old value alive
+        pOther = i % 7 == 0 ? pObj : NULL;
+        if (pOther != NULL)
+            dmbObjectRetain(pOther);
+
+        uBad += dmbStringObjectIncrBy(&pObj, lDelta) != DMB_ERRCODE_OK;
+        lModel += lDelta;
+        uLen = snprintf(value, sizeof(value), "%ld", lModel);
+        uBad += checkValue(pObj, value, uLen);
+        uBad += dmbObjectIsShared(pObj) != (lModel >= 0 && lModel < DMB_OBJ_SHARED_INTEGERS);
+
+        if (pOther != NULL)
+        {
+            uBad += pOther == pObj && !dmbObjectIsShared(pObj);
+            dmbObjectRelease(pOther);
+        }
+    }
+    dmbObjectRelease(pObj);
+
+    pObj = dmbCreateStringIntObject(LONG_MAX - 1);
+    uBad += dmbStringObjectIncrBy(&pObj, 1) != DMB_ERRCODE_OK || pObj->num != LONG_MAX;
+    uBad += dmbStringObjectIncrBy(&pObj, 1) != DMB_ERRCODE_STRING_INCR_OVERFLOW || pObj->num != LONG_MAX;
+    uBad += dmbStringObjectIncrBy(&pObj, LONG_MIN) != DMB_ERRCODE_OK || pObj->num != -1;
+    uBad += dmbStringObjectIncrBy(&pObj, -LONG_MAX) != DMB_ERRCODE_STRING_INCR_OVERFLOW || pObj->num != -1;
+    dmbObjectRelease(pObj);
+
+    pObj = dmbCreateStringObject("counter", 7);
+    uBad += dmbStringObjectIncrBy(&pObj, 1) != DMB_ERRCODE_CONVERT_TYPE_ERROR;
+    dmbObjectRelease(pObj);
+
+    DMB_LOGD("integer strings: bad %u\n", uBad);
+}
+
+//INCR by parsing the string and creating a new string object, as without the INT encoding
+static dmbCode incrString(dmbObject **ppObj, dmbLONG lDelta)
+{
+    dmbString *pStr = (dmbString*)(*ppObj)->ptr;
+    dmbCHAR buf[DMB_OBJ_INT_STR_SIZE];
+    dmbUINT uLen;
+    dmbLONG lValue;
+
+    dmbMemCopy(buf, dmbStringGet(pStr), dmbStringLength(pStr));
+    buf[dmbStringLength(pStr)] = '\0';
+    if (dmbString2Long(buf, &lValue) != DMB_ERRCODE_OK)
+        return DMB_ERRCODE_CONVERT_TYPE_ERROR;
+
+    uLen = sizeof(buf);
+    dmbLong2Str(lValue + lDelta, buf, &uLen);
+    dmbObjectRelease(*ppObj);
+    *ppObj = dmbCreateStringObject(buf, uLen);
+    return DMB_ERRCODE_OK;
+}
+
+static void benchCounters()
+{
+    dmbObject **pCounters = (dmbObject**)dmbMalloc(sizeof(dmbObject*) * BENCH_COUNTERS);
+    dmbCHAR value[DMB_OBJ_INT_STR_SIZE];
+    dmbUINT i, uLen, uPos, uAllocated = 0;
+    dmbLONG lStart, lNanos[2];
+
+    //small counters, as most of them are
+    srandom(13);
+    for (i=0; i<BENCH_COUNTERS; ++i)
+    {
+        uLen = snprintf(value, sizeof(value), "%ld", random() % 5000);
+        pCounters[i] = dmbCreateStringObject(value, uLen);
+    }
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_INCRS; ++i)
+    {
+        uPos = random() % BENCH_COUNTERS;
+        incrString(&pCounters[uPos], 1);
+    }
+    lNanos[0] = dmbMonotonicNanos() - lStart;
+    for (i=0; i<BENCH_COUNTERS; ++i)
+        dmbObjectRelease(pCounters[i]);
+
+    srandom(13);
+    for (i=0; i<BENCH_COUNTERS; ++i)
+    {
+        uLen = snprintf(value, sizeof(value), "%ld", random() % 5000);
+        pCounters[i] = dmbCreateStringValueObject(value, uLen);
+        uAllocated += !dmbObjectIsShared(pCounters[i]);
+    }
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_INCRS; ++i)
+    {
+        uPos = random() % BENCH_COUNTERS;
+        dmbStringObjectIncrBy(&pCounters[uPos], 1);
+    }
+    lNanos[1] = dmbMonotonicNanos() - lStart;
+    for (i=0; i<BENCH_COUNTERS; ++i)
+        dmbObjectRelease(pCounters[i]);
+
+    DMB_LOGD("%u counters below 5000: %u allocated objects instead of %u\n", BENCH_COUNTERS, uAllocated, BENCH_COUNTERS);
+    DMB_LOGD("INCR: new string object %.0f ns, INT encoding %.0f ns\n",
+             (double)lNanos[0] / BENCH_INCRS, (double)lNanos[1] / BENCH_INCRS);
+
+    dmbFree(pCounters);
+}
+
+static void* retainReleaseLoop(void *pArg)
+{
+    dmbObject *pObj = (dmbObject*)pArg;
+    dmbUINT i;
+
+    for (i=0; i<REF_ROUNDS; ++i)
+    {
+        dmbObjectRetain(pObj);
+        dmbObjectRelease(pObj);
+    }
+    return NULL;
+}
+
+//a published object is counted correctly by several threads at once
+static void testPublish()
+{
+    dmbObject *pObj = dmbCreateStringObject("published", 9);
+    pthread_t threads[REF_THREADS];
+    dmbUINT i, uBad = 0;
+
+    uBad += pObj->published;
+    dmbObjectRetain(pObj);
+    uBad += pObj->ref != 2;
+    dmbObjectRelease(pObj);
+
+    dmbObjectPublish(pObj);
+    uBad += !pObj->published || pObj->ref != 1;
+    for (i=0; i<REF_THREADS; ++i)
+        pthread_create(&threads[i], NULL, retainReleaseLoop, pObj);
+    for (i=0; i<REF_THREADS; ++i)
+        pthread_join(threads[i], NULL);
+
+    uBad += pObj->ref != 1 || pObj->type != DMB_OBJ_TYPE_STRING || dmbObjectEncoding(pObj) != DMB_OBJ_ENCODE_EMBSTR;
+    uBad += !dmbObjectRelease(pObj);
+
+    DMB_LOGD("published objects: %u threads, bad %u\n", REF_THREADS, uBad);
+}
+
+//LRANGE of 100 values from an object list: GetRange, read every value, drop the copy
+static dmbLONG benchListRanges(dmbBOOL bPublish)
+{
+    dmbDLList *pList = dmbDLListCreate(), *pRange;
+    dmbDLListIter iter;
+    dmbObject *pObj;
+    dmbCHAR value[32];
+    dmbUINT i, uLen, uStart, uSum = 0;
+    dmbLONG lStart;
+
+    for (i=0; i<BENCH_LIST_VALUES; ++i)
+    {
+        uLen = snprintf(value, sizeof(value), "value:%u", i);
+        pObj = dmbCreateStringObject(value, uLen);
+        if (bPublish)
+            dmbObjectPublish(pObj);
+        dmbDLListPushBack(pList, pObj);
+        dmbObjectRelease(pObj);
+    }
+
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_LIST_RANGES; ++i)
+    {
+        uStart = i % (BENCH_LIST_VALUES / 10);
+        pRange = dmbDLListCreate();
+        dmbDLListGetRange(pList, uStart, uStart + 99, pRange);
+        dmbDLListInitIter(pRange, &iter, FALSE);
+        while (dmbDLListNext(&iter))
+        {
+            pObj = dmbDLListGetRef(&iter);
+            uSum += dmbStringLength((dmbString*)pObj->ptr);
+            dmbObjectRelease(pObj);
+        }
+        dmbDLListDestroy(pRange);
+    }
+    lStart = dmbMonotonicNanos() - lStart;
+
+    dmbDLListDestroy(pList);
+    DMB_UNUSED(uSum);
+    return lStart;
+}
+
+//ZSCORE as a command runs it: hold a reference to the key's value for the duration
+static dmbLONG benchZsetScores(dmbBOOL bPublish)
+{
+    dmbObject *pObj = dmbCreateZsetObject();
+    dmbZset *pZset = (dmbZset*)pObj->ptr;
+    dmbCHAR member[32];
+    dmbUINT i, uLen;
+    dmbLONG lStart;
+    double score, sum = 0;
+
+    if (bPublish)
+        dmbObjectPublish(pObj);
+    for (i=0; i<BENCH_ZSET_MEMBERS; ++i)
+    {
+        uLen = snprintf(member, sizeof(member), "member:%u", i);
+        dmbZsetAdd(pZset, member, uLen, i, NULL);
+    }
+
+    srandom(17);
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_ZSET_OPS; ++i)
+    {
+        uLen = snprintf(member, sizeof(member), "member:%u", (dmbUINT)(random() % BENCH_ZSET_MEMBERS));
+        dmbObjectRetain(pObj);
+        if (dmbZsetScore((dmbZset*)pObj->ptr, member, uLen, &score) == DMB_ERRCODE_OK)
+            sum += score;
+        dmbObjectRelease(pObj);
+    }
+    lStart = dmbMonotonicNanos() - lStart;
+
+    dmbObjectRelease(pObj);
+    DMB_UNUSED(sum);
+    return lStart;
+}
+
+static dmbLONG benchRetainRelease(dmbBOOL bPublish)
+{
+    dmbObject *pObj = dmbCreateStringObject("value", 5);
+    dmbLONG lStart;
+    dmbUINT i;
+
+    if (bPublish)
+        dmbObjectPublish(pObj);
+
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_ZSET_OPS; ++i)
+    {
+        dmbObjectRetain(pObj);
+        dmbObjectRelease(pObj);
+    }
+    lStart = dmbMonotonicNanos() - lStart;
+
+    dmbObjectRelease(pObj);
+    return lStart;
+}
+
+static void benchRefCounting()
+{
+    dmbLONG lPublished, lConfined;
+
+    lPublished = benchRetainRelease(TRUE);
+    lConfined = benchRetainRelease(FALSE);
+    DMB_LOGD("retain + release: atomic %.1f ns, thread confined %.1f ns\n",
+             (double)lPublished / BENCH_ZSET_OPS, (double)lConfined / BENCH_ZSET_OPS);
+
+    lPublished = benchListRanges(TRUE);
+    lConfined = benchListRanges(FALSE);
+    DMB_LOGD("object list range of 100: atomic %.0f ns, thread confined %.0f ns\n",
+             (double)lPublished / BENCH_LIST_RANGES, (double)lConfined / BENCH_LIST_RANGES);
+
+    lPublished = benchZsetScores(TRUE);
+    lConfined = benchZsetScores(FALSE);
+    DMB_LOGD("ZSCORE: atomic %.0f ns, thread confined %.0f ns\n",
+             (double)lPublished / BENCH_ZSET_OPS, (double)lConfined / BENCH_ZSET_OPS);
+}
+
+static dmbLONG benchGet(dmbBOOL bEmbedded, dmbLONG *pCreateNanos)
+{
+    dmbDict *pDict = dmbDictCreate(&dmbDictMetaStrObj, BENCH_KEYS);
+    dmbDictEntry *pEntrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * BENCH_KEYS);
+    dmbDictEntry *pEntry;
+    dmbCHAR key[32], value[32], out[DMB_OBJ_EMBSTR_MAX];
+    const dmbCHAR *pcData;
+    dmbUINT i, uKeyLen, uLen, uSum = 0;
+    dmbLONG lStart, lNanos;
+
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_KEYS; ++i)
+    {
+        uKeyLen = snprintf(key, sizeof(key), "key:%08u", i);
+        uLen = snprintf(value, sizeof(value), "value:%u", i * 7);
+        pEntrys[i].k.val = bEmbedded ? dmbCreateStringObject(key, uKeyLen) : createRawStringObject(key, uKeyLen);
+        pEntrys[i].v.val = bEmbedded ? dmbCreateStringObject(value, uLen) : createRawStringObject(value, uLen);
+    }
+    *pCreateNanos = dmbMonotonicNanos() - lStart;
+
+    for (i=0; i<BENCH_KEYS; ++i)
+        dmbDictPut(pDict, &pEntrys[i]);
+
+    srandom(5);
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_GETS; ++i)
+    {
+        uKeyLen = snprintf(key, sizeof(key), "key:%08u", (dmbUINT)(random() % BENCH_KEYS));
+        pEntry = dmbDictGetByData(pDict, key, uKeyLen);
+        //GET copies the value out
+        dmbStringGetData((dmbString*)((dmbObject*)pEntry->v.val)->ptr, &pcData, &uLen);
+        dmbMemCopy(out, pcData, uLen);
+        uSum += out[uLen - 1];
+    }
+    lNanos = dmbMonotonicNanos() - lStart;
+
+    dmbDictDestroy(pDict);
+    for (i=0; i<BENCH_KEYS; ++i)
+    {
+        dmbObjectRelease((dmbObject*)pEntrys[i].k.val);
+        dmbObjectRelease((dmbObject*)pEntrys[i].v.val);
+    }
+    dmbFree(pEntrys);
+
+    DMB_UNUSED(uSum);
+    return lNanos;
+}
+
+static void benchStringObjects()
+{
+    dmbLONG lCreate[2], lGet[2];
+
+    lGet[0] = benchGet(FALSE, &lCreate[0]);
+    lGet[1] = benchGet(TRUE, &lCreate[1]);
+
+    DMB_LOGD("%u keys, create key and value: separate string %.0f ns, embedded %.0f ns\n",
+             BENCH_KEYS, (double)lCreate[0] / BENCH_KEYS, (double)lCreate[1] / BENCH_KEYS);
+    DMB_LOGD("random GET: separate string %.0f ns, embedded %.0f ns\n",
+             (double)lGet[0] / BENCH_GETS, (double)lGet[1] / BENCH_GETS);
+}
+
+void dmbobject_test()
+{
+    testStringEncoding();
+    benchStringObjects();
+    testIntEncoding();
+    benchCounters();
+    testPublish();
+    benchRefCounting();
+}
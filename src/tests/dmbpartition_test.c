@@ -0,0 +1,255 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbpartition_test.h"
+#include "network/dmbpartition.h"
+#include "thread/dmbthread.h"
+#include "core/dmbdictmetas.h"
+#include "core/dmbhash.h"
+#include "core/dmbstring.h"
+#include "core/dmballoc.h"
+#include "utils/dmbtime.h"
+#include "utils/dmblog.h"
+#include "utils/dmbioutil.h"
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef PARTITION_KEY_COUNT
+#define PARTITION_KEY_COUNT 1000000
+#endif
+//total operations of one run, split over the threads
+#ifndef PARTITION_OPS
+#define PARTITION_OPS 4000000
+#endif
+#define MAX_THREADS 64
+//requests a thread keeps in flight, like pipelined client requests
+#define WINDOW 64
+#define WRITE_PERCENT 10
+
+typedef struct BenchShared {
+    dmbPartition *partitions;
+    dmbString **keys;
+    dmbDictEntry *entrys;
+    //replies received by all threads, a thread may only leave once every
+    //request is answered because it still serves the others meanwhile
+    volatile dmbUINT completed;
+    dmbUINT total;
+} BenchShared;
+
+typedef struct BenchWorker BenchWorker;
+
+typedef struct BenchMsg {
+    dmbPartitionMsg msg;
+    BenchWorker *worker;
+    dmbUINT key;
+    dmbBOOL write;
+} BenchMsg;
+
+struct BenchWorker {
+    dmbThread thread;
+    BenchShared *shared;
+    dmbPartition *partition;
+    dmbPIPE pipeArr[2];
+    BenchMsg msgs[WINDOW];
+    BenchMsg *freeMsgs[WINDOW];
+    dmbUINT freeCount;
+    dmbUINT ops;
+    dmbUINT found;
+    dmbUINT wrong;
+};
+
+static dmbCode execOp(dmbDict *pDict, dmbPartitionMsg *pMsg)
+{
+    BenchMsg *pBench = DMB_ENTRY(pMsg, BenchMsg, msg);
+    BenchShared *pShared = pBench->worker->shared;
+    const dmbCHAR *data; dmbUINT len;
+    dmbDictEntry *pEntry;
+
+    dmbStringGetData(pShared->keys[pBench->key], &data, &len);
+    if (pBench->write)
+    {
+        //nobody else touches this dict, pop and put back needs no lock
+        pEntry = dmbDictPopByData(pDict, data, len);
+        if (pEntry != NULL)
+            dmbDictPut(pDict, pEntry);
+    }
+    else
+    {
+        pEntry = dmbDictGetByData(pDict, data, len);
+    }
+
+    if (pEntry == NULL)
+        return DMB_ERRCODE_NULL_POINTER;
+
+    return pEntry == &pShared->entrys[pBench->key] ? DMB_ERRCODE_OK : DMB_ERRCODE_WRONG_ARGUMENT_VALUE;
+}
+
+static void doneOp(dmbPartitionMsg *pMsg)
+{
+    BenchMsg *pBench = DMB_ENTRY(pMsg, BenchMsg, msg);
+    BenchWorker *pWorker = pBench->worker;
+
+    pWorker->found += pMsg->code == DMB_ERRCODE_OK;
+    pWorker->wrong += pMsg->code != DMB_ERRCODE_OK;
+    pWorker->freeMsgs[pWorker->freeCount++] = pBench;
+    __sync_add_and_fetch(&pWorker->shared->completed, 1);
+}
+
+static void waitMail(BenchWorker *pWorker)
+{
+    struct pollfd pfd;
+    dmbBYTE buf[256];
+
+    if (dmbPartitionProcessMail(pWorker->partition) > 0)
+        return ;
+
+    //sleep on the pipe like a work thread sleeps in epoll, the timeout only
+    //bounds the damage if a wake up was lost
+    pfd.fd = pWorker->pipeArr[0];
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 10) > 0)
+        dmbReadAvailable(pWorker->pipeArr[0], buf, sizeof(buf));
+}
+
+static void* benchWorker(dmbThreadData data)
+{
+    BenchWorker *pWorker = (BenchWorker*)dmbThreadGetParam(data);
+    BenchShared *pShared = pWorker->shared;
+    const dmbCHAR *keyData; dmbUINT len;
+    BenchMsg *pBench;
+    dmbUINT i;
+    dmbUINT64 x = 0x9E3779B97F4A7C15ULL * (pWorker->partition->index + 1);
+
+    for (i = 0; i < pWorker->ops; )
+    {
+        //wait for a free message, serving the other threads meanwhile
+        if (pWorker->freeCount == 0)
+        {
+            waitMail(pWorker);
+            continue;
+        }
+
+        pBench = pWorker->freeMsgs[--pWorker->freeCount];
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        pBench->key = (dmbUINT)(x % PARTITION_KEY_COUNT);
+        pBench->write = (x >> 40) % 100 < WRITE_PERCENT;
+        dmbStringGetData(pShared->keys[pBench->key], &keyData, &len);
+
+        while (dmbPartitionSubmit(pWorker->partition, dmbHash(keyData, len), &pBench->msg) == DMB_ERRCODE_MAILBOX_FULL)
+            waitMail(pWorker);
+
+        ++i;
+    }
+
+    //keep serving until every request of every thread is answered
+    while (__atomic_load_n(&pShared->completed, __ATOMIC_ACQUIRE) < pShared->total
+           || !dmbListIsEmpty(&pWorker->partition->replyList))
+        waitMail(pWorker);
+
+    return NULL;
+}
+
+static void runBench(BenchShared *pShared, dmbUINT uThreads)
+{
+    BenchWorker *pWorkers = (BenchWorker*)dmbMalloc(sizeof(BenchWorker) * uThreads);
+    const dmbCHAR *data; dmbUINT len;
+    dmbUINT i, j, uWrong = 0, uFound = 0;
+    dmbUINT64 uLocal = 0, uForwarded = 0;
+    dmbLONG lCost;
+
+    pShared->partitions = dmbPartitionCreateSet(uThreads, &dmbDictMetaStr, PARTITION_KEY_COUNT / uThreads, WINDOW);
+    pShared->completed = 0;
+    pShared->total = PARTITION_OPS / uThreads * uThreads;
+
+    for (i = 0; i < PARTITION_KEY_COUNT; ++i)
+    {
+        dmbStringGetData(pShared->keys[i], &data, &len);
+        dmbDictPut(dmbPartitionOwner(&pShared->partitions[0], dmbHash(data, len))->dict, &pShared->entrys[i]);
+    }
+
+    for (i = 0; i < uThreads; ++i)
+    {
+        pWorkers[i].shared = pShared;
+        pWorkers[i].partition = &pShared->partitions[i];
+        pWorkers[i].ops = PARTITION_OPS / uThreads;
+        pWorkers[i].found = 0;
+        pWorkers[i].wrong = 0;
+        pWorkers[i].freeCount = WINDOW;
+        if (pipe(pWorkers[i].pipeArr) != 0)
+            DMB_LOGE("pipe failed\n");
+        fcntl(pWorkers[i].pipeArr[0], F_SETFL, O_NONBLOCK);
+        pWorkers[i].partition->notifyFd = pWorkers[i].pipeArr[1];
+        for (j = 0; j < WINDOW; ++j)
+        {
+            pWorkers[i].msgs[j].worker = &pWorkers[i];
+            pWorkers[i].msgs[j].msg.exec = execOp;
+            pWorkers[i].msgs[j].msg.done = doneOp;
+            pWorkers[i].freeMsgs[j] = &pWorkers[i].msgs[j];
+        }
+        dmbThreadInit(&pWorkers[i].thread, benchWorker, NULL, &pWorkers[i]);
+    }
+
+    lCost = dmbLocalCurrentMillis();
+    for (i = 0; i < uThreads; ++i)
+        dmbThreadStart(&pWorkers[i].thread);
+    for (i = 0; i < uThreads; ++i)
+        dmbThreadJoin(&pWorkers[i].thread);
+    lCost = dmbLocalCurrentMillis() - lCost;
+
+    for (i = 0; i < uThreads; ++i)
+    {
+        close(pWorkers[i].pipeArr[0]);
+        close(pWorkers[i].pipeArr[1]);
+        uWrong += pWorkers[i].wrong;
+        uFound += pWorkers[i].found;
+        uLocal += pShared->partitions[i].localOps;
+        uForwarded += pShared->partitions[i].forwardedOps;
+    }
+
+    DMB_LOGD("write %2u%%, %2u threads: %6.2f Mops/s, local %llu, forwarded %llu, found %u, wrong %u\n",
+             WRITE_PERCENT, uThreads, lCost == 0 ? 0.0 : (double)pWorkers[0].ops * uThreads / lCost / 1000.0,
+             uLocal, uForwarded, uFound, uWrong);
+
+    dmbPartitionDestroySet(pShared->partitions);
+    dmbFree(pWorkers);
+}
+
+void dmbpartition_test()
+{
+    BenchShared shared;
+    dmbCHAR buf[64];
+    dmbUINT i, t;
+
+    shared.keys = (dmbString**)dmbMalloc(sizeof(dmbString*) * PARTITION_KEY_COUNT);
+    shared.entrys = (dmbDictEntry*)dmbMalloc(sizeof(dmbDictEntry) * PARTITION_KEY_COUNT);
+
+    for (i = 0; i < PARTITION_KEY_COUNT; ++i)
+    {
+        shared.keys[i] = dmbStringCreateWithFormat(sizeof(buf), "key:%u:%08x", i, i * 2654435761U);
+        shared.entrys[i].k.val = shared.keys[i];
+        shared.entrys[i].v.l = i;
+    }
+
+    for (t = 1; t <= MAX_THREADS; t *= 2)
+        runBench(&shared, t);
+
+    for (i = 0; i < PARTITION_KEY_COUNT; ++i)
+        dmbStringDestroy(shared.keys[i]);
+    dmbFree(shared.keys);
+    dmbFree(shared.entrys);
+}
@@ -0,0 +1,627 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbseglist_test.h"
+#include "base/dmbseglist.h"
+#include "base/dmbdllist.h"
+#include "base/dmbobject.h"
+#include "base/dmbsettings.h"
+#include "network/dmbprotocol.h"
+#include "core/dmballoc.h"
+#include "utils/dmblog.h"
+#include "utils/dmbtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include <stddef.h>
+
+#define TEST_OP_COUNT 20000
+#define TEST_VALUE_MAX 24
+//elements of the memory and iteration comparison
+#define BENCH_COUNT 100000
+
+//the reference model: a ring of fixed size values
+typedef struct RefList {
+    dmbCHAR (*values)[TEST_VALUE_MAX];
+    dmbUINT *lens;
+    dmbLONG head;
+    dmbLONG len;
+    dmbLONG capacity;
+} RefList;
+
+typedef struct ScanData {
+    RefList *ref;
+    dmbLONG pos;
+    dmbLONG step;
+    dmbLONG count;
+    dmbUINT bad;
+} ScanData;
+
+static inline dmbLONG refSlot(RefList *pRef, dmbLONG lIndex)
+{
+    return (pRef->head + lIndex) % pRef->capacity;
+}
+
+//mixes integers, strings that look like integers and plain strings
+static dmbUINT randomValue(dmbCHAR *pcValue)
+{
+    switch (random() % 4)
+    {
+    case 0:
+        return snprintf(pcValue, TEST_VALUE_MAX, "%ld", random() % 100000 - 50000);
+    case 1:
+        return snprintf(pcValue, TEST_VALUE_MAX, "%ld%09ld", random(), random() % 1000000000);
+    case 2:
+        return snprintf(pcValue, TEST_VALUE_MAX, "0%ld", random() % 100);
+    default:
+    {
+        dmbUINT i, uLen = random() % (TEST_VALUE_MAX - 1) + 1;
+        for (i=0; i<uLen; ++i)
+            pcValue[i] = 'a' + random() % 26;
+        return uLen;
+    }
+    }
+}
+
+static dmbBOOL sameValue(RefList *pRef, dmbLONG lIndex, const dmbCHAR *pcValue, dmbUINT uLen)
+{
+    dmbLONG lSlot = refSlot(pRef, lIndex);
+    return pRef->lens[lSlot] == uLen && dmbMemCmp(pRef->values[lSlot], pcValue, uLen) == 0;
+}
+
+static dmbBOOL sameString(RefList *pRef, dmbLONG lIndex, dmbString *pStr)
+{
+    dmbBOOL ret = pStr != NULL && sameValue(pRef, lIndex, dmbStringGet(pStr), dmbStringLength(pStr));
+    if (pStr != NULL)
+        dmbStringDestroy(pStr);
+    return ret;
+}
+
+static dmbCode checkScan(void *pData, const dmbCHAR *pcValue, dmbUINT uLen)
+{
+    ScanData *pScan = (ScanData*)pData;
+
+    pScan->bad += !sameValue(pScan->ref, pScan->pos, pcValue, uLen);
+    pScan->pos += pScan->step;
+    if (++pScan->count == 1000)
+        return DMB_ERRCODE_LIST_SCAN_BREAK;
+    return DMB_ERRCODE_OK;
+}
+
+//the zset rank bounds, -1 when nothing is covered
+static dmbLONG refRange(RefList *pRef, dmbLONG *pStart, dmbLONG *pEnd)
+{
+    if (*pStart < 0)
+        *pStart += pRef->len;
+    if (*pEnd < 0)
+        *pEnd += pRef->len;
+    if (*pStart < 0 || *pStart >= pRef->len)
+        return -1;
+    if (*pEnd < 0 || *pEnd >= pRef->len)
+        *pEnd = pRef->len - 1;
+    return *pStart <= *pEnd ? *pEnd - *pStart + 1 : -1;
+}
+
+static dmbUINT checkList(dmbSegList *pList, RefList *pRef)
+{
+    ScanData scan;
+    dmbLONG start, end, lStart, lEnd, lCount;
+    dmbBOOL reverse;
+    dmbUINT uBad = dmbSegListSize(pList) != pRef->len;
+
+    start = random() % (pRef->len + 20) - 10;
+    end = random() % (pRef->len + 20) - 10;
+    reverse = random() % 2;
+
+    lStart = start;
+    lEnd = end;
+    lCount = refRange(pRef, &lStart, &lEnd);
+
+    scan.ref = pRef;
+    scan.pos = reverse ? lEnd : lStart;
+    scan.step = reverse ? -1 : 1;
+    scan.count = 0;
+    scan.bad = 0;
+    uBad += dmbSegListRange(pList, start, end, reverse, checkScan, &scan) != DMB_ERRCODE_OK;
+    uBad += scan.count != (lCount <= 0 ? 0 : (lCount < 1000 ? lCount : 1000));
+
+    return uBad + scan.bad;
+}
+
+static void testSegList(dmbUINT uSegmentSize, dmbUINT uDepth, dmbUINT uIndexMin)
+{
+    dmbUINT uSize = g_settings.list_max_segment_size, uOldDepth = g_settings.list_compress_depth;
+    dmbUINT uOldIndexMin = g_settings.list_index_min_segments;
+    dmbSegList *pList;
+    RefList ref;
+    dmbCHAR value[TEST_VALUE_MAX];
+    dmbLONG lIndex, start, end, lCount, j;
+    dmbUINT i, uLen, uBad = 0, uSegments = 0;
+
+    g_settings.list_max_segment_size = uSegmentSize;
+    g_settings.list_compress_depth = uDepth;
+    g_settings.list_index_min_segments = uIndexMin;
+    pList = dmbSegListCreate();
+
+    ref.capacity = TEST_OP_COUNT + 1;
+    ref.values = dmbMalloc(TEST_VALUE_MAX * ref.capacity);
+    ref.lens = (dmbUINT*)dmbMalloc(sizeof(dmbUINT) * ref.capacity);
+    ref.head = 0;
+    ref.len = 0;
+
+    srandom(11);
+    uBad += dmbSegListPushBack(pList, "", 0) != DMB_ERRCODE_BINENTRY_IS_EMPTY;
+    uBad += dmbSegListPopBack(pList) != NULL || dmbSegListIndex(pList, 0) != NULL;
+
+    for (i=0; i<TEST_OP_COUNT; ++i)
+    {
+        switch (random() % 10)
+        {
+        case 0: case 1: case 2:
+            uLen = randomValue(value);
+            uBad += dmbSegListPushBack(pList, value, uLen) != DMB_ERRCODE_OK;
+            lIndex = refSlot(&ref, ref.len++);
+            dmbMemCopy(ref.values[lIndex], value, uLen);
+            ref.lens[lIndex] = uLen;
+            break;
+        case 3: case 4: case 5:
+            uLen = randomValue(value);
+            uBad += dmbSegListPushFront(pList, value, uLen) != DMB_ERRCODE_OK;
+            ref.head = (ref.head + ref.capacity - 1) % ref.capacity;
+            ref.len++;
+            dmbMemCopy(ref.values[ref.head], value, uLen);
+            ref.lens[ref.head] = uLen;
+            break;
+        case 6:
+            if (ref.len == 0)
+                break;
+            uBad += !sameString(&ref, ref.len - 1, dmbSegListPopBack(pList));
+            ref.len--;
+            break;
+        case 7:
+            if (ref.len == 0)
+                break;
+            uBad += !sameString(&ref, 0, dmbSegListPopFront(pList));
+            ref.head = (ref.head + 1) % ref.capacity;
+            ref.len--;
+            break;
+        case 8:
+            lIndex = random() % (ref.len + 10) - ref.len - 5;
+            if (lIndex < -ref.len || lIndex >= ref.len)
+                uBad += dmbSegListIndex(pList, lIndex) != NULL;
+            else
+                uBad += !sameString(&ref, lIndex < 0 ? lIndex + ref.len : lIndex, dmbSegListIndex(pList, lIndex));
+            break;
+        default:
+            //rare and short, so the list still grows
+            if (random() % 8 != 0)
+            {
+                uBad += checkList(pList, &ref);
+                break;
+            }
+            start = random() % (ref.len + 4) - 2;
+            end = start + random() % 20;
+            lCount = refRange(&ref, &start, &end);
+            uBad += dmbSegListRemoveRange(pList, start, end) != (lCount < 0 ? 0 : lCount);
+            if (lCount <= 0)
+                break;
+            //move the tail down over the removed values
+            for (j=end+1; j<ref.len; ++j)
+            {
+                dmbMemCopy(ref.values[refSlot(&ref, j - lCount)], ref.values[refSlot(&ref, j)], TEST_VALUE_MAX);
+                ref.lens[refSlot(&ref, j - lCount)] = ref.lens[refSlot(&ref, j)];
+            }
+            ref.len -= lCount;
+            break;
+        }
+        if (pList->count > uSegments)
+            uSegments = pList->count;
+    }
+
+    for (lIndex=0; lIndex<ref.len; ++lIndex)
+        uBad += !sameString(&ref, lIndex, dmbSegListIndex(pList, lIndex));
+
+    DMB_LOGD("seglist: segment %u bytes, depth %u, index from %u segments, %ld values, %u segments (max %u), bad %u\n",
+             uSegmentSize, uDepth, uIndexMin, ref.len, pList->count, uSegments, uBad);
+
+    dmbSegListDestroy(pList);
+    dmbFree(ref.values);
+    dmbFree(ref.lens);
+    g_settings.list_max_segment_size = uSize;
+    g_settings.list_compress_depth = uOldDepth;
+    g_settings.list_index_min_segments = uOldIndexMin;
+}
+
+static dmbCode countScan(void *pData, const dmbCHAR *pcValue, dmbUINT uLen)
+{
+    *(dmbLONG*)pData += uLen + pcValue[0];
+    return DMB_ERRCODE_OK;
+}
+
+//bytes per element and a full iteration against the object list
+static void benchSegList(dmbUINT uDepth, dmbBOOL bInt)
+{
+    dmbUINT uOldDepth = g_settings.list_compress_depth;
+    dmbDLList *pDL;
+    dmbSegList *pList;
+    dmbDLListIter iter;
+    dmbObject *pObj;
+    dmbString *pStr;
+    dmbCHAR value[32];
+    dmbUINT i, uLen;
+    dmbLONG lSum = 0, lStart, lNanos[2];
+    size_t used[2];
+
+    g_settings.list_compress_depth = uDepth;
+
+    used[0] = dmbGetUsedMemSize();
+    pDL = dmbDLListCreate();
+    for (i=0; i<BENCH_COUNT; ++i)
+    {
+        uLen = bInt ? snprintf(value, sizeof(value), "%u", i * 7) : snprintf(value, sizeof(value), "item:%08u", i);
+        pObj = dmbCreateStringObject(value, uLen);
+        dmbDLListPushBack(pDL, pObj);
+        dmbObjectRelease(pObj);
+    }
+    used[0] = dmbGetUsedMemSize() - used[0];
+
+    used[1] = dmbGetUsedMemSize();
+    pList = dmbSegListCreate();
+    for (i=0; i<BENCH_COUNT; ++i)
+    {
+        uLen = bInt ? snprintf(value, sizeof(value), "%u", i * 7) : snprintf(value, sizeof(value), "item:%08u", i);
+        dmbSegListPushBack(pList, value, uLen);
+    }
+    used[1] = dmbGetUsedMemSize() - used[1];
+
+    lStart = dmbMonotonicNanos();
+    dmbDLListInitIter(pDL, &iter, FALSE);
+    while (dmbDLListNext(&iter))
+    {
+        pObj = dmbDLListGetRef(&iter);
+        pStr = (dmbString*)pObj->ptr;
+        lSum += dmbStringLength(pStr) + dmbStringGet(pStr)[0];
+        dmbObjectRelease(pObj);
+    }
+    lNanos[0] = dmbMonotonicNanos() - lStart;
+
+    lStart = dmbMonotonicNanos();
+    dmbSegListRange(pList, 0, -1, FALSE, countScan, &lSum);
+    lNanos[1] = dmbMonotonicNanos() - lStart;
+
+    DMB_LOGD("list %s depth %u: objects %4zu bytes/elem, seglist %4.1f bytes/elem (%.1fx), iterate %5.1f vs %5.1f ns/elem, %u segments (%ld)\n",
+             bInt ? "ints   " : "strings", uDepth, used[0] / BENCH_COUNT, (double)used[1] / BENCH_COUNT,
+             (double)used[0] / used[1], (double)lNanos[0] / BENCH_COUNT, (double)lNanos[1] / BENCH_COUNT,
+             pList->count, lSum);
+
+    dmbDLListDestroy(pDL);
+    dmbSegListDestroy(pList);
+    g_settings.list_compress_depth = uOldDepth;
+}
+
+static dmbCode skipScan(void *pData, const dmbCHAR *pcValue, dmbUINT uLen)
+{
+    DMB_UNUSED(pcValue);
+    *(dmbLONG*)pData += uLen;
+    return DMB_ERRCODE_OK;
+}
+
+//the entries of the response binlist against dmbSegListIndex
+static dmbUINT checkEncoded(dmbSegList *pList, dmbLONG start, dmbBinlist *pEncoded, dmbLONG lCount)
+{
+    dmbBinEntry *pEntry = dmbBinlistFirst(pEncoded);
+    dmbBinVar var;
+    dmbString *pStr;
+    dmbCHAR buf[32];
+    const dmbCHAR *pcValue;
+    dmbUINT uLen, uBad = dmbBinlistLen(pEncoded) != lCount;
+    dmbLONG i;
+
+    for (i=0; i<lCount && pEntry != NULL && !uBad; ++i, pEntry = dmbBinlistNext(pEntry))
+    {
+        dmbBinEntryGet(pEntry, &var);
+        switch (DMB_BINCODE(pEntry))
+        {
+        case DMB_BINCODE_I16:
+            uLen = snprintf(buf, sizeof(buf), "%d", var.i16);
+            pcValue = buf;
+            break;
+        case DMB_BINCODE_I32:
+            uLen = snprintf(buf, sizeof(buf), "%d", var.i32);
+            pcValue = buf;
+            break;
+        case DMB_BINCODE_I64:
+            uLen = snprintf(buf, sizeof(buf), "%lld", (long long)var.i64);
+            pcValue = buf;
+            break;
+        default:
+            uLen = var.len;
+            pcValue = (const dmbCHAR*)var.data;
+            break;
+        }
+
+        pStr = dmbSegListIndex(pList, start + i);
+        uBad += pStr == NULL || dmbStringLength(pStr) != uLen || dmbMemCmp(dmbStringGet(pStr), pcValue, uLen) != 0;
+        if (pStr != NULL)
+            dmbStringDestroy(pStr);
+    }
+
+    return uBad + (dmbBinlistLast(pEncoded) != (lCount == 0 ? dmbBinlistFirst(pEncoded) : dmbBinlistGet(pEncoded, lCount - 1)));
+}
+
+static dmbUINT encodeOnce(dmbSegList *pList, dmbConnect *pConn, dmbLONG start, dmbLONG end)
+{
+    dmbFixmemAllocator fixmem;
+    dmbBinlist *pEncoded;
+    dmbBYTE *pResp;
+    dmbUINT16 status;
+    dmbUINT32 length;
+    dmbUINT uPending = pConn->writeLength, uBad = 0;
+    dmbLONG lLen = dmbSegListSize(pList), lCount;
+
+    pEncoded = dmbBeginBinlistResponse(pConn, &fixmem);
+    dmbEndBinlistResponse(pConn, pEncoded, dmbSegListEncodeRange(pList, start, end, &fixmem.allocator, &pEncoded));
+
+    //the header may sit at any address, read it byte wise
+    pResp = pConn->writeBuf + pConn->writeIndex + uPending;
+    dmbMemCopy(&status, pResp + offsetof(dmbResponse, status), sizeof(status));
+    dmbMemCopy(&length, pResp + offsetof(dmbResponse, length), sizeof(length));
+    status = ntohs(status);
+    length = ntohl(length);
+    if (status != DMB_ERRCODE_OK)
+        return status == DMB_ERRCODE_OUT_OF_WRITEBUF ? 0 : 1;
+
+    if (start < 0)
+        start += lLen;
+    if (end < 0)
+        end += lLen;
+    if (end >= lLen)
+        end = lLen - 1;
+    lCount = start < 0 || start >= lLen || end < start ? 0 : end - start + 1;
+
+    uBad += length != dmbBinlistRawSize(pResp + dmbResponseHeaderSize);
+    uBad += pConn->writeLength != uPending + dmbResponseHeaderSize + length;
+    return uBad + checkEncoded(pList, start, pResp + dmbResponseHeaderSize, lCount);
+}
+
+static void testEncode(dmbUINT uBufSize, dmbUINT uIndexMin)
+{
+    dmbUINT uSize = g_settings.list_max_segment_size, uOldIndexMin = g_settings.list_index_min_segments;
+    dmbSegList *pList;
+    dmbConnect conn;
+    dmbCHAR value[TEST_VALUE_MAX];
+    dmbUINT i, uLen, uBad = 0, uOverflow = 0;
+    dmbLONG start;
+
+    g_settings.list_max_segment_size = 256;
+    g_settings.list_index_min_segments = uIndexMin;
+    pList = dmbSegListCreate();
+    srandom(7);
+    for (i=0; i<5000; ++i)
+    {
+        uLen = randomValue(value);
+        dmbSegListPushBack(pList, value, uLen);
+    }
+
+    dmbMemSet(&conn, 0, sizeof(conn));
+    conn.writeBuf = (dmbBYTE*)dmbMalloc(uBufSize);
+    conn.writeBufSize = uBufSize;
+    for (i=0; i<2000; ++i)
+    {
+        //some bytes still waiting to be sent
+        conn.writeIndex = random() % 64;
+        conn.writeLength = random() % 64;
+        conn.needClose = FALSE;
+        start = random() % 5100 - 50;
+        uBad += encodeOnce(pList, &conn, start, start + random() % 300 - 20);
+        uOverflow += conn.needClose;
+    }
+
+    DMB_LOGD("seglist encode: %u byte buffer, index from %u segments, %u overflowed, bad %u\n",
+             uBufSize, uIndexMin, uOverflow, uBad);
+
+    dmbFree(conn.writeBuf);
+    dmbSegListDestroy(pList);
+    g_settings.list_max_segment_size = uSize;
+    g_settings.list_index_min_segments = uOldIndexMin;
+}
+
+//LRANGE of uCount values through dmbDLListGetRange and per value serialization, and straight from the segments
+static void benchEncode(dmbUINT uCount)
+{
+    dmbDLList *pDL, *pRange;
+    dmbDLListIter iter;
+    dmbSegList *pList;
+    dmbObject *pObj;
+    dmbString *pStr;
+    dmbConnect conn;
+    dmbFixmemAllocator fixmem;
+    dmbBinlist *pEncoded;
+    dmbBinItem item;
+    dmbCHAR value[32];
+    dmbUINT i, uLen, uStart;
+    dmbLONG lStart, lNanos[2];
+
+    pDL = dmbDLListCreate();
+    pList = dmbSegListCreate();
+    for (i=0; i<BENCH_COUNT; ++i)
+    {
+        uLen = snprintf(value, sizeof(value), "item:%08u", i);
+        pObj = dmbCreateStringObject(value, uLen);
+        dmbDLListPushBack(pDL, pObj);
+        dmbObjectRelease(pObj);
+        dmbSegListPushBack(pList, value, uLen);
+    }
+
+    dmbMemSet(&conn, 0, sizeof(conn));
+    conn.writeBufSize = 65536;
+    conn.writeBuf = (dmbBYTE*)dmbMalloc(conn.writeBufSize);
+
+    srandom(9);
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<1000; ++i)
+    {
+        //the first fifth, where dmbDLListGetRange walks forward and keeps the order
+        uStart = random() % (BENCH_COUNT / 5);
+        pRange = dmbDLListCreate();
+        dmbDLListGetRange(pDL, uStart, uStart + uCount - 1, pRange);
+
+        conn.writeLength = 0;
+        pEncoded = dmbBeginBinlistResponse(&conn, &fixmem);
+        dmbDLListInitIter(pRange, &iter, FALSE);
+        while (dmbDLListNext(&iter))
+        {
+            pObj = dmbDLListGetRef(&iter);
+            pStr = (dmbString*)pObj->ptr;
+            dmbBinItemStr(&item, (dmbBYTE*)dmbStringGet(pStr), dmbStringLength(pStr));
+            dmbBinlistInsertAt(&fixmem.allocator, &pEncoded, NULL, &item, 1);
+            dmbObjectRelease(pObj);
+        }
+        dmbEndBinlistResponse(&conn, pEncoded, DMB_ERRCODE_OK);
+        dmbDLListDestroy(pRange);
+    }
+    lNanos[0] = dmbMonotonicNanos() - lStart;
+
+    srandom(9);
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<1000; ++i)
+    {
+        uStart = random() % (BENCH_COUNT / 5);
+        conn.writeLength = 0;
+        pEncoded = dmbBeginBinlistResponse(&conn, &fixmem);
+        dmbEndBinlistResponse(&conn, pEncoded, dmbSegListEncodeRange(pList, uStart, uStart + uCount - 1, &fixmem.allocator, &pEncoded));
+    }
+    lNanos[1] = dmbMonotonicNanos() - lStart;
+
+    DMB_LOGD("LRANGE %4u values: object list %8.0f ns, segments into the write buffer %6.0f ns (%.1fx)\n",
+             uCount, (double)lNanos[0] / 1000, (double)lNanos[1] / 1000, (double)lNanos[0] / lNanos[1]);
+
+    dmbFree(conn.writeBuf);
+    dmbDLListDestroy(pDL);
+    dmbSegListDestroy(pList);
+}
+
+//random LINDEX and 10 value LRANGE calls on a large list, walking the segments and with the index
+static void benchIndex(dmbLONG lCount)
+{
+    dmbUINT uIndexMin = g_settings.list_index_min_segments;
+    dmbSegList *pList;
+    dmbCHAR value[32];
+    dmbUINT uLen, pass;
+    dmbLONG i, lIndex, lSum = 0, lStart, lNanos[2][2];
+
+    g_settings.list_index_min_segments = 0;
+    pList = dmbSegListCreate();
+    for (i=0; i<lCount; ++i)
+    {
+        uLen = snprintf(value, sizeof(value), "item:%08ld", i);
+        dmbSegListPushBack(pList, value, uLen);
+    }
+
+    for (pass=0; pass<2; ++pass)
+    {
+        //the first lookup of the second pass builds the index
+        g_settings.list_index_min_segments = pass == 0 ? 0 : 1;
+        srandom(3);
+
+        lStart = dmbMonotonicNanos();
+        for (i=0; i<TEST_OP_COUNT; ++i)
+        {
+            lIndex = random() % lCount;
+            dmbStringDestroy(dmbSegListIndex(pList, lIndex));
+        }
+        lNanos[pass][0] = dmbMonotonicNanos() - lStart;
+
+        lStart = dmbMonotonicNanos();
+        for (i=0; i<TEST_OP_COUNT; ++i)
+        {
+            lIndex = random() % lCount;
+            dmbSegListRange(pList, lIndex, lIndex + 9, FALSE, skipScan, &lSum);
+        }
+        lNanos[pass][1] = dmbMonotonicNanos() - lStart;
+    }
+
+    DMB_LOGD("seglist %ld values, %u segments: index %.0f -> %.0f ns, range of 10 %.0f -> %.0f ns (%ld)\n",
+             lCount, pList->count, (double)lNanos[0][0] / TEST_OP_COUNT, (double)lNanos[1][0] / TEST_OP_COUNT,
+             (double)lNanos[0][1] / TEST_OP_COUNT, (double)lNanos[1][1] / TEST_OP_COUNT, lSum);
+
+    dmbSegListDestroy(pList);
+    g_settings.list_index_min_segments = uIndexMin;
+}
+
+static void benchEnds()
+{
+    dmbSegList *pList = dmbSegListCreate();
+    dmbCHAR value[32];
+    dmbUINT i, uLen;
+    dmbLONG lStart, lPush, lPop;
+
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_COUNT; ++i)
+    {
+        uLen = snprintf(value, sizeof(value), "item:%08u", i);
+        if (i % 2)
+            dmbSegListPushBack(pList, value, uLen);
+        else
+            dmbSegListPushFront(pList, value, uLen);
+    }
+    lPush = dmbMonotonicNanos() - lStart;
+
+    lStart = dmbMonotonicNanos();
+    for (i=0; i<BENCH_COUNT; ++i)
+        dmbStringDestroy(i % 2 ? dmbSegListPopBack(pList) : dmbSegListPopFront(pList));
+    lPop = dmbMonotonicNanos() - lStart;
+
+    DMB_LOGD("seglist ends: push %.1f ns, pop %.1f ns, %u segments left\n",
+             (double)lPush / BENCH_COUNT, (double)lPop / BENCH_COUNT, pList->count);
+
+    dmbSegListDestroy(pList);
+}
+
+void dmbseglist_test()
+{
+    dmbUINT uSize = g_settings.list_max_segment_size;
+    dmbBinCompressStats *pStats;
+
+    testSegList(8192, 0, 0);
+    testSegList(256, 0, 0);
+    testSegList(256, 0, 1);
+    testSegList(1024, 1, 4);
+    testSegList(256, 2, 0);
+    testSegList(256, 2, 16);
+
+    g_settings.list_max_segment_size = 8192;
+    benchSegList(0, FALSE);
+    benchSegList(0, TRUE);
+    benchSegList(1, FALSE);
+    benchEnds();
+    benchIndex(10000);
+    benchIndex(1000000);
+
+    testEncode(65536, 0);
+    testEncode(65536, 1);
+    testEncode(1024, 0);
+    benchEncode(10);
+    benchEncode(100);
+    benchEncode(1000);
+    g_settings.list_max_segment_size = uSize;
+
+    pStats = dmbSegListCompressStats();
+    DMB_LOGD("seglist compression: ratio %.2f, %llu compressions, %llu rejected, %.0f ns per decode\n",
+             dmbBinCompressRatio(pStats), (unsigned long long)pStats->compressions,
+             (unsigned long long)pStats->rejected, dmbBinDecodeNanos(pStats));
+}
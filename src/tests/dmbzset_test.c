@@ -0,0 +1,822 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbzset_test.h"
+#include "base/dmbzset.h"
+#include "base/dmbobject.h"
+#include "base/dmbsettings.h"
+#include "core/dmballoc.h"
+#include "core/dmbskiplist.h"
+#include "core/dmbdictmetas.h"
+#include "core/dmbrandom.h"
+#include "thread/dmbthread.h"
+#include "utils/dmbtime.h"
+#include "utils/dmblog.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_MEMBER_COUNT 20000
+#define TEST_OP_COUNT 200000
+//largest zset of the benchmark, 10K..ZSET_BENCH_MAX; 10M members need well over
+//the default max_mem_size of 512M
+#ifndef ZSET_BENCH_MAX
+#define ZSET_BENCH_MAX 1000000
+#endif
+//largest list of the generic/specialized skiplist comparison
+#ifndef SKIPLIST_BENCH_MAX
+#define SKIPLIST_BENCH_MAX 1000000
+#endif
+#define BENCH_QUERY_COUNT 200000
+#define BENCH_RANGE_LEN 10
+#define BENCH_SCAN_ROUNDS 10
+//keys of the memory comparison
+#define MEM_KEY_COUNT 2000
+//level draws and inserts of one multi-threaded run, split over the threads
+#define THREAD_BENCH_OPS 4000000
+#define MAX_THREADS 16
+//size the lists of the insert run are refilled at, keeps them in cache
+#define THREAD_LIST_LEN 10000
+
+typedef struct RefMember {
+    dmbCHAR name[16];
+    dmbUINT len;
+    double score;
+    dmbBOOL exist;
+} RefMember;
+
+typedef struct CheckData {
+    RefMember **sorted;
+    dmbLONG index;
+    dmbLONG bad;
+    double lastScore;
+} CheckData;
+
+static dmbINT compareRef(const void *p1, const void *p2)
+{
+    const RefMember *r1 = *(RefMember* const*)p1, *r2 = *(RefMember* const*)p2;
+    dmbINT ret;
+
+    if (r1->score != r2->score)
+        return r1->score < r2->score ? -1 : 1;
+
+    ret = dmbMemCmp(r1->name, r2->name, r1->len < r2->len ? r1->len : r2->len);
+    return ret != 0 ? ret : (dmbINT)r1->len - (dmbINT)r2->len;
+}
+
+static dmbCode checkOrder(void *pData, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    CheckData *pCheck = (CheckData*)pData;
+    RefMember *pRef = pCheck->sorted[pCheck->index++];
+
+    if (pRef->score != score || pRef->len != uLen || dmbMemCmp(pRef->name, pcMember, uLen) != 0)
+        pCheck->bad++;
+
+    return DMB_ERRCODE_OK;
+}
+
+static dmbCode checkReverse(void *pData, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    CheckData *pCheck = (CheckData*)pData;
+    RefMember *pRef = pCheck->sorted[pCheck->index--];
+
+    if (pRef->score != score || pRef->len != uLen || dmbMemCmp(pRef->name, pcMember, uLen) != 0)
+        pCheck->bad++;
+
+    return DMB_ERRCODE_OK;
+}
+
+static dmbCode checkRange(void *pData, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    CheckData *pCheck = (CheckData*)pData;
+    DMB_UNUSED(pcMember);
+    DMB_UNUSED(uLen);
+
+    if (score < pCheck->lastScore)
+        pCheck->bad++;
+    pCheck->lastScore = score;
+    pCheck->index++;
+
+    return DMB_ERRCODE_OK;
+}
+
+static const dmbCHAR* encodeName(dmbUINT32 encode)
+{
+    if (encode == DMB_OBJ_ENCODE_BINLIST)
+        return "binlist";
+    return encode == DMB_OBJ_ENCODE_BTREE ? "btree" : "skiplist";
+}
+
+//uMembers decides if the set stays in the binlist encoding
+static void testZset(dmbUINT uMembers)
+{
+    dmbObject *pObj = dmbCreateZsetObject();
+    dmbZset *pZset = (dmbZset*)pObj->ptr;
+    RefMember *pRefs = (RefMember*)dmbMalloc(sizeof(RefMember) * uMembers);
+    RefMember **pSorted = (RefMember**)dmbMalloc(sizeof(RefMember*) * uMembers);
+    CheckData check;
+    dmbBOOL added;
+    double score;
+    dmbUINT i, k, uCount = 0, uBad = 0;
+    dmbLONG rank;
+
+    srandom(2);
+    for (i=0; i<uMembers; ++i)
+    {
+        pRefs[i].len = snprintf(pRefs[i].name, sizeof(pRefs[i].name), "m%u", i);
+        pRefs[i].exist = FALSE;
+    }
+
+    //add, update and remove at random, few distinct scores so ties are common
+    for (i=0; i<TEST_OP_COUNT; ++i)
+    {
+        k = random() % uMembers;
+        if (random() % 4 == 0)
+        {
+            uBad += dmbZsetRemove(pZset, pRefs[k].name, pRefs[k].len) != pRefs[k].exist;
+            pRefs[k].exist = FALSE;
+        }
+        else
+        {
+            score = (double)(random() % 1000) / 4;
+            dmbZsetAdd(pZset, pRefs[k].name, pRefs[k].len, score, &added);
+            uBad += added == pRefs[k].exist;
+            pRefs[k].exist = TRUE;
+            pRefs[k].score = score;
+        }
+    }
+
+    for (i=0; i<uMembers; ++i)
+    {
+        if (pRefs[i].exist)
+            pSorted[uCount++] = &pRefs[i];
+    }
+    qsort(pSorted, uCount, sizeof(RefMember*), compareRef);
+
+    uBad += dmbZsetSize(pZset) != uCount;
+    for (i=0; i<uCount; ++i)
+    {
+        rank = dmbZsetRank(pZset, pSorted[i]->name, pSorted[i]->len, FALSE);
+        uBad += rank != i;
+        rank = dmbZsetRank(pZset, pSorted[i]->name, pSorted[i]->len, TRUE);
+        uBad += rank != uCount - 1 - i;
+        uBad += dmbZsetScore(pZset, pSorted[i]->name, pSorted[i]->len, &score) != DMB_ERRCODE_OK || score != pSorted[i]->score;
+    }
+
+    check.sorted = pSorted;
+    check.index = 0;
+    check.bad = 0;
+    dmbZsetRangeByRank(pZset, 0, -1, FALSE, checkOrder, &check);
+    uBad += check.bad + (check.index != uCount);
+
+    check.index = uCount - 1;
+    check.bad = 0;
+    dmbZsetRangeByRank(pZset, 0, -1, TRUE, checkReverse, &check);
+    uBad += check.bad + (check.index != -1);
+
+    check.index = 0;
+    check.bad = 0;
+    check.lastScore = 10;
+    dmbZsetRangeByScore(pZset, 10, 20, FALSE, checkRange, &check);
+    uBad += check.bad + (check.index != dmbZsetCount(pZset, 10, 20));
+
+    DMB_LOGD("zset: %u members, encode %s, bad %u\n", uCount, encodeName(dmbObjectEncoding(pObj)), uBad);
+
+    dmbObjectRelease(pObj);
+    dmbFree(pRefs);
+    dmbFree(pSorted);
+}
+
+//a member longer than zset_max_binlist_value converts the set, the order must survive
+static void testConvert()
+{
+    dmbZset *pZset = dmbZsetCreate();
+    dmbCHAR buf[128];
+    dmbUINT i, uBad = 0;
+    dmbUINT len;
+
+    for (i=0; i<50; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "m%u", i);
+        dmbZsetAdd(pZset, buf, len, 50 - i, NULL);
+    }
+    uBad += pZset->encode != DMB_OBJ_ENCODE_BINLIST;
+
+    dmbMemSet(buf, 'x', sizeof(buf));
+    dmbZsetAdd(pZset, buf, g_settings.zset_max_binlist_value + 1, 0, NULL);
+    uBad += pZset->encode != (g_settings.zset_use_btree ? DMB_OBJ_ENCODE_BTREE : DMB_OBJ_ENCODE_SKIPLIST);
+    uBad += dmbZsetSize(pZset) != 51;
+    uBad += dmbZsetRank(pZset, buf, g_settings.zset_max_binlist_value + 1, FALSE) != 0;
+
+    for (i=0; i<50; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "m%u", i);
+        uBad += dmbZsetRank(pZset, buf, len, FALSE) != 50 - i;
+    }
+
+    DMB_LOGD("zset convert: encode %s, bad %u\n", encodeName(pZset->encode), uBad);
+    dmbZsetDestroy(pZset);
+}
+
+//score updates while no allocation succeeds, a failed update keeps the old score
+static void testUpdateNoMem()
+{
+    dmbZset *pZset = dmbZsetCreate();
+    CheckData check;
+    dmbCHAR buf[16];
+    double score;
+    dmbUINT i, uFailed = 0, uBad = 0;
+    dmbUINT len;
+    dmbCode code;
+
+    for (i=0; i<1000; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "m%u", i);
+        dmbZsetAdd(pZset, buf, len, i, NULL);
+    }
+
+    //every update moves the member to the front, the first leaf keeps splitting
+    dmbSetMaxMemSize(0);
+    for (i=0; i<200; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "m%u", i);
+        code = dmbZsetAdd(pZset, buf, len, -1.0 - i, NULL);
+        uFailed += code != DMB_ERRCODE_OK;
+        uBad += dmbZsetScore(pZset, buf, len, &score) != DMB_ERRCODE_OK;
+        uBad += score != (code == DMB_ERRCODE_OK ? -1.0 - i : i);
+    }
+    dmbSetMaxMemSize((size_t)g_settings.max_mem_size);
+
+    uBad += dmbZsetSize(pZset) != 1000;
+    check.index = 0;
+    check.bad = 0;
+    check.lastScore = -1000;
+    dmbZsetRangeByScore(pZset, -1000, 1000, FALSE, checkRange, &check);
+    uBad += check.bad + (check.index != 1000);
+
+    DMB_LOGD("zset update without memory: encode %s, failed %u, bad %u\n", encodeName(pZset->encode), uFailed, uBad);
+    dmbZsetDestroy(pZset);
+}
+
+static dmbCode countRange(void *pData, double score, const dmbCHAR *pcMember, dmbUINT uLen)
+{
+    DMB_UNUSED(score);
+    DMB_UNUSED(pcMember);
+    DMB_UNUSED(uLen);
+    (*(dmbLONG*)pData)++;
+    return DMB_ERRCODE_OK;
+}
+
+//meta of the generic skiplist holding the same data as dmbZSkipList: double score in the pointer, dmbString value
+typedef union {
+    void *ptr;
+    double score;
+} BenchScore;
+
+static inline void* benchScorePtr(double score)
+{
+    BenchScore s;
+    s.ptr = NULL;
+    s.score = score;
+    return s.ptr;
+}
+
+static dmbCode benchInit(void **pPtr)
+{
+    DMB_UNUSED(pPtr);
+    return DMB_ERRCODE_OK;
+}
+
+static dmbBOOL benchCleanScore(void *pScore)
+{
+    DMB_UNUSED(pScore);
+    return TRUE;
+}
+
+static dmbBOOL benchCleanValue(void *pValue)
+{
+    dmbStringDestroy((dmbString*)pValue);
+    return TRUE;
+}
+
+static dmbINT benchCompareScore(void *pDestScore, void *pListScore)
+{
+    BenchScore s1, s2;
+    s1.ptr = pDestScore;
+    s2.ptr = pListScore;
+    return s1.score < s2.score ? -1 : (s1.score > s2.score ? 1 : 0);
+}
+
+static dmbINT benchCompareValue(void *pDestValue, void *pListValue)
+{
+    return dmbStringKeyCompare(pDestValue, pListValue);
+}
+
+static dmbCode benchOnScan(void *pData, void *pScore, void *pValue)
+{
+    DMB_UNUSED(pScore);
+    DMB_UNUSED(pValue);
+    (*(dmbLONG*)pData)++;
+    return DMB_ERRCODE_OK;
+}
+
+static dmbINT benchCompareId(void *pDestValue, void *pListValue)
+{
+    return (dmbLONG)pDestValue < (dmbLONG)pListValue ? -1 : ((dmbLONG)pDestValue > (dmbLONG)pListValue ? 1 : 0);
+}
+
+static dmbSkipListMeta g_bench_meta = {
+    benchInit,
+    benchCleanScore,
+    benchInit,
+    benchCleanValue,
+    benchCompareScore,
+    benchCompareValue,
+    benchOnScan
+};
+
+//values are plain ids, nothing to clean
+static dmbSkipListMeta g_bench_id_meta = {
+    benchInit,
+    NULL,
+    benchInit,
+    NULL,
+    benchCompareScore,
+    benchCompareId,
+    benchOnScan
+};
+
+//insert and ~BENCH_RANGE_LEN member range queries, generic skiplist against dmbZSkipList
+static void benchSkipList(dmbUINT uCount)
+{
+    dmbSkipList *pList = dmbSkipListCreate(&g_bench_meta);
+    dmbZSkipList *pZList = dmbZSkipListCreate();
+    dmbCHAR buf[32];
+    dmbUINT i, len;
+    dmbLONG lAdd[2], lRange[2], lFound[2] = {0, 0};
+    double step = (double)RAND_MAX / uCount * BENCH_RANGE_LEN, min;
+
+    srandom(6);
+    lAdd[0] = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "member:%u", i);
+        dmbSkipListInsert(pList, benchScorePtr((double)random()), dmbStringCreateWithBuffer(buf, len), NULL);
+    }
+    lAdd[0] = dmbLocalCurrentMillis() - lAdd[0];
+
+    srandom(6);
+    lAdd[1] = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "member:%u", i);
+        dmbZSkipListInsert(pZList, (double)random(), dmbStringCreateWithBuffer(buf, len), NULL);
+    }
+    lAdd[1] = dmbLocalCurrentMillis() - lAdd[1];
+
+    srandom(7);
+    lRange[0] = dmbLocalCurrentMillis();
+    for (i=0; i<BENCH_QUERY_COUNT; ++i)
+    {
+        min = (double)random();
+        dmbSkipListGetRangByScore(pList, benchScorePtr(min), benchScorePtr(min + step), &lFound[0], FALSE);
+    }
+    lRange[0] = dmbLocalCurrentMillis() - lRange[0];
+
+    srandom(7);
+    lRange[1] = dmbLocalCurrentMillis();
+    for (i=0; i<BENCH_QUERY_COUNT; ++i)
+    {
+        min = (double)random();
+        dmbZSkipListGetRangeByScore(pZList, min, min + step, FALSE, countRange, &lFound[1]);
+    }
+    lRange[1] = dmbLocalCurrentMillis() - lRange[1];
+
+    DMB_LOGD("skiplist %8u: insert generic %5.0f ns/op, double %5.0f ns/op; range(~%u) generic %5.0f ns/op, double %5.0f ns/op; %s\n",
+             uCount, lAdd[0] * 1000000.0 / uCount, lAdd[1] * 1000000.0 / uCount, BENCH_RANGE_LEN,
+             lRange[0] * 1000000.0 / BENCH_QUERY_COUNT, lRange[1] * 1000000.0 / BENCH_QUERY_COUNT,
+             lFound[0] == lFound[1] && dmbSkipListSize(pList) == dmbZSkipListSize(pZList) ? "same results" : "results differ");
+
+    dmbSkipListDestroy(pList);
+    dmbZSkipListDestroy(pZList);
+}
+
+//sorted load, then rank and score range removals checked against the expected ranks, uCount > 608
+static void testBulk(dmbUINT uCount)
+{
+    dmbSkipList *pList = dmbSkipListCreate(&g_bench_meta);
+    void **ppScores = (void**)dmbMalloc(sizeof(void*) * uCount);
+    void **ppValues = (void**)dmbMalloc(sizeof(void*) * uCount);
+    dmbBOOL *pExist = (dmbBOOL*)dmbMalloc(sizeof(dmbBOOL) * uCount);
+    dmbString *pValue;
+    dmbCHAR buf[32];
+    dmbUINT i, len, rank = 0, uBad = 0;
+    dmbLONG lLoaded, lCount, lRemoved = 0;
+
+    //three nodes per score, the values keep the order strict
+    for (i=0; i<uCount; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "%08u", i);
+        ppScores[i] = benchScorePtr(i / 3);
+        ppValues[i] = dmbStringCreateWithBuffer(buf, len);
+        pExist[i] = TRUE;
+    }
+
+    uBad += dmbSkipListLoad(pList, ppScores, ppValues, uCount, &lLoaded) != DMB_ERRCODE_OK || lLoaded != uCount;
+
+    dmbSkipListRemoveByRank(pList, 10, 19, &lCount, NULL);
+    lRemoved += lCount;
+    for (i=10; i<20; ++i)
+        pExist[i] = FALSE;
+
+    dmbSkipListRemoveByScore(pList, benchScorePtr(100), benchScorePtr(200), &lCount, NULL);
+    lRemoved += lCount;
+    for (i=300; i<603; ++i)
+        pExist[i] = FALSE;
+
+    dmbSkipListRemoveByRank(pList, -5, -1, &lCount, NULL);
+    lRemoved += lCount;
+    for (i=uCount-5; i<uCount; ++i)
+        pExist[i] = FALSE;
+
+    uBad += lRemoved != 10 + 303 + 5 || dmbSkipListSize(pList) != (dmbLONG)uCount - lRemoved;
+    for (i=0; i<uCount; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "%08u", i);
+        pValue = dmbStringCreateWithBuffer(buf, len);
+        rank += pExist[i];
+        uBad += dmbSkipListGetRank(pList, benchScorePtr(i / 3), pValue) != (pExist[i] ? rank : 0);
+        dmbStringDestroy(pValue);
+    }
+
+    //random inserts on top of the loaded shape, then emptying the list by score
+    for (i=0; i<1000; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "x%u", i);
+        dmbSkipListInsert(pList, benchScorePtr((double)(random() % uCount)), dmbStringCreateWithBuffer(buf, len), NULL);
+    }
+    lCount = 0;
+    dmbSkipListScanByRank(pList, 0, -1, &lCount, NULL, FALSE);
+    uBad += lCount != (dmbLONG)uCount - lRemoved + 1000;
+
+    dmbSkipListRemoveByScore(pList, benchScorePtr(-1), benchScorePtr(uCount), &lCount, NULL);
+    uBad += lCount != (dmbLONG)uCount - lRemoved + 1000 || dmbSkipListSize(pList) != 0 || pList->pool.pages != NULL;
+
+    DMB_LOGD("skiplist bulk %u: removed %ld, bad %u\n", uCount, lRemoved, uBad);
+
+    dmbSkipListDestroy(pList);
+    dmbFree(ppScores);
+    dmbFree(ppValues);
+    dmbFree(pExist);
+}
+
+//sorted load against one insert per node, trimming half the list in one pass against one node at a time
+static void benchBulk(dmbUINT uCount)
+{
+    dmbSkipList *pList = dmbSkipListCreate(&g_bench_id_meta);
+    dmbSkipList *pLoad = dmbSkipListCreate(&g_bench_id_meta);
+    void **ppScores = (void**)dmbMalloc(sizeof(void*) * uCount);
+    void **ppValues = (void**)dmbMalloc(sizeof(void*) * uCount);
+    dmbUINT i;
+    dmbLONG lInsert, lLoad, lTrim, lRemoveOne, lCount = 0;
+
+    for (i=0; i<uCount; ++i)
+    {
+        ppScores[i] = benchScorePtr(i);
+        ppValues[i] = (void*)(dmbLONG)(i + 1);
+    }
+
+    lInsert = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+        dmbSkipListInsert(pList, ppScores[i], ppValues[i], NULL);
+    lInsert = dmbLocalCurrentMillis() - lInsert;
+
+    lLoad = dmbLocalCurrentMillis();
+    dmbSkipListLoad(pLoad, ppScores, ppValues, uCount, NULL);
+    lLoad = dmbLocalCurrentMillis() - lLoad;
+
+    lRemoveOne = dmbLocalCurrentMillis();
+    for (i=uCount/4; i<uCount/4*3; ++i)
+        dmbSkipListRemoveOne(pList, ppScores[i], ppValues[i]);
+    lRemoveOne = dmbLocalCurrentMillis() - lRemoveOne;
+
+    lTrim = dmbLocalCurrentMillis();
+    dmbSkipListRemoveByScore(pLoad, ppScores[uCount/4], ppScores[uCount/4*3-1], &lCount, NULL);
+    lTrim = dmbLocalCurrentMillis() - lTrim;
+
+    DMB_LOGD("skiplist bulk %8u: insert %5ld ms, load %4ld ms; remove half one by one %5ld ms, by score %4ld ms, %s\n",
+             uCount, lInsert, lLoad, lRemoveOne, lTrim,
+             lCount == uCount/4*2 && dmbSkipListSize(pList) == dmbSkipListSize(pLoad) ? "ok" : "bad");
+
+    dmbSkipListDestroy(pList);
+    dmbSkipListDestroy(pLoad);
+    dmbFree(ppScores);
+    dmbFree(ppValues);
+}
+
+//node allocation: insert, full level 0 scans and dropping every node
+static void benchNodes(dmbUINT uCount)
+{
+    dmbSkipList *pList = dmbSkipListCreate(&g_bench_id_meta);
+    dmbUINT i;
+    dmbLONG lAdd, lScan, lRemove, lFound = 0;
+    size_t used = dmbGetUsedMemSize();
+
+    srandom(8);
+    lAdd = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+        dmbSkipListInsert(pList, benchScorePtr((double)random()), (void*)(dmbLONG)(i + 1), NULL);
+    lAdd = dmbLocalCurrentMillis() - lAdd;
+    used = dmbGetUsedMemSize() - used;
+
+    lScan = dmbLocalCurrentMillis();
+    for (i=0; i<BENCH_SCAN_ROUNDS; ++i)
+        dmbSkipListScanByRank(pList, 0, -1, &lFound, NULL, FALSE);
+    lScan = dmbLocalCurrentMillis() - lScan;
+
+    lRemove = dmbLocalCurrentMillis();
+    dmbSkipListRemoveAll(pList);
+    lRemove = dmbLocalCurrentMillis() - lRemove;
+
+    DMB_LOGD("nodes %8u: insert %5.0f ns/op, full scan %5.1f ns/node, remove all %4ld ms, %5.1f bytes/node, %s\n",
+             uCount, lAdd * 1000000.0 / uCount, lScan * 1000000.0 / ((double)uCount * BENCH_SCAN_ROUNDS), lRemove,
+             (double)used / uCount, lFound == (dmbLONG)uCount * BENCH_SCAN_ROUNDS ? "ok" : "bad");
+
+    dmbSkipListDestroy(pList);
+}
+
+typedef struct LevelWorker {
+    dmbThread thread;
+    //0: random() as the old randomLevel, 1: dmbRandomLevel, 2: inserts into an own list
+    dmbUINT mode;
+    dmbUINT64 seed;
+    dmbUINT ops;
+    dmbUINT64 sum;
+} LevelWorker;
+
+static inline dmbINT libcLevel()
+{
+    dmbINT level = 1;
+    while (((random()&0xFFFF) < (0.25 * 0xFFFF)) && (32 > level))
+        level += 1;
+    return level;
+}
+
+static void* levelWorker(dmbThreadData data)
+{
+    LevelWorker *pWorker = (LevelWorker*)dmbThreadGetParam(data);
+    dmbZSkipList *pList;
+    dmbCHAR buf[32];
+    dmbUINT i, len;
+    dmbUINT64 x = pWorker->seed;
+
+    if (pWorker->mode == 0)
+    {
+        for (i=0; i<pWorker->ops; ++i)
+            pWorker->sum += libcLevel();
+    }
+    else if (pWorker->mode == 1)
+    {
+        for (i=0; i<pWorker->ops; ++i)
+            pWorker->sum += dmbRandomLevel(32);
+    }
+    else
+    {
+        pList = dmbZSkipListCreate();
+        for (i=0; i<pWorker->ops; ++i)
+        {
+            if (dmbZSkipListSize(pList) == THREAD_LIST_LEN)
+            {
+                pWorker->sum += THREAD_LIST_LEN;
+                dmbZSkipListDestroy(pList);
+                pList = dmbZSkipListCreate();
+            }
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+            len = snprintf(buf, sizeof(buf), "member:%u", i);
+            dmbZSkipListInsert(pList, (double)(x >> 11), dmbStringCreateWithBuffer(buf, len), NULL);
+        }
+        pWorker->sum += dmbZSkipListSize(pList);
+        dmbZSkipListDestroy(pList);
+    }
+
+    return NULL;
+}
+
+//threads draw levels or fill their own lists, only the generator state could be shared
+static void benchThreads(dmbUINT uMode, dmbUINT uThreads)
+{
+    static const dmbCHAR *modes[] = {"random() level", "dmbRandomLevel", "zskiplist insert"};
+    LevelWorker workers[MAX_THREADS];
+    dmbUINT i;
+    dmbUINT64 sum = 0;
+    dmbLONG lCost;
+
+    for (i=0; i<uThreads; ++i)
+    {
+        workers[i].mode = uMode;
+        workers[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+        workers[i].ops = THREAD_BENCH_OPS / uThreads;
+        workers[i].sum = 0;
+        dmbThreadInit(&workers[i].thread, levelWorker, NULL, &workers[i]);
+    }
+
+    lCost = dmbLocalCurrentMillis();
+    for (i=0; i<uThreads; ++i)
+        dmbThreadStart(&workers[i].thread);
+    for (i=0; i<uThreads; ++i)
+        dmbThreadJoin(&workers[i].thread);
+    lCost = dmbLocalCurrentMillis() - lCost;
+
+    for (i=0; i<uThreads; ++i)
+        sum += workers[i].sum;
+
+    //the insert run sums list sizes, the others levels
+    DMB_LOGD("%-16s %2u threads: %7.2f Mops/s, %s %.3f\n", modes[uMode], uThreads,
+             lCost == 0 ? 0.0 : (double)workers[0].ops * uThreads / lCost / 1000.0,
+             uMode == 2 ? "inserted/op" : "avg level", (double)sum / (workers[0].ops * uThreads));
+}
+
+//a fixed seed replays the same levels, about 1/4 of the levels reach 2
+static void testRandom()
+{
+    dmbINT levels[1000], level;
+    dmbUINT i, uBad = 0, uAbove = 0;
+
+    dmbRandomSetSeed(7);
+    for (i=0; i<1000; ++i)
+        levels[i] = dmbRandomLevel(32);
+
+    dmbRandomSetSeed(7);
+    for (i=0; i<1000; ++i)
+        uBad += dmbRandomLevel(32) != levels[i];
+
+    for (i=0; i<1000000; ++i)
+    {
+        level = dmbRandomLevel(4);
+        uBad += level < 1 || level > 4;
+        uAbove += level > 1;
+    }
+    uBad += uAbove < 245000 || uAbove > 255000;
+
+    DMB_LOGD("random level: level > 1 %.4f, bad %u\n", uAbove / 1000000.0, uBad);
+}
+
+static void benchZset(dmbUINT uCount)
+{
+    dmbZset *pZset = dmbZsetCreate();
+    dmbCHAR buf[32];
+    dmbUINT i, k, len;
+    dmbLONG lAdd, lRank, lRange, lByRank, lFound = 0, lListed = 0, lRanked = 0;
+    double step = (double)RAND_MAX / uCount * BENCH_RANGE_LEN, min;
+
+    srandom(3);
+    lAdd = dmbLocalCurrentMillis();
+    for (i=0; i<uCount; ++i)
+    {
+        len = snprintf(buf, sizeof(buf), "member:%u", i);
+        dmbZsetAdd(pZset, buf, len, (double)random(), NULL);
+    }
+    lAdd = dmbLocalCurrentMillis() - lAdd;
+
+    lRank = dmbLocalCurrentMillis();
+    for (i=0; i<BENCH_QUERY_COUNT; ++i)
+    {
+        k = random() % uCount;
+        len = snprintf(buf, sizeof(buf), "member:%u", k);
+        lRanked += dmbZsetRank(pZset, buf, len, FALSE) >= 0;
+    }
+    lRank = dmbLocalCurrentMillis() - lRank;
+
+    //ranges that hold about BENCH_RANGE_LEN members
+    lRange = dmbLocalCurrentMillis();
+    for (i=0; i<BENCH_QUERY_COUNT; ++i)
+    {
+        min = (double)random();
+        dmbZsetRangeByScore(pZset, min, min + step, FALSE, countRange, &lFound);
+    }
+    lRange = dmbLocalCurrentMillis() - lRange;
+
+    lByRank = dmbLocalCurrentMillis();
+    for (i=0; i<BENCH_QUERY_COUNT; ++i)
+    {
+        k = random() % (uCount - BENCH_RANGE_LEN);
+        dmbZsetRangeByRank(pZset, k, k + BENCH_RANGE_LEN - 1, FALSE, countRange, &lListed);
+    }
+    lByRank = dmbLocalCurrentMillis() - lByRank;
+
+    DMB_LOGD("zset %8u members, %-8s: ZADD %5.0f ns/op, ZRANK %5.0f ns/op, ZRANGEBYSCORE(~%u) %5.0f ns/op, ZRANGE(%u) %5.0f ns/op, ranked %ld, avg range %.1f, listed %ld\n",
+             uCount, encodeName(pZset->encode), lAdd * 1000000.0 / uCount, lRank * 1000000.0 / BENCH_QUERY_COUNT, BENCH_RANGE_LEN,
+             lRange * 1000000.0 / BENCH_QUERY_COUNT, BENCH_RANGE_LEN, lByRank * 1000000.0 / BENCH_QUERY_COUNT,
+             lRanked, (double)lFound / BENCH_QUERY_COUNT, lListed);
+
+    dmbZsetDestroy(pZset);
+}
+
+//bytes per key with uMembers members in each encoding
+static void memZset(dmbUINT uMembers)
+{
+    dmbZset **ppZsets = (dmbZset**)dmbMalloc(sizeof(dmbZset*) * MEM_KEY_COUNT);
+    dmbUINT uEntries = g_settings.zset_max_binlist_entries;
+    dmbCHAR buf[32];
+    dmbUINT i, k, len, pass;
+    size_t used[2];
+
+    for (pass=0; pass<2; ++pass)
+    {
+        //the second pass converts every set on its first add
+        g_settings.zset_max_binlist_entries = pass == 0 ? uMembers : 0;
+        srandom(4);
+        used[pass] = dmbGetUsedMemSize();
+        for (i=0; i<MEM_KEY_COUNT; ++i)
+        {
+            ppZsets[i] = dmbZsetCreate();
+            for (k=0; k<uMembers; ++k)
+            {
+                len = snprintf(buf, sizeof(buf), "member:%u", k);
+                dmbZsetAdd(ppZsets[i], buf, len, (double)random(), NULL);
+            }
+        }
+        used[pass] = dmbGetUsedMemSize() - used[pass];
+
+        for (i=0; i<MEM_KEY_COUNT; ++i)
+            dmbZsetDestroy(ppZsets[i]);
+    }
+    g_settings.zset_max_binlist_entries = uEntries;
+
+    DMB_LOGD("zset %3u members: binlist %6zu bytes/key, skiplist %6zu bytes/key, saved %6zu bytes/key (%.1fx)\n",
+             uMembers, used[0] / MEM_KEY_COUNT, used[1] / MEM_KEY_COUNT, (used[1] - used[0]) / MEM_KEY_COUNT,
+             (double)used[1] / used[0]);
+
+    dmbFree(ppZsets);
+}
+
+void dmbzset_test()
+{
+    dmbUINT uCount, uEngine, uMode;
+    dmbUINT uEntries = g_settings.zset_max_binlist_entries, uValue = g_settings.zset_max_binlist_value;
+    dmbUINT uUseBtree = g_settings.zset_use_btree;
+
+    g_settings.zset_max_binlist_entries = 128;
+    g_settings.zset_max_binlist_value = 64;
+
+    testRandom();
+    testBulk(1000);
+    testBulk(TEST_MEMBER_COUNT);
+    //reproducible skiplist levels for the rest of the test
+    dmbRandomSetSeed(1);
+
+    //skiplist, then btree for the large sets
+    for (uEngine = 0; uEngine < 2; ++uEngine)
+    {
+        g_settings.zset_use_btree = uEngine;
+        testZset(100);
+        testZset(TEST_MEMBER_COUNT);
+        testConvert();
+        testUpdateNoMem();
+    }
+    g_settings.zset_use_btree = 0;
+
+    for (uCount = 8; uCount <= 128; uCount *= 2)
+        memZset(uCount);
+
+    for (uCount = 10000; uCount <= ZSET_BENCH_MAX; uCount *= 10)
+    {
+        for (uEngine = 0; uEngine < 2; ++uEngine)
+        {
+            g_settings.zset_use_btree = uEngine;
+            benchZset(uCount);
+        }
+    }
+    g_settings.zset_use_btree = uUseBtree;
+
+    for (uCount = 10000; uCount <= SKIPLIST_BENCH_MAX; uCount *= 10)
+        benchSkipList(uCount);
+
+    for (uCount = 10000; uCount <= SKIPLIST_BENCH_MAX; uCount *= 10)
+        benchNodes(uCount);
+
+    for (uCount = 10000; uCount <= SKIPLIST_BENCH_MAX; uCount *= 10)
+        benchBulk(uCount);
+
+    for (uMode = 0; uMode < 3; ++uMode)
+    {
+        for (uCount = 1; uCount <= MAX_THREADS; uCount *= 2)
+            benchThreads(uMode, uCount);
+    }
+
+    g_settings.zset_max_binlist_entries = uEntries;
+    g_settings.zset_max_binlist_value = uValue;
+}
@@ -0,0 +1,82 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dmbmailbox.h"
+#include "core/dmballoc.h"
+
+dmbCode dmbMailboxInit(dmbMailbox *pBox, dmbUINT uCapacity)
+{
+    dmbUINT size = 2;
+
+    while (size < uCapacity)
+        size <<= 1;
+
+    pBox->slots = (void**)dmbMalloc(sizeof(void*) * size);
+    if (pBox->slots == NULL)
+        return DMB_ERRCODE_ALLOC_FAILED;
+
+    pBox->mask = size - 1;
+    pBox->head = 0;
+    pBox->tail = 0;
+
+    return DMB_ERRCODE_OK;
+}
+
+void dmbMailboxPurge(dmbMailbox *pBox)
+{
+    DMB_SAFE_FREE(pBox->slots);
+    pBox->mask = 0;
+    pBox->head = 0;
+    pBox->tail = 0;
+}
+
+dmbBOOL dmbMailboxPush(dmbMailbox *pBox, void *pMsg, dmbBOOL *pWake)
+{
+    dmbUINT tail = pBox->tail;
+    dmbUINT head = __atomic_load_n(&pBox->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head > pBox->mask)
+        return FALSE;
+
+    pBox->slots[tail & pBox->mask] = pMsg;
+    __atomic_store_n(&pBox->tail, tail + 1, __ATOMIC_RELEASE);
+
+    //pairs with the fence in dmbMailboxPop: either we see the consumer has
+    //taken everything before our message and wake it, or it sees our tail
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    *pWake = __atomic_load_n(&pBox->head, __ATOMIC_RELAXED) == tail;
+
+    return TRUE;
+}
+
+void* dmbMailboxPop(dmbMailbox *pBox)
+{
+    dmbUINT head = pBox->head;
+    void *pMsg;
+
+    if (head == __atomic_load_n(&pBox->tail, __ATOMIC_ACQUIRE))
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (head == __atomic_load_n(&pBox->tail, __ATOMIC_ACQUIRE))
+            return NULL;
+    }
+
+    pMsg = pBox->slots[head & pBox->mask];
+    __atomic_store_n(&pBox->head, head + 1, __ATOMIC_RELEASE);
+
+    return pMsg;
+}
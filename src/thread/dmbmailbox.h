@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2016-2017 Xiongfa Li, <damao1222@live.com>
+    All rights reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DMBMAILBOX_H
+#define DMBMAILBOX_H
+
+#include "dmbdefines.h"
+
+/*
+ * Lock free single producer / single consumer ring of pointers.
+ * head is only written by the consumer and tail only by the producer, they
+ * live on different cache lines so the two threads never write the same line.
+ * An MPSC inbox is an array of these, one per producer.
+ */
+
+#define DMB_MAILBOX_CACHELINE 64
+
+typedef struct dmbMailbox {
+    void **slots;
+    dmbUINT mask;
+    dmbCHAR pad0[DMB_MAILBOX_CACHELINE - sizeof(void**) - sizeof(dmbUINT)];
+    //next slot to pop, written by the consumer
+    volatile dmbUINT head;
+    dmbCHAR pad1[DMB_MAILBOX_CACHELINE - sizeof(dmbUINT)];
+    //next slot to push, written by the producer
+    volatile dmbUINT tail;
+    dmbCHAR pad2[DMB_MAILBOX_CACHELINE - sizeof(dmbUINT)];
+} dmbMailbox;
+
+/**
+ * @brief dmbMailboxInit 初始化
+ * @param uCapacity 容量，向上取2的幂
+ */
+dmbCode dmbMailboxInit(dmbMailbox *pBox, dmbUINT uCapacity);
+
+void dmbMailboxPurge(dmbMailbox *pBox);
+
+/**
+ * @brief dmbMailboxPush 生产者线程调用
+ * @param pWake 输出，消费者可能已经取空并休眠，需要唤醒时为TRUE
+ * @return 满时返回FALSE
+ */
+dmbBOOL dmbMailboxPush(dmbMailbox *pBox, void *pMsg, dmbBOOL *pWake);
+
+/**
+ * @brief dmbMailboxPop 消费者线程调用
+ * @return 空时返回NULL
+ */
+void* dmbMailboxPop(dmbMailbox *pBox);
+
+#endif // DMBMAILBOX_H
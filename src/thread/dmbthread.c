@@ -15,6 +15,11 @@
     limitations under the License.
 */
 
+//pthread_rwlockattr_setkind_np is a GNU extension
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "dmbthread.h"
 #include <unistd.h>
 
@@ -48,6 +53,27 @@ void dmbSleep(dmbUINT uMilliSec)
     usleep(uMilliSec * 1000);
 }
 
+dmbCode dmbRWLockInit(dmbRWLock *pLock)
+{
+    pthread_rwlockattr_t attr;
+    dmbINT ret;
+
+    pthread_rwlockattr_init(&attr);
+#if defined(__GLIBC__) && defined(__USE_GNU)
+    //a steady stream of readers must not starve the writers
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    ret = pthread_rwlock_init(pLock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+
+    return ret == 0 ? DMB_ERRCODE_OK : DMB_ERRCODE_THREAD_ERROR;
+}
+
+void dmbRWLockDestroy(dmbRWLock *pLock)
+{
+    pthread_rwlock_destroy(pLock);
+}
+
 void* static_run(void *data)
 {
     dmbThread* pThread = (dmbThread*)(data);
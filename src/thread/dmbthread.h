@@ -37,6 +37,15 @@ dmbCode dmbThreadStart(dmbThread *pThread);
 dmbCode dmbThreadJoin(dmbThread *pThread);
 void dmbSleep(dmbUINT uMilliSec);
 
+typedef pthread_rwlock_t dmbRWLock;
+
+dmbCode dmbRWLockInit(dmbRWLock *pLock);
+void dmbRWLockDestroy(dmbRWLock *pLock);
+
+#define dmbRWLockRead(LOCK) pthread_rwlock_rdlock(LOCK)
+#define dmbRWLockWrite(LOCK) pthread_rwlock_wrlock(LOCK)
+#define dmbRWLockUnlock(LOCK) pthread_rwlock_unlock(LOCK)
+
 #define dmbThreadRunning(DATA) \
     (((dmbThread*)(DATA))->checkFunc ? ((dmbThread*)(DATA))->checkFunc() : TRUE)
 
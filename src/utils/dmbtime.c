@@ -50,6 +50,14 @@ dmbLONG dmbLocalCurrentMillis()
     return (1000L *  time.tv_sec + time.tv_usec / 1000L);
 }
 
+dmbLONG dmbMonotonicNanos()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (1000000000L * ts.tv_sec + ts.tv_nsec);
+}
+
 inline dmbLONG dmbLocalCurrentSec()
 {
     return time(NULL);
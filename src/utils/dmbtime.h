@@ -57,6 +57,13 @@ dmbBOOL dmbGetSpecialFormatTime(const char *pcFormat, char *pcBuf, dmbUINT uSize
  */
 dmbLONG dmbLocalCurrentMillis();
 
+/**
+ * @brief 获得单调时钟的纳秒数，只用于计算耗时
+ *
+ * @return dmbLONG 纳秒数
+ */
+dmbLONG dmbMonotonicNanos();
+
 /**
  * @brief 获得本地系统秒数
  *